@@ -1,11 +1,11 @@
 #include <expected>
 #include <format>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <argparse/argparse.hpp>
 #include <magic_enum/magic_enum.hpp>
 #include <spdlog/spdlog.h>
-#include <spdlog/sinks/basic_file_sink.h>
 
 #include "args.hpp"
 
@@ -15,6 +15,21 @@ using namespace app;
 namespace {
 const std::string kSettingsFileName = "settings.toml";
 const std::string kDefaultLogLevel = "info";
+const std::string kDefaultCpuCore = "cached";
+const std::string kDoctorTraceFileName = "doctor.trace";
+}
+
+static std::optional<CpuCore> ParseCpuCore(std::string_view name) {
+  if (name == "cached") {
+    return CpuCore::kCached;
+  }
+  if (name == "interp") {
+    return CpuCore::kInterpreter;
+  }
+  if (name == "jit") {
+    return CpuCore::kJit;
+  }
+  return std::nullopt;
 }
 
 static bool SetLoggingLevel(std::string_view level_name) {
@@ -42,7 +57,24 @@ std::expected<Args, std::string> app::GetArgs(std::string_view name, std::string
     .nargs(1);
 
   program.add_argument("--doctor-log")
-    .help("Outputs log file for gameboy-doctor")
+    .help("Traces for gameboy-doctor to doctor.trace, convert it with trace-convert")
+    .implicit_value(true)
+    .default_value(false);
+
+  program.add_argument("--trace")
+    .help("Records a binary trace of every instruction to the given file")
+    .default_value(std::string{})
+    .nargs(1);
+
+  program.add_argument("--cpu-core")
+    .help("CPU core: 'cached' runs pre-decoded blocks, 'interp' fetches and decodes every instruction, "
+          "'jit' compiles ROM blocks to x86-64 code (falls back to 'cached' elsewhere)")
+    .default_value(kDefaultCpuCore)
+    .nargs(1);
+
+  program.add_argument("--verify-cpu-core")
+    .help("Checks the cached core against the interpreter's fetches and reports stale code, "
+          "with 'jit' also replays every compiled block on the interpreter and compares the results")
     .implicit_value(true)
     .default_value(false);
 
@@ -65,20 +97,27 @@ std::expected<Args, std::string> app::GetArgs(std::string_view name, std::string
     return std::unexpected{ss.str()};
   }
 
+  const std::string core_name = program.get("--cpu-core");
+  auto cpu_core = ParseCpuCore(core_name);
+  if (!cpu_core.has_value()) {
+    std::stringstream ss;
+    ss << std::format("Invalid argument \"{}\" - allowed options: {{cached, interp, jit}}\n", core_name);
+    ss << program;
+    return std::unexpected{ss.str()};
+  }
+
   auto doctor_log = program.get<bool>("--doctor-log");
-  if (doctor_log) {
-    try {
-      auto logger = spdlog::basic_logger_mt("doctor_logger", "doctor.log");
-      logger->set_pattern("%v");
-    }
-    catch (const spdlog::spdlog_ex& ex) {
-      return std::unexpected{std::format("Doctor logger failed to initialize: {}", ex.what())};
-    }
+  auto trace_path = program.get<std::string>("--trace");
+  if (doctor_log && trace_path.empty()) {
+    trace_path = kDoctorTraceFileName;
   }
 
   return Args{
     .settings_filename = program.get<std::string>("--settings"),
     .log_level = level,
     .doctor_log = doctor_log,
+    .trace_path = trace_path,
+    .cpu_core = cpu_core.value(),
+    .verify_cpu_core = program.get<bool>("--verify-cpu-core"),
   };
 }
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <expected>
+#include <string>
 #include <string_view>
 
+#include "cpu_core.hpp"
+
 
 namespace app {
 
@@ -10,6 +13,9 @@ namespace app {
     std::string settings_filename;
     std::string log_level;
     bool doctor_log;
+    std::string trace_path;
+    CpuCore cpu_core;
+    bool verify_cpu_core;
   };
 
   std::expected<Args, std::string> GetArgs(std::string_view name, std::string_view version, int argc, char** argv);
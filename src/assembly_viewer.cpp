@@ -9,8 +9,8 @@ namespace {
   std::array<bool, kMaxMemorySize> g_visited;
 }
 
-void AssemblyViewer::Initialize(Emulator* emulator) {
-  emulator_ = emulator;
+void AssemblyViewer::Initialize(const EmulatorThread* emulator_thread) {
+  emulator_thread_ = emulator_thread;
 }
 
 void AssemblyViewer::Draw() {
@@ -37,7 +37,7 @@ void AssemblyViewer::Draw() {
     ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(0, 0));
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
 
-    const auto& regs = emulator_->GetRegisters();
+    const auto& regs = emulator_thread_->GetSnapshot().registers;
 
     g_visited.fill(false);
 
@@ -65,7 +65,7 @@ void AssemblyViewer::Draw() {
         }
 
         ImGui::SameLine();
-        ImGui::TextUnformatted(std::format(":  {:02X}", emulator_->Read8(addr)).c_str());
+        ImGui::TextUnformatted(std::format(":  {:02X}", emulator_thread_->GetSnapshot().Read8(addr)).c_str());
 
         ImGui::SameLine();
         ImGui::TextUnformatted("  ");
@@ -637,8 +637,9 @@ std::string AssemblyViewer::DecodePrefixed(u8 op) const {
 }
 
 std::string AssemblyViewer::GetInstruction(u16 addr) const {
-  u8 op = emulator_->Read8(addr);
-  u8 imm8 = emulator_->Read8(addr+1);
-  u16 imm16 = emulator_->Read16(addr+1);
+  const auto& snapshot = emulator_thread_->GetSnapshot();
+  u8 op = snapshot.Read8(addr);
+  u8 imm8 = snapshot.Read8(addr+1);
+  u16 imm16 = snapshot.Read16(addr+1);
   return Decode(op, imm8, imm16);
 }
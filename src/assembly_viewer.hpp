@@ -1,12 +1,12 @@
 #pragma once
 
 #include "types.hpp"
-#include "emulator.hpp"
+#include "emulator_thread.hpp"
 
 
 class AssemblyViewer {
 public:
-  void Initialize(Emulator* emulator);
+  void Initialize(const EmulatorThread* emulator_thread);
   void Draw();
 
 private:
@@ -15,5 +15,5 @@ private:
   std::string DecodePrefixed(u8 op) const;
 
   bool auto_scroll_ = true;
-  Emulator* emulator_;
+  const EmulatorThread* emulator_thread_ = nullptr;
 };
@@ -119,6 +119,19 @@ void Audio::OnTick(bool double_speed) {
   }
 }
 
+// The channels never raise an interrupt, batches only save the virtual calls.
+u32 Audio::IdleTicks(bool double_speed) const {
+  return kIdleForever;
+}
+
+void Audio::OnTicks(u32 m_cycles, bool double_speed) {
+  ZoneScoped;
+  const u32 dots = m_cycles * (double_speed ? 2 : 4);
+  for (u32 i = 0; i < dots; i += 1) {
+    Step();
+  }
+}
+
 void Audio::Step() {
   ch1_.Tick();
   ch2_.Tick();
@@ -159,6 +172,16 @@ void Audio::GetSamples(std::span<float> out_buffer) {
   }
 }
 
+size_t Audio::ReadExportSamples(std::span<float> out_buffer) {
+  size_t count = 0;
+  while (export_read_idx_ != buffer_write_idx_ && count < out_buffer.size()) {
+    out_buffer[count] = sample_buffer_[export_read_idx_];
+    export_read_idx_ = (export_read_idx_ + 1) % sample_buffer_.size();
+    count += 1;
+  }
+  return count;
+}
+
 std::tuple<float, float> Audio::Sample() const {
   float left = 0.0f;
   float right = 0.0f;
@@ -47,8 +47,13 @@ public:
   void PowerOff();
 
   void OnTick(bool double_speed) override;
+  [[nodiscard]] u32 IdleTicks(bool double_speed) const override;
+  void OnTicks(u32 m_cycles, bool double_speed) override;
 
   void GetSamples(std::span<float> out_buffer);
+  // Copies samples produced since the previous call without consuming them
+  // from the playback side. Returns the number of floats written.
+  size_t ReadExportSamples(std::span<float> out_buffer);
 
   bool IsChannelEnabled(AudioChannelID channel) const;
   void ToggleChannel(AudioChannelID channel, bool enable);
@@ -67,6 +72,7 @@ private:
   std::array<float, kSampleBufferMaxSize> sample_buffer_ {};
   u16 buffer_write_idx_ {};
   u16 buffer_read_idx_ {};
+  u16 export_read_idx_ {};
 
   union {
     u8 val;
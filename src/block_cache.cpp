@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <tracy/Tracy.hpp>
+
+#include "block_cache.hpp"
+
+
+namespace {
+  // Plenty for any cartridge; self-modifying code in RAM could otherwise grow
+  // the cache without bound.
+  constexpr size_t kMaxBlocks = 1 << 16;
+}
+
+u64 BlockCache::Key(u16 pc, u32 bank) {
+  return (static_cast<u64>(bank) << 16) | pc;
+}
+
+CodeBlock* BlockCache::Find(u64 key) {
+  auto it = blocks_.find(key);
+  return it != blocks_.end() ? &it->second : nullptr;
+}
+
+CodeBlock& BlockCache::Insert(u64 key, CodeBlock block, bool writable) {
+  ZoneScoped;
+
+  if (blocks_.size() >= kMaxBlocks) {
+    Clear();
+  }
+  if (writable) {
+    pages_[block.pc >> 8].push_back(key);
+  }
+  return blocks_.insert_or_assign(key, std::move(block)).first->second;
+}
+
+bool BlockCache::Invalidate(u16 addr) {
+  ZoneScoped;
+
+  auto& page = pages_[addr >> 8];
+  const auto removed = std::erase_if(page, [this, addr](u64 key) {
+    auto it = blocks_.find(key);
+    if (it == blocks_.end()) {
+      return true;
+    }
+    if (addr < it->second.pc || addr >= it->second.end) {
+      return false;
+    }
+    blocks_.erase(it);
+    return true;
+  });
+  return removed > 0;
+}
+
+void BlockCache::Clear() {
+  blocks_.clear();
+  for (auto& page : pages_) {
+    page.clear();
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include "types.hpp"
+#include "instructions.hpp"
+#include "jit.hpp"
+
+struct LoopPattern;
+
+// A straight run of pre-decoded instructions with their operands resolved.
+// Execution leaves a block at its last instruction or at any jump.
+struct CodeBlock {
+  u16 pc = 0;
+  u32 end = 0;
+  std::vector<Instruction> instructions {};
+  // The bytes the instructions were decoded from, for verification.
+  std::vector<u8> code {};
+  // Set when the block starts with a known loop, see Cpu::FastForward.
+  const LoopPattern* loop = nullptr;
+  // The block's native code once the JIT core has compiled it.
+  JitFunction jit = nullptr;
+  // Set for blocks the JIT core leaves to the interpreter.
+  bool interpret = false;
+};
+
+// Decoded blocks keyed by their address and whatever is mapped there (see
+// Mmu::GetBankKey), so switching ROM or WRAM banks leaves the blocks of the
+// other banks intact. Blocks never cross a 256 byte page, which keeps the
+// bookkeeping for writes to code in RAM to the blocks of one page.
+class BlockCache {
+public:
+  [[nodiscard]] static u64 Key(u16 pc, u32 bank);
+
+  [[nodiscard]] CodeBlock* Find(u64 key);
+  // Blocks in writable memory are tracked so writes can invalidate them.
+  CodeBlock& Insert(u64 key, CodeBlock block, bool writable);
+
+  [[nodiscard]] bool HasCodeInPage(u16 addr) const {
+    return !pages_[addr >> 8].empty();
+  }
+
+  // Drops every block covering addr. Returns true if any was dropped.
+  bool Invalidate(u16 addr);
+  void Clear();
+
+private:
+  std::unordered_map<u64, CodeBlock> blocks_ {};
+  std::array<std::vector<u64>, 256> pages_ {};
+};
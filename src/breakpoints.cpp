@@ -0,0 +1,92 @@
+#include <algorithm>
+
+#include "breakpoints.hpp"
+
+
+void Breakpoints::Add(Breakpoint breakpoint) {
+  if (std::ranges::find(list_, breakpoint) == list_.end()) {
+    list_.push_back(breakpoint);
+    Rebuild();
+  }
+}
+
+void Breakpoints::Remove(u16 addr, std::optional<u16> bank) {
+  std::erase_if(list_, [addr, bank](const Breakpoint& breakpoint) {
+    return breakpoint.addr == addr && breakpoint.bank == bank;
+  });
+  Rebuild();
+}
+
+void Breakpoints::Clear() {
+  list_.clear();
+  Rebuild();
+}
+
+bool Breakpoints::Matches(u16 pc, u32 bank_key) const {
+  if (!addrs_[pc]) {
+    return false;
+  }
+  if (any_bank_[pc]) {
+    return true;
+  }
+  auto it = banks_.find(bank_key);
+  return it != banks_.end() && it->second[pc];
+}
+
+const std::vector<Breakpoint>& Breakpoints::List() const {
+  return list_;
+}
+
+void Breakpoints::Rebuild() {
+  addrs_.reset();
+  any_bank_.reset();
+  banks_.clear();
+  for (const auto& breakpoint : list_) {
+    addrs_.set(breakpoint.addr);
+    if (breakpoint.bank) {
+      banks_[static_cast<u32>(breakpoint.device) << 16 | *breakpoint.bank].set(breakpoint.addr);
+    } else {
+      any_bank_.set(breakpoint.addr);
+    }
+  }
+}
+
+void Watchpoints::Add(Watchpoint watchpoint) {
+  Remove(watchpoint.addr);
+  if (watchpoint.read || watchpoint.write) {
+    list_.push_back(watchpoint);
+  }
+  Rebuild();
+}
+
+void Watchpoints::Remove(u16 addr) {
+  std::erase_if(list_, [addr](const Watchpoint& watchpoint) {
+    return watchpoint.addr == addr;
+  });
+  Rebuild();
+}
+
+void Watchpoints::Clear() {
+  list_.clear();
+  Rebuild();
+}
+
+const std::vector<Watchpoint>& Watchpoints::List() const {
+  return list_;
+}
+
+void Watchpoints::Rebuild() {
+  pages_.fill(0);
+  reads_.reset();
+  writes_.reset();
+  for (const auto& watchpoint : list_) {
+    if (watchpoint.read) {
+      pages_[watchpoint.addr >> 8] |= kWatchRead;
+      reads_.set(watchpoint.addr);
+    }
+    if (watchpoint.write) {
+      pages_[watchpoint.addr >> 8] |= kWatchWrite;
+      writes_.set(watchpoint.addr);
+    }
+  }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "types.hpp"
+
+
+struct Breakpoint {
+  u16 addr;
+  // Only stops while this bank is mapped at addr, any bank when empty.
+  std::optional<u16> bank;
+  // Mmu device the bank belongs to, so bank 0 of the cartridge doesn't also
+  // match the boot ROM or WRAM bank 0. Set by Emulator::AddBreakPoint.
+  u16 device = 0;
+
+  bool operator==(const Breakpoint&) const = default;
+};
+
+// Every address with a breakpoint has its bit set, so an instruction without
+// one costs a single bit test. Banked breakpoints get a bitmap per bank that
+// is only looked at on a hit.
+class Breakpoints {
+public:
+  void Add(Breakpoint breakpoint);
+  // Removes the breakpoint at addr and bank, whichever device it belongs to.
+  void Remove(u16 addr, std::optional<u16> bank);
+  void Clear();
+
+  [[nodiscard]] bool Empty() const {
+    return list_.empty();
+  }
+
+  // True when some bank has a breakpoint at pc, Matches has the final say.
+  [[nodiscard]] bool MayMatch(u16 pc) const {
+    return addrs_[pc];
+  }
+
+  // bank_key is Mmu::GetBankKey(pc).
+  [[nodiscard]] bool Matches(u16 pc, u32 bank_key) const;
+  [[nodiscard]] const std::vector<Breakpoint>& List() const;
+
+private:
+  using Bitmap = std::bitset<0x10000>;
+
+  void Rebuild();
+
+  std::vector<Breakpoint> list_ {};
+  Bitmap addrs_ {};
+  Bitmap any_bank_ {};
+  std::unordered_map<u32, Bitmap> banks_ {};
+};
+
+struct Watchpoint {
+  u16 addr;
+  bool read;
+  bool write;
+};
+
+// Read and write watchpoints on CPU memory accesses. A per page summary keeps
+// the check for accesses to unwatched pages to one load. DMA transfers don't
+// go through the CPU and are not watched.
+class Watchpoints {
+public:
+  // Watching an address again replaces its access types.
+  void Add(Watchpoint watchpoint);
+  void Remove(u16 addr);
+  void Clear();
+
+  [[nodiscard]] bool Empty() const {
+    return list_.empty();
+  }
+
+  [[nodiscard]] bool IsWatched(u16 addr, bool write) const {
+    const u8 flag = write ? kWatchWrite : kWatchRead;
+    return (pages_[addr >> 8] & flag) && (write ? writes_[addr] : reads_[addr]);
+  }
+
+  [[nodiscard]] const std::vector<Watchpoint>& List() const;
+
+private:
+  static constexpr u8 kWatchRead = 1 << 0;
+  static constexpr u8 kWatchWrite = 1 << 1;
+
+  void Rebuild();
+
+  std::vector<Watchpoint> list_ {};
+  std::array<u8, 0x100> pages_ {};
+  std::bitset<0x10000> reads_ {};
+  std::bitset<0x10000> writes_ {};
+};
+
+struct WatchHit {
+  u16 addr;
+  bool write;
+};
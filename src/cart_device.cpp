@@ -34,6 +34,46 @@ u8 CartDevice::Read8(u16 addr) const {
   return mbc_->ReadRam(addr);
 }
 
+bool CartDevice::IsValidForRange(u16 first, u16 last) const {
+  return last <= kRomBank01End || (first >= kExtRamStart && last <= kExtRamEnd);
+}
+
+void CartDevice::ReadSpan(u16 addr, std::span<u8> dst) const {
+  while (!dst.empty()) {
+    size_t end;
+    if (addr <= kRomBank00End) {
+      end = kRomBank00End + 1;
+    } else if (addr <= kRomBank01End) {
+      end = kRomBank01End + 1;
+    } else {
+      end = kExtRamEnd + 1;
+    }
+
+    auto chunk = dst.first(std::min(dst.size(), end - addr));
+    if (addr <= kRomBank00End) {
+      mbc_->ReadRom0Span(addr, chunk);
+    } else if (addr <= kRomBank01End) {
+      mbc_->ReadRom1Span(addr, chunk);
+    } else {
+      mbc_->ReadRamSpan(addr, chunk);
+    }
+
+    addr += chunk.size();
+    dst = dst.subspan(chunk.size());
+  }
+}
+
+void CartDevice::WriteSpan(u16 addr, std::span<const u8> src) {
+  if (addr >= kExtRamStart) {
+    return mbc_->WriteRamSpan(addr, src);
+  }
+  MmuDevice::WriteSpan(addr, src);
+}
+
+u16 CartDevice::GetBank(u16 addr) const {
+  return addr <= kRomBank01End ? mbc_->GetRomBank(addr) : 0;
+}
+
 void CartDevice::Reset() {
   info_.Reset();
   mbc_ = std::make_unique<NoMbc>();
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cmath>
+#include <tracy/Tracy.hpp>
+
+#include "color_correction.hpp"
+
+
+namespace {
+  constexpr float kGbaSpLcdGamma = 2.2f;
+  constexpr float kGbaSpOutGamma = 2.2f;
+  constexpr float kGbaSpLuminance = 0.94f;
+
+  // Approximates the AGS-101 panel: slightly cool and less saturated than a
+  // straight RGB555 expansion.
+  constexpr float kGbaSpMatrix[3][3] = {
+    { 0.86f, 0.10f, 0.04f },
+    { 0.03f, 0.92f, 0.05f },
+    { 0.02f, 0.08f, 0.90f },
+  };
+
+  Color Raw(int r, int g, int b) {
+    return Color{
+      .r = static_cast<u8>(r << 3),
+      .g = static_cast<u8>(g << 3),
+      .b = static_cast<u8>(b << 3),
+      .a = 0xff,
+    };
+  }
+
+  // Channel mixing of the CGB LCD as used by higan/bsnes.
+  Color GbcLcd(int r, int g, int b) {
+    const int out_r = r * 26 + g * 4 + b * 2;
+    const int out_g = g * 24 + b * 8;
+    const int out_b = r * 6 + g * 4 + b * 22;
+    return Color{
+      .r = static_cast<u8>(std::min(960, out_r) >> 2),
+      .g = static_cast<u8>(std::min(960, out_g) >> 2),
+      .b = static_cast<u8>(std::min(960, out_b) >> 2),
+      .a = 0xff,
+    };
+  }
+
+  Color GbaSp(int r, int g, int b) {
+    const float in[3] = {
+      std::pow(r / 31.0f, kGbaSpLcdGamma) * kGbaSpLuminance,
+      std::pow(g / 31.0f, kGbaSpLcdGamma) * kGbaSpLuminance,
+      std::pow(b / 31.0f, kGbaSpLcdGamma) * kGbaSpLuminance,
+    };
+
+    u8 out[3];
+    for (int i = 0; i < 3; i += 1) {
+      const float linear = kGbaSpMatrix[i][0] * in[0] + kGbaSpMatrix[i][1] * in[1] + kGbaSpMatrix[i][2] * in[2];
+      const float value = std::pow(std::clamp(linear, 0.0f, 1.0f), 1.0f / kGbaSpOutGamma);
+      out[i] = static_cast<u8>(std::lround(value * 255.0f));
+    }
+    return Color{ .r = out[0], .g = out[1], .b = out[2], .a = 0xff };
+  }
+}
+
+void BuildColorCorrectionLut(ColorCorrection profile, std::span<Color, kCgbNumColors> lut) {
+  ZoneScoped;
+
+  for (size_t value = 0; value < lut.size(); value += 1) {
+    const int r = value & 0x1f;
+    const int g = (value >> 5) & 0x1f;
+    const int b = (value >> 10) & 0x1f;
+
+    switch (profile) {
+      case ColorCorrection::kRaw: lut[value] = Raw(r, g, b); break;
+      case ColorCorrection::kGbcLcd: lut[value] = GbcLcd(r, g, b); break;
+      case ColorCorrection::kGbaSp: lut[value] = GbaSp(r, g, b); break;
+    }
+  }
+}
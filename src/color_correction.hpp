@@ -0,0 +1,17 @@
+#pragma once
+
+#include <span>
+#include <raylib.h>
+
+#include "types.hpp"
+
+
+constexpr size_t kCgbNumColors = 32768;
+
+enum class ColorCorrection {
+  kRaw,
+  kGbcLcd,
+  kGbaSp,
+};
+
+void BuildColorCorrectionLut(ColorCorrection profile, std::span<Color, kCgbNumColors> lut);
@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <format>
+#include <span>
 #include <spdlog/spdlog.h>
 #include <magic_enum/magic_enum.hpp>
 #include <tracy/Tracy.hpp>
@@ -7,6 +12,9 @@
 #include "opcodes.hpp"
 #include "overloaded.hpp"
 #include "instructions.hpp"
+#include "memory_bank_controller.hpp"
+#include "loop_idioms.hpp"
+#include "input_device.hpp"
 
 
 inline u16 interrupt_handler(Interrupt interrupt) {
@@ -30,6 +38,106 @@ inline bool check_cond(Cpu& cpu, Cond cond) {
   }
 }
 
+namespace {
+  constexpr size_t kMaxBlockInstructions = 64;
+  constexpr u16 kVramStart = 0x8000;
+  constexpr u16 kVramEnd = 0x9FFF;
+  constexpr u16 kWramStart = 0xC000;
+  constexpr u16 kWramEnd = 0xDFFF;
+  // Echo RAM mirrors C000-DDFF.
+  constexpr u16 kEchoRamStart = 0xE000;
+  constexpr u16 kEchoRamEnd = 0xFDFF;
+  constexpr u16 kEchoRamOffset = kEchoRamStart - kWramStart;
+  constexpr u16 kHramStart = 0xFF80;
+  constexpr u16 kHramEnd = 0xFFFE;
+  constexpr size_t kTransferChunkSize = 0x100;
+
+  // How many bytes from addr on, moving by step, stay in VRAM, WRAM or HRAM,
+  // or in ROM as well for reads. Copies and fills never touch registers or
+  // banked cartridge RAM in bulk.
+  u32 TransferExtent(u16 addr, i8 step, bool write) {
+    auto extent = [&](u16 first, u16 last) -> u32 {
+      if (addr < first || addr > last) {
+        return 0;
+      }
+      return step > 0 ? last - addr + 1 : addr - first + 1;
+    };
+    u32 size = std::max({ extent(kVramStart, kVramEnd), extent(kWramStart, kWramEnd), extent(kHramStart, kHramEnd) });
+    if (!write) {
+      size = std::max(size, extent(0, kRomBank01End));
+    }
+    return size;
+  }
+
+  bool Overlaps(u32 first1, u32 size1, u32 first2, u32 size2) {
+    return first1 < first2 + size2 && first2 < first1 + size1;
+  }
+
+  Reg16 PointerRegister(LoopOperand operand) {
+    return operand == LoopOperand::kHl ? Reg16::HL : Reg16::DE;
+  }
+}
+
+// Decodes the instruction whose bytes `read_byte` returns in order, reading
+// its operands as well.
+template <typename ReadByte>
+Instruction decode_instruction(ReadByte&& read_byte) {
+  Instruction instr = Decoder::Decode(read_byte());
+
+  if (instr.opcode == Opcode::PREFIX) {
+    instr = Decoder::DecodePrefixed(read_byte());
+  }
+
+  auto read16 = [&] {
+    u16 lo = read_byte();
+    u16 hi = read_byte();
+    return static_cast<u16>(lo | (hi << 8));
+  };
+
+  std::visit(overloaded{
+     [&](Operands_Imm8& operands) { operands.imm = read_byte(); },
+     [&](Operands_Imm16& operands) { operands.imm = read16(); },
+     [&](Operands_Offset& operands) { operands.offset = static_cast<i8>(read_byte()); },
+     [&](Operands_Reg8_Imm8& operands) { operands.imm = read_byte(); },
+     [&](Operands_Reg16_Imm16& operands) { operands.imm = read16(); },
+     [&](Operands_Cond_Imm16& operands) { operands.imm = read16(); },
+     [&](Operands_Cond_Offset& operands) { operands.offset = static_cast<i8>(read_byte()); },
+     [&](Operands_SP_Imm16& operands) { operands.imm = read16(); },
+     [&](Operands_SP_Offset& operands) { operands.offset = static_cast<i8>(read_byte()); },
+     [&](Operands_Imm16_Ptr_Reg8& operands) { operands.addr = read16(); },
+     [&](Operands_Imm16_Ptr_SP& operands) { operands.addr = read16(); },
+     [&](Operands_Imm8_Ptr_Reg8& operands) { operands.addr = read_byte(); },
+     [&](Operands_Reg8_Imm8_Ptr& operands) { operands.addr = read_byte(); },
+     [&](Operands_Reg8_Imm16_Ptr& operands) { operands.addr = read16(); },
+     [&](Operands_Reg16_SP_Offset& operands) { operands.offset = static_cast<i8>(read_byte()); },
+     [&](Operands_Reg16_Ptr_Imm8& operands) { operands.imm = read_byte(); },
+     [&](auto& operands) { /* pass */ }
+  }, instr.operands);
+
+  return instr;
+}
+
+// Conditional branches stay inside a block, when taken the PC no longer
+// matches the next instruction and the CPU looks up the target instead.
+inline bool ends_block(const Instruction& instr) {
+  switch (instr.opcode) {
+  case Opcode::JR:
+  case Opcode::JP:
+  case Opcode::CALL:
+  case Opcode::RET:
+    return !std::holds_alternative<Operands_Cond_Offset>(instr.operands)
+      && !std::holds_alternative<Operands_Cond_Imm16>(instr.operands)
+      && !std::holds_alternative<Operands_Cond>(instr.operands);
+  case Opcode::RETI:
+  case Opcode::RST:
+  case Opcode::HALT:
+  case Opcode::STOP:
+    return true;
+  default:
+    return false;
+  }
+}
+
 inline void instr_load_reg8_reg8(Cpu& cpu, Reg8 r1, Reg8 r2) {
   cpu.GetRegisters().At(r1) = cpu.GetRegisters().Get(r2);
 }
@@ -143,25 +251,14 @@ inline void instr_pop_reg16(Cpu& cpu, Reg16 r1) {
 }
 
 inline u8 instr_add8(Cpu& cpu, u8 a, u8 b, u8 c) {
-  u8 result_half = (a & 0xf) + (b& 0xf) + c;
-  u16 result = a + b + c;
-
-  cpu.GetRegisters().Set(Flag::Z, (result & 0xff) == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, (result_half >> 4) & 0x1);
-  cpu.GetRegisters().Set(Flag::C, (result >> 8) & 0x1);
-
-  return (u8)result;
+  u32 result = a + b + c;
+  cpu.GetRegisters().SetFlags(FlagOp::kAdd8, result, a, b, c);
+  return result;
 }
 
 inline u16 instr_add16(Cpu& cpu, u16 a, u16 b) {
-  u16 result_half = (a & 0xfff) + (b & 0xfff);
   u32 result = a + b;
-
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, (result_half >> 12) & 0x1);
-  cpu.GetRegisters().Set(Flag::C, (result >> 16) & 0x1);
-
+  cpu.GetRegisters().SetFlags(FlagOp::kAdd16, result, a, b);
   return result;
 }
 
@@ -238,14 +335,8 @@ inline void instr_add_sp_offset(Cpu& cpu, i8 e) {
 }
 
 inline u8 instr_sub8(Cpu& cpu, u8 a, u8 b, u8 c) {
-  auto half_result = static_cast<i16>(a & 0xf) - (b & 0xf) - c;
-  auto result = static_cast<i16>(a) - b - c;
-
-  cpu.GetRegisters().Set(Flag::Z, (u8)result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 1);
-  cpu.GetRegisters().Set(Flag::H, half_result < 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::C, result < 0 ? 1 : 0);
-
+  u32 result = a - b - c;
+  cpu.GetRegisters().SetFlags(FlagOp::kSub8, result, a, b, c);
   return result;
 }
 
@@ -301,18 +392,14 @@ inline void instr_inc_reg8(Cpu& cpu, Reg8 r) {
   u8 val = cpu.GetRegisters().Get(r);
   u8 result = val + 1;
   cpu.GetRegisters().Set(r, result);
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, (val & 0xf) + 1 > 0xf ? 1 : 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kInc8, result, val);
 }
 
 inline void instr_inc_reg16_ptr(Cpu& cpu, Reg16 r) {
   u8 val = cpu.Read8(cpu.GetRegisters().Get(r));
   u8 result = val + 1;
   cpu.Write8(cpu.GetRegisters().Get(r), result);
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, (val & 0xf) + 1 > 0xf ? 1 : 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kInc8, result, val);
 }
 
 inline void instr_inc_sp(Cpu& cpu) {
@@ -329,18 +416,14 @@ inline void instr_dec_reg8(Cpu& cpu, Reg8 r) {
   u8 val = cpu.GetRegisters().Get(r);
   u8 result = val - 1;
   cpu.GetRegisters().At(r) = result;
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 1);
-  cpu.GetRegisters().Set(Flag::H, (val & 0xf) == 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kDec8, result, val);
 }
 
 inline void instr_dec_reg16_ptr(Cpu& cpu, Reg16 r) {
   u8 val = cpu.Read8(cpu.GetRegisters().Get(r));
   u8 result = val - 1;
   cpu.Write8(cpu.GetRegisters().Get(r), result);
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 1);
-  cpu.GetRegisters().Set(Flag::H, (val & 0xf) == 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kDec8, result, val);
 }
 
 inline void instr_dec_sp(Cpu& cpu) {
@@ -355,74 +438,47 @@ inline void instr_dec_reg16(Cpu& cpu, Reg16 r) {
 
 inline void instr_and_reg8(Cpu& cpu, Reg8 r) {
   auto result = cpu.GetRegisters().At(Reg8::A) &= cpu.GetRegisters().Get(r);
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, 1);
-  cpu.GetRegisters().Set(Flag::C, 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kAnd, result);
 }
 
 inline void instr_and_reg16_ptr(Cpu& cpu, Reg16 r) {
   auto result = cpu.GetRegisters().At(Reg8::A) &= cpu.Read8(cpu.GetRegisters().Get(r));
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, 1);
-  cpu.GetRegisters().Set(Flag::C, 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kAnd, result);
 }
 
 inline void instr_and_imm8(Cpu& cpu, u8 imm) {
   auto result = cpu.GetRegisters().At(Reg8::A) &= imm;
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, 1);
-  cpu.GetRegisters().Set(Flag::C, 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kAnd, result);
 }
 
 inline void instr_or_reg8(Cpu& cpu, Reg8 r) {
   auto result = cpu.GetRegisters().At(Reg8::A) |= cpu.GetRegisters().Get(r);
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, 0);
-  cpu.GetRegisters().Set(Flag::C, 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kOr, result);
 }
 
 inline void instr_or_reg16_ptr(Cpu& cpu, Reg16 r) {
   auto result = cpu.GetRegisters().At(Reg8::A) |= cpu.Read8(cpu.GetRegisters().Get(r));
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, 0);
-  cpu.GetRegisters().Set(Flag::C, 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kOr, result);
 }
 
 inline void instr_or_imm8(Cpu& cpu, u8 imm) {
   auto result = cpu.GetRegisters().At(Reg8::A) |= imm;
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, 0);
-  cpu.GetRegisters().Set(Flag::C, 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kOr, result);
 }
 
 inline void instr_xor_reg8(Cpu& cpu, Reg8 r) {
   auto result = cpu.GetRegisters().At(Reg8::A) ^= cpu.GetRegisters().Get(r);
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, 0);
-  cpu.GetRegisters().Set(Flag::C, 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kOr, result);
 }
 
 inline void instr_xor_reg16_ptr(Cpu& cpu, Reg16 r) {
   auto result = cpu.GetRegisters().At(Reg8::A) ^= cpu.Read8(cpu.GetRegisters().Get(r));
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, 0);
-  cpu.GetRegisters().Set(Flag::C, 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kOr, result);
 }
 
 inline void instr_xor_imm8(Cpu& cpu, u8 imm) {
   auto result = cpu.GetRegisters().At(Reg8::A) ^= imm;
-  cpu.GetRegisters().Set(Flag::Z, result == 0 ? 1 : 0);
-  cpu.GetRegisters().Set(Flag::N, 0);
-  cpu.GetRegisters().Set(Flag::H, 0);
-  cpu.GetRegisters().Set(Flag::C, 0);
+  cpu.GetRegisters().SetFlags(FlagOp::kOr, result);
 }
 
 inline void instr_ccf(Cpu& cpu) {
@@ -1143,7 +1199,9 @@ void execute_ei(Cpu& cpu, Mmu& mmu, Instruction& instr) {
 void Cpu::Init(CpuConfig cfg) {
   mmu_ = cfg.mmu;
   interrupts_ = cfg.interrupts;
+  input_ = cfg.input;
   test_ = cfg.test;
+  SetCore(cfg.core);
 }
 
 u8 Cpu::Execute() {
@@ -1164,11 +1222,16 @@ u8 Cpu::Execute() {
     }
   }
 
+  total_ticks_ += tick_counter;
   tick_counter = 0;
 
-  auto interrupt_cycles = ExecuteInterrupts();
-  if (interrupt_cycles) {
-    return interrupt_cycles;
+  // Nothing to do before the instruction unless EI just took effect or an
+  // interrupt is pending.
+  if (state_.ime_trigger || interrupts_->HasPendingInterrupt()) {
+    auto interrupt_cycles = ExecuteInterrupts();
+    if (interrupt_cycles) {
+      return interrupt_cycles;
+    }
   }
 
   if (state_.halt) {
@@ -1176,58 +1239,22 @@ u8 Cpu::Execute() {
     return 4;
   }
 
-  auto logger = spdlog::get("doctor_logger");
-  if (logger) {
-    auto a = regs_.Get(Reg8::A);
-    auto f = regs_.Get(Reg8::F);
-    auto b = regs_.Get(Reg8::B);
-    auto c = regs_.Get(Reg8::C);
-    auto d = regs_.Get(Reg8::D);
-    auto e = regs_.Get(Reg8::E);
-    auto h = regs_.Get(Reg8::H);
-    auto l = regs_.Get(Reg8::L);
-    auto pc = regs_.pc;
-    auto sp = regs_.sp;
-
-    auto mem = std::to_array<u8>({
-      mmu_->Read8(pc),
-      mmu_->Read8(pc + 1),
-      mmu_->Read8(pc + 2),
-      mmu_->Read8(pc + 3),
-    });
-
-    logger->info("A:{:02X} F:{:02X} B:{:02X} C:{:02X} D:{:02X} E:{:02X} H:{:02X} L:{:02X} SP:{:04X} PC:{:04X} PCMEM:{:02X},{:02X},{:02X},{:02X}",
-      a, f, b, c, d, e, h, l, sp, pc, mem[0], mem[1], mem[2], mem[3]);
+  if (tracer_) {
+    TraceInstruction();
   }
 
-  u8 byte_code = ReadNext8();
-  Instruction instr = Decoder::Decode(byte_code);
-
-  if (instr.opcode == Opcode::PREFIX) {
-    byte_code = ReadNext8();
-    instr = Decoder::DecodePrefixed(byte_code);
+  Instruction instr;
+  const auto* cached = core_ != CpuCore::kInterpreter ? FetchCached() : nullptr;
+  if (cached) {
+    instr = *cached;
+  } else {
+    instr = FetchInstruction();
   }
 
-  std::visit(overloaded{
-     [&](Operands_Imm8& operands) { operands.imm = ReadNext8(); },
-     [&](Operands_Imm16& operands) { operands.imm = ReadNext16(); },
-     [&](Operands_Offset& operands) { operands.offset = static_cast<i8>(ReadNext8()); },
-     [&](Operands_Reg8_Imm8& operands) { operands.imm = ReadNext8(); },
-     [&](Operands_Reg16_Imm16& operands) { operands.imm =ReadNext16(); },
-     [&](Operands_Cond_Imm16& operands) { operands.imm = ReadNext16(); },
-     [&](Operands_Cond_Offset& operands) { operands.offset = static_cast<i8>(ReadNext8()); },
-     [&](Operands_SP_Imm16& operands) { operands.imm = ReadNext16(); },
-     [&](Operands_SP_Offset& operands) { operands.offset = static_cast<i8>(ReadNext8()); },
-     [&](Operands_Imm16_Ptr_Reg8& operands) { operands.addr = ReadNext16(); },
-     [&](Operands_Imm16_Ptr_SP& operands) { operands.addr = ReadNext16(); },
-     [&](Operands_Imm8_Ptr_Reg8& operands) { operands.addr = ReadNext8(); },
-     [&](Operands_Reg8_Imm8_Ptr& operands) { operands.addr = ReadNext8(); },
-     [&](Operands_Reg8_Imm16_Ptr& operands) { operands.addr = ReadNext16(); },
-     [&](Operands_Reg16_SP_Offset& operands) { operands.offset = static_cast<i8>(ReadNext8()); },
-     [&](Operands_Reg16_Ptr_Imm8& operands) { operands.imm = ReadNext8(); },
-     [&](auto& operands) { /* pass */ }
-  }, instr.operands);
+  return ExecuteInstruction(instr);
+}
 
+u8 Cpu::ExecuteInstruction(Instruction& instr) {
   auto cycles = instr.cycles;
   auto& mmu = *(this->mmu_);
 
@@ -1314,100 +1341,741 @@ u8 Cpu::ExecuteInterrupts() {
     return 0;
   }
 
-  for (int i = 0; i < std::to_underlying(Interrupt::Count); i++) {
-    Interrupt interrupt { i };
-    if (interrupts_->IsInterruptRequested(interrupt)) {
-      state_.halt = false;
-      if (!ime_state) {
-        return 0;
-      }
+  u8 pending = interrupts_->Pending();
+  if (!pending) {
+    return 0;
+  }
+
+  state_.halt = false;
+  if (!ime_state) {
+    return 0;
+  }
 
-      state_.ime = false;
+  state_.ime = false;
 
-      Tick();
-      Tick();
+  Tick();
+  Tick();
+
+  // Pushing the high byte of PC can overwrite IE, the handler is picked again
+  // afterwards from the one that was taken and those of lower priority.
+  int i = std::countr_zero(pending);
+  Write8(--regs_.sp, regs_.pc >> 8);
+  pending = interrupts_->Pending() & (0xff << i);
+
+  Write8(--regs_.sp, regs_.pc & 0xff);
+  if (pending) {
+    Interrupt interrupt { std::countr_zero(pending) };
+    regs_.pc = interrupt_handler(interrupt);
+    interrupts_->ClearInterrupt(interrupt);
+  } else {
+    regs_.pc = 0;
+  }
+
+  Tick();
 
-      Write8(--regs_.sp, regs_.pc >> 8);
-      bool is_cancelled = true;
-      while (i < std::to_underlying(Interrupt::Count)) {
-        interrupt = Interrupt{i};
-        if (interrupts_->IsInterruptRequested(interrupt)) {
-          is_cancelled = false;
-          break;
-        }
-        i++;
+  state_.ime = false;
+  return 20;
+}
+
+// Runs the CPU for up to max_cycles while it idles in HALT or runs a known
+// loop (see loop_idioms.hpp), polling for the PPU or an interrupt handler or
+// copying and filling memory. HALT and a polling loop that came back to the
+// same registers jump straight to the next device event (see
+// SyncedDevice::IdleTicks), copies and fills move the bytes up to it in bulk,
+// anything else skips the per instruction work of Execute. It stops at the instruction boundary where Execute would next take
+// an interrupt or run past max_cycles, so the result is identical. Returns 0
+// when the CPU is not idle.
+u32 Cpu::FastForward(u32 max_cycles) {
+  ZoneScoped;
+
+  const bool in_loop = block_ && block_->loop && regs_.pc == block_->pc;
+  if (!state_.halt && !in_loop) {
+    return core_ == CpuCore::kJit ? RunCompiled(max_cycles) : 0;
+  }
+  if (state_.stop || state_.ime_trigger) {
+    return 0;
+  }
+
+  u32 cycles = 0;
+  if (state_.halt) {
+    while (state_.halt && cycles < max_cycles && !interrupts_->HasPendingInterrupt()) {
+      const u32 m_cycles = std::min(IdleTicks(), (max_cycles - cycles + 3) / 4);
+      if (!m_cycles) {
+        Tick();
+        cycles += 4;
+        continue;
       }
+      TickIdle(m_cycles);
+      cycles += 4 * m_cycles;
+    }
+    return cycles;
+  }
 
-      Write8(--regs_.sp, regs_.pc & 0xff);
-      if (!is_cancelled) {
-        regs_.pc = interrupt_handler(interrupt);
-        interrupts_->ClearInterrupt(interrupt);
-      } else {
-        regs_.pc = 0;
+  // Every instruction has to reach the trace.
+  if (tracer_) {
+    return 0;
+  }
+
+  // Writes can invalidate the block or switch banks, both clear block_. A
+  // write to HDMA5 halts the CPU for the transfer.
+  const bool polling = block_->loop->idiom == LoopIdiom::kPolling;
+  Registers iteration_regs = regs_;
+  u32 iteration_start = 0;
+  u32 iteration_idle = 0;
+  block_index_ = 0;
+  while (block_ && !state_.halt && cycles < max_cycles && !(state_.ime && interrupts_->HasPendingInterrupt())) {
+    if (block_index_ >= block_->loop->steps.size() || regs_.pc != block_pc_) {
+      if (regs_.pc != block_->pc) {
+        break;
       }
+      block_index_ = 0;
+      // Only devices change what the loop reads (see loop_idioms::Match), so
+      // an iteration without a device event that came back to the same
+      // registers goes around the same way until the next one.
+      if (polling && regs_ == iteration_regs && u64{iteration_idle} * 4 >= cycles - iteration_start) {
+        cycles += SkipIterations(cycles - iteration_start, max_cycles - cycles);
+      } else if (!polling) {
+        cycles += RunTransfer(cycles - iteration_start, max_cycles - cycles);
+      }
+      if (!block_ || cycles >= max_cycles) {
+        break;
+      }
+      iteration_regs = regs_;
+      iteration_start = cycles;
+      iteration_idle = polling ? IdleTicks() : 0;
+    }
 
+    auto instr = block_->instructions[block_index_];
+    block_index_ += 1;
+    for (u8 i = 0; i < instr.bytes; i += 1) {
       Tick();
+    }
+    regs_.pc += instr.bytes;
+    block_pc_ = regs_.pc;
+    cycles += ExecuteInstruction(instr);
+  }
+  return cycles;
+}
+
+// Runs compiled blocks for up to max_cycles, compiling them on first use. Like
+// FastForward it stops at the instruction boundary where Execute would do
+// more than run the next instruction. Blocks Execute is part way through,
+// known loops and blocks that are not compiled are left to Execute and
+// FastForward. Returns 0 when nothing ran.
+u32 Cpu::RunCompiled(u32 max_cycles) {
+  ZoneScoped;
+
+  // Every instruction has to reach the trace.
+  if (tracer_) {
+    return 0;
+  }
 
-      state_.ime = false;
-      return 20;
+  u32 cycles = 0;
+  while (cycles < max_cycles && CanRunCompiled()) {
+    if (block_ && regs_.pc == block_pc_ && block_index_ > 0 && block_index_ < block_->instructions.size()) {
+      break;
+    }
+    auto* block = LookupBlock(regs_.pc);
+    if (!block || block->loop || !Compile(*block)) {
+      break;
     }
+
+    block_ = block;
+    block_index_ = 0;
+    block_pc_ = regs_.pc;
+    total_ticks_ += tick_counter;
+    tick_counter = 0;
+    cycles += verify_cache_ ? RunVerified(*block, max_cycles - cycles) : block->jit(this, &regs_, max_cycles - cycles);
+  }
+  return cycles;
+}
+
+// Runs a compiled block, then the interpreter from the same registers over
+// the reads the block made, and compares the registers, state, cycles and
+// writes of both. Devices only run once, the replay just counts its ticks.
+// On a difference the interpreter's registers and state win and the block is
+// left to the interpreter from then on.
+u32 Cpu::RunVerified(const CodeBlock& block, u32 max_cycles) {
+  ZoneScoped;
+
+  for (size_t i = 0, offset = 0; i < block.instructions.size(); offset += block.instructions[i].bytes, i += 1) {
+    if (!VerifyCached(block, block.instructions[i], static_cast<u16>(block.pc + offset))) {
+      return 0;
+    }
+  }
+  // Writes to test memory can drop the block while it runs.
+  const u16 block_start = block.pc;
+  const auto key = BlockCache::Key(block_start, mmu_->GetBankKey(block_start));
+  const auto code = block.code;
+
+  const Registers start_regs = regs_;
+  const CpuState start_state = state_;
+  const u8 start_key1 = key1_;
+  const u64 start_ticks = tick_counter;
+
+  bus_accesses_.clear();
+  bus_log_ = BusLog::kRecord;
+  const u32 cycles = block.jit(this, &regs_, max_cycles);
+  bus_log_ = BusLog::kOff;
+
+  const Registers jit_regs = regs_;
+  const CpuState jit_state = state_;
+  const u8 jit_key1 = key1_;
+  const u64 jit_ticks = tick_counter;
+  const auto* jit_block = block_;
+  const size_t executed = block_index_;
+  const u16 jit_block_pc = block_pc_;
+
+  regs_ = start_regs;
+  state_ = start_state;
+  key1_ = start_key1;
+  tick_counter = start_ticks;
+  auto devices = std::exchange(synced_devices, {});
+  bus_log_ = BusLog::kReplay;
+  bus_replayed_ = 0;
+  bus_diverged_ = false;
+
+  u32 replay_cycles = 0;
+  size_t offset = 0;
+  for (size_t i = 0; i < executed; i += 1) {
+    auto instr = decode_instruction([&] {
+      regs_.pc += 1;
+      Tick();
+      return code[offset++];
+    });
+    replay_cycles += ExecuteInstruction(instr);
   }
 
-  return 0;
+  bus_log_ = BusLog::kOff;
+  synced_devices = std::move(devices);
+  const bool same_state = state_.ime == jit_state.ime && state_.ime_trigger == jit_state.ime_trigger
+    && state_.halt == jit_state.halt && state_.stop == jit_state.stop && key1_ == jit_key1;
+  const bool same_accesses = !bus_diverged_ && bus_replayed_ == bus_accesses_.size();
+  const bool same = regs_ == jit_regs && same_state && same_accesses
+    && replay_cycles == cycles && tick_counter == jit_ticks;
+
+  block_ = jit_block;
+  block_index_ = executed;
+  block_pc_ = jit_block_pc;
+  tick_counter = jit_ticks;
+  if (!same) {
+    cache_mismatches_ += 1;
+    const auto describe = [](const Registers& regs, u32 run_cycles) {
+      return std::format("AF={:04X} BC={:04X} DE={:04X} HL={:04X} SP={:04X} PC={:04X} in {} cycles",
+        regs.Get(Reg16::AF), regs.Get(Reg16::BC), regs.Get(Reg16::DE), regs.Get(Reg16::HL), regs.sp, regs.pc, run_cycles);
+    };
+    spdlog::error("Compiled block at {:04X} differs from the interpreter after {} instructions: "
+      "compiled {}, interpreted {}, {} data accesses {}",
+      block_start, executed, describe(jit_regs, cycles), describe(regs_, replay_cycles), bus_accesses_.size(),
+      same_accesses ? "match" : "differ");
+    if (auto* dropped = block_cache_.Find(key)) {
+      dropped->interpret = true;
+    }
+    return cycles;
+  }
+  regs_ = jit_regs;
+  return cycles;
+}
+
+// Whether Execute would run the next instruction right away.
+bool Cpu::CanRunCompiled() const {
+  return !state_.halt && !state_.stop && !state_.ime_trigger && !(state_.ime && interrupts_->HasPendingInterrupt());
+}
+
+// Code in RAM can be rewritten or be timing-sensitive, like the OAM DMA
+// routines in HRAM, so only ROM is compiled. Test memory is all RAM.
+bool Cpu::Compile(CodeBlock& block) {
+  if (block.jit) {
+    return true;
+  }
+  if (block.interpret || (!test_ && block.pc > kRomBank01End)) {
+    block.interpret = true;
+    return false;
+  }
+
+  static constexpr JitHooks kHooks {
+    .fetch = &Cpu::JitFetch,
+    .execute = &Cpu::JitExecute,
+    .tick = &Cpu::JitTick,
+    .next = &Cpu::JitNext,
+  };
+  block.jit = jit_.Compile(block, kHooks);
+  if (!block.jit) {
+    // Out of room for code, start over. Blocks get compiled again as they run.
+    block_cache_.Clear();
+    jit_.Clear();
+    block_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void Cpu::JitFetch(Cpu* cpu, u32 bytes) {
+  cpu->block_index_ += 1;
+  for (u32 i = 0; i < bytes; i += 1) {
+    cpu->Tick();
+  }
+  cpu->regs_.pc += bytes;
+  cpu->block_pc_ = cpu->regs_.pc;
+}
+
+u32 Cpu::JitExecute(Cpu* cpu, const Instruction* instr) {
+  // A write can drop the block the instruction lives in.
+  auto copy = *instr;
+  return cpu->ExecuteInstruction(copy);
+}
+
+void Cpu::JitTick(Cpu* cpu) {
+  cpu->Tick();
+}
+
+// Jumps and writes that switch banks or invalidate the block leave it.
+bool Cpu::JitNext(Cpu* cpu) {
+  return cpu->CanRunCompiled() && cpu->block_ && cpu->regs_.pc == cpu->block_pc_;
+}
+
+u8 Cpu::LogRead8(u16 addr) {
+  if (bus_log_ == BusLog::kRecord) {
+    const u8 result = ReadBus8(addr);
+    bus_accesses_.push_back({addr, result, false});
+    Tick();
+    return result;
+  }
+
+  Tick();
+  if (bus_replayed_ >= bus_accesses_.size()) {
+    bus_diverged_ = true;
+    return 0xFF;
+  }
+  const auto& access = bus_accesses_[bus_replayed_];
+  bus_diverged_ |= access.write || access.addr != addr;
+  bus_replayed_ += 1;
+  return access.value;
+}
+
+void Cpu::LogWrite8(u16 addr, u8 val) {
+  if (bus_log_ == BusLog::kRecord) {
+    bus_accesses_.push_back({addr, val, true});
+    return;
+  }
+
+  Tick();
+  if (bus_replayed_ >= bus_accesses_.size()) {
+    bus_diverged_ = true;
+    return;
+  }
+  const auto& access = bus_accesses_[bus_replayed_];
+  bus_diverged_ |= !access.write || access.addr != addr || access.value != val;
+  bus_replayed_ += 1;
+  // KEY0 and KEY1 live in the CPU, the replay has to write those itself.
+  const bool cpu_register = addr == std::to_underlying(IO::KEY0) || addr == std::to_underlying(IO::KEY1);
+  if (cpu_register && hardware_mode_ == HardwareMode::kCgbMode && !test_) {
+    WriteBus8(addr, val);
+  }
+}
+
+// The M-cycles every synced device can be advanced through in one batch.
+u32 Cpu::IdleTicks() const {
+  u32 m_cycles = SyncedDevice::kIdleForever;
+  for (const auto* device : synced_devices) {
+    m_cycles = std::min(m_cycles, device->IdleTicks(state_.double_speed));
+  }
+  return m_cycles;
+}
+
+// Same as m_cycles calls to Tick, m_cycles must not exceed IdleTicks.
+void Cpu::TickIdle(u32 m_cycles) {
+  ZoneScoped;
+  for (auto& device : synced_devices) {
+    device->OnTicks(m_cycles, state_.double_speed);
+  }
+  tick_counter += u64{4} * m_cycles;
+}
+
+// Runs as many whole iterations of iteration_cycles as fit in max_cycles
+// before a device event, for a loop that leaves the CPU as it found it.
+// Returns the cycles skipped.
+u32 Cpu::SkipIterations(u32 iteration_cycles, u32 max_cycles) {
+  if (!iteration_cycles) {
+    return 0;
+  }
+  const u64 iterations = std::min<u64>(u64{IdleTicks()} * 4, max_cycles) / iteration_cycles;
+  if (!iterations) {
+    return 0;
+  }
+  TickIdle(static_cast<u32>(iterations * iteration_cycles / 4));
+  return static_cast<u32>(iterations * iteration_cycles);
+}
+
+// Runs whole iterations of the copy or fill loop at block_ in one go, as many
+// as fit in max_cycles before a device event and short of the one that ends
+// the loop, while its stores stay in VRAM, WRAM or HRAM and clear of its code
+// and its source. Leaves memory, registers and flags as the iterations would
+// have, the iteration a device event falls in runs normally. PPU mode changes
+// are device events, so VRAM stores never straddle one. Returns the cycles
+// run.
+u32 Cpu::RunTransfer(u32 iteration_cycles, u32 max_cycles) {
+  ZoneScoped;
+
+  if (!iteration_cycles || watchpoints_) {
+    return 0;
+  }
+
+  const auto& transfer = block_->loop->transfer;
+  const bool copy = transfer.src == LoopOperand::kHl || transfer.src == LoopOperand::kDe;
+  if (copy && transfer.dst_step < 0) {
+    return 0;
+  }
+
+  // DEC B or DEC C, DEC BC otherwise.
+  const auto dec = std::ranges::find(block_->instructions, Opcode::DEC, &Instruction::opcode);
+  const auto* counter = std::get_if<Operands_Reg8>(&dec->operands);
+  const u32 count = counter ? regs_.Get(counter->reg) : regs_.Get(Reg16::BC);
+  const u32 wrapped_count = count ? count : (counter ? 0x100 : 0x10000);
+
+  const u16 dst = regs_.Get(PointerRegister(transfer.dst));
+  const u16 src = copy ? regs_.Get(PointerRegister(transfer.src)) : 0;
+  u64 iterations = std::min<u64>(u64{IdleTicks()} * 4, max_cycles) / iteration_cycles;
+  iterations = std::min<u64>(iterations, wrapped_count - 1);
+  iterations = std::min<u64>(iterations, TransferExtent(dst, transfer.dst_step, true));
+  if (copy) {
+    iterations = std::min<u64>(iterations, TransferExtent(src, 1, false));
+  }
+  if (!iterations) {
+    return 0;
+  }
+
+  const u16 size = static_cast<u16>(iterations);
+  const u16 dst_first = transfer.dst_step > 0 ? dst : dst - size + 1;
+  if (Overlaps(dst_first, size, block_->pc, block_->end - block_->pc) || (copy && Overlaps(dst_first, size, src, size))) {
+    return 0;
+  }
+
+  std::array<u8, kTransferChunkSize> buffer;
+  u8 last = 0;
+  for (u16 offset = 0; offset < size;) {
+    const auto bytes = std::span(buffer).first(std::min<size_t>(size - offset, buffer.size()));
+    if (copy) {
+      mmu_->ReadSpan(src + offset, bytes);
+    } else {
+      std::ranges::fill(bytes, transfer.src == LoopOperand::kA ? regs_.Get(Reg8::A) : 0);
+    }
+    mmu_->WriteSpan(dst_first + offset, bytes);
+    last = bytes.back();
+    offset += bytes.size();
+  }
+  for (u16 i = 0; i < size; i += 1) {
+    InvalidateCode(dst_first + i);
+  }
+
+  if (copy) {
+    regs_.Set(PointerRegister(transfer.src), src + size);
+  }
+  regs_.Set(PointerRegister(transfer.dst), dst + transfer.dst_step * size);
+  if (counter) {
+    // Nothing but the DEC touches the flags, A holds the last byte copied.
+    const u8 remaining = count - size;
+    regs_.Set(counter->reg, remaining);
+    if (copy) {
+      regs_.Set(Reg8::A, last);
+    }
+    regs_.SetFlags(FlagOp::kDec8, remaining, static_cast<u8>(remaining + 1));
+  } else {
+    // LD A,B / OR C, or the other way around, ends every iteration.
+    const u16 remaining = count - size;
+    const u8 a = (remaining >> 8) | (remaining & 0xff);
+    regs_.Set(Reg16::BC, remaining);
+    regs_.Set(Reg8::A, a);
+    regs_.SetFlags(FlagOp::kOr, a);
+  }
+
+  TickIdle(static_cast<u32>(iterations * iteration_cycles / 4));
+  return static_cast<u32>(iterations * iteration_cycles);
+}
+
+Instruction Cpu::FetchInstruction() {
+  return decode_instruction([this] {
+    return ReadNext8();
+  });
+}
+
+// Returns the next instruction from the current block, or from the block at
+// PC, after spending the cycles its fetch would have taken. Returns nullptr
+// where the PC is not cacheable and the instruction has to be fetched.
+const Instruction* Cpu::FetchCached() {
+  ZoneScoped;
+
+  if (!block_ || regs_.pc != block_pc_ || block_index_ >= block_->instructions.size()) {
+    block_ = LookupBlock(regs_.pc);
+    block_index_ = 0;
+    if (!block_) {
+      return nullptr;
+    }
+  }
+
+  const auto& instr = block_->instructions[block_index_];
+  if (verify_cache_ && !VerifyCached(*block_, instr, regs_.pc)) {
+    return nullptr;
+  }
+  block_index_ += 1;
+  for (u8 i = 0; i < instr.bytes; i += 1) {
+    Tick();
+  }
+  regs_.pc += instr.bytes;
+  block_pc_ = regs_.pc;
+  return &instr;
+}
+
+CodeBlock* Cpu::LookupBlock(u16 pc) {
+  if (!IsCacheable(pc)) {
+    return nullptr;
+  }
+
+  const auto key = BlockCache::Key(pc, mmu_->GetBankKey(pc));
+  auto* block = block_cache_.Find(key);
+  if (!block) {
+    block = &block_cache_.Insert(key, DecodeBlock(pc), test_ || pc > kRomBank01End);
+  }
+  // Empty blocks are kept too, so an instruction that cannot be cached (one
+  // crossing a page) is not decoded twice every time.
+  return block->instructions.empty() ? nullptr : block;
+}
+
+CodeBlock Cpu::DecodeBlock(u16 pc) const {
+  ZoneScoped;
+
+  CodeBlock block {
+    .pc = pc,
+    .end = pc,
+  };
+
+  u32 addr = pc;
+  while (block.instructions.size() < kMaxBlockInstructions) {
+    u32 size = 0;
+    auto instr = decode_instruction([&] {
+      return mmu_->Read8(static_cast<u16>(addr + size++));
+    });
+
+    const u32 last = addr + size - 1;
+    if ((last >> 8) != (addr >> 8) || !IsCacheable(static_cast<u16>(last))) {
+      break;
+    }
+
+    instr.bytes = static_cast<u8>(size);
+    block.instructions.push_back(instr);
+    for (u32 i = 0; i < size; i += 1) {
+      block.code.push_back(mmu_->Read8(static_cast<u16>(addr + i)));
+    }
+    addr += size;
+    block.end = addr;
+
+    if (ends_block(instr)) {
+      break;
+    }
+  }
+
+  block.loop = loop_idioms::Match(block);
+  return block;
+}
+
+// ROM, WRAM and HRAM. VRAM, cartridge RAM and OAM rarely hold code and IO
+// reads can have side effects, those are always fetched.
+bool Cpu::IsCacheable(u16 addr) const {
+  if (test_) {
+    return true;
+  }
+  return addr <= kRomBank01End || (addr >= kWramStart && addr <= kWramEnd) || (addr >= kHramStart && addr <= kHramEnd);
+}
+
+// Compares the bytes the cached instruction was decoded from with what the
+// interpreter would fetch. A mismatch means a write got past InvalidateCode,
+// so the whole cache is dropped rather than trusting any of it.
+bool Cpu::VerifyCached(const CodeBlock& block, const Instruction& instr, u16 pc) {
+  const size_t offset = pc - block.pc;
+  for (u8 i = 0; i < instr.bytes; i += 1) {
+    const u16 addr = pc + i;
+    const u8 expected = mmu_->Read8(addr);
+    if (block.code[offset + i] == expected) {
+      continue;
+    }
+
+    cache_mismatches_ += 1;
+    spdlog::error("Cached code at {:04X} is stale: {:02X} in cache, {:02X} in memory at {:04X}",
+      pc, block.code[offset + i], expected, addr);
+    block_cache_.Clear();
+    jit_.Clear();
+    block_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+CpuCore Cpu::GetCore() const {
+  return core_;
+}
+
+void Cpu::SetCore(CpuCore core) {
+  if (core == CpuCore::kJit && !Jit::IsSupported()) {
+    spdlog::warn("The JIT core is not available on this platform, using the cached core");
+    core = CpuCore::kCached;
+  }
+  core_ = core;
+  block_cache_.Clear();
+  jit_.Clear();
+  block_ = nullptr;
+}
+
+void Cpu::SetVerifyCache(bool verify) {
+  verify_cache_ = verify;
+  cache_mismatches_ = 0;
+}
+
+bool Cpu::IsVerifyingCache() const {
+  return verify_cache_;
+}
+
+size_t Cpu::GetCacheMismatches() const {
+  return cache_mismatches_;
+}
+
+void Cpu::InvalidateCode(u16 addr) {
+  if (block_cache_.HasCodeInPage(addr) && block_cache_.Invalidate(addr)) {
+    block_ = nullptr;
+  }
+  // A write to echo RAM changes the WRAM byte it mirrors, whose blocks are
+  // cached under C000-DDFF, and the reverse.
+  u16 mirror = 0;
+  if (addr >= kEchoRamStart && addr <= kEchoRamEnd) {
+    mirror = addr - kEchoRamOffset;
+  } else if (addr >= kWramStart && addr <= kEchoRamEnd - kEchoRamOffset) {
+    mirror = addr + kEchoRamOffset;
+  } else {
+    return;
+  }
+  if (block_cache_.HasCodeInPage(mirror) && block_cache_.Invalidate(mirror)) {
+    block_ = nullptr;
+  }
 }
 
 u8 Cpu::ReadNext8() {
   ZoneScoped;
-  return Read8(regs_.pc++);
+  u8 result = ReadBus8(regs_.pc++);
+  Tick();
+  return result;
 }
 
 u16 Cpu::ReadNext16() {
   ZoneScoped;
-  auto lo = Read8(regs_.pc++);
-  auto hi = Read8(regs_.pc++);
+  auto lo = ReadNext8();
+  auto hi = ReadNext8();
   auto result = lo | (hi << 8);
   return result;
 }
 
+void Cpu::SetTracer(TraceRecorder* tracer) {
+  tracer_ = tracer;
+}
+
+void Cpu::SetWatchpoints(const Watchpoints* watchpoints) {
+  watchpoints_ = watchpoints;
+  watch_hit_.reset();
+}
+
+std::optional<WatchHit> Cpu::TakeWatchHit() {
+  return std::exchange(watch_hit_, std::nullopt);
+}
+
+void Cpu::TraceInstruction() {
+  const u16 pc = regs_.pc;
+  trace::TraceRecord record {
+    .cycle = total_ticks_ + tick_counter,
+    .pc = pc,
+    .bank = static_cast<u16>(mmu_->GetBankKey(pc)),
+    .sp = regs_.sp,
+  };
+  for (int i = 0; i < std::to_underlying(Reg8::Count); i += 1) {
+    record.regs[i] = regs_.Get(Reg8{i});
+  }
+  for (u16 i = 0; i < record.code.size(); i += 1) {
+    record.code[i] = mmu_->Read8(pc + i);
+  }
+  tracer_->Record(record);
+}
+
 void Cpu::Reset() {
   hardware_mode_ = HardwareMode::kDmgMode;
   regs_.Reset();
   state_.Reset();
+  tick_counter = 0;
+  total_ticks_ = 0;
+  watch_hit_.reset();
   key0_ = 0;
   key1_ = 0;
+  // The cartridge and memory are replaced after a reset.
+  block_cache_.Clear();
+  jit_.Clear();
+  block_ = nullptr;
 }
 
 u8 Cpu::Read8(u16 addr) {
   ZoneScoped;
-
-  u8 result;
-  if (test_) {
-    result = mmu_->Read8(addr);
-  } else {
-    switch (addr) {
-      case std::to_underlying(IO::KEY0): result = hardware_mode_ == HardwareMode::kDmgMode ? 0xFF : key0_; break;
-      case std::to_underlying(IO::KEY1): result = hardware_mode_ == HardwareMode::kDmgMode ? 0xFF : key1_; break;
-      default: result = mmu_->Read8(addr); break;
-    }
+  // Instruction fetches skip the watchpoints.
+  if (watchpoints_ && watchpoints_->IsWatched(addr, false)) [[unlikely]] {
+    watch_hit_ = WatchHit{addr, false};
   }
+  if (bus_log_ != BusLog::kOff) [[unlikely]] {
+    return LogRead8(addr);
+  }
+  u8 result = ReadBus8(addr);
   Tick();
   return result;
 }
 
 void Cpu::Write8(u16 addr, u8 val) {
   ZoneScoped;
-  if (test_) {
-    mmu_->Write8(addr, val);
-  } else {
-    switch (addr) {
-      case std::to_underlying(IO::KEY0): key0_ = val; break;
-      case std::to_underlying(IO::KEY1): key1_ = val; break;
-      default: mmu_->Write8(addr, val); break;
+  if (watchpoints_ && watchpoints_->IsWatched(addr, true)) [[unlikely]] {
+    watch_hit_ = WatchHit{addr, true};
+  }
+  if (bus_log_ != BusLog::kOff) [[unlikely]] {
+    LogWrite8(addr, val);
+    if (bus_log_ == BusLog::kReplay) {
+      return;
     }
   }
+  WriteBus8(addr, val);
+  InvalidateCode(addr);
+  // Bank switches change what the rest of the current block maps to.
+  if (addr <= kRomBank01End || addr == std::to_underlying(IO::BOOT) || addr == std::to_underlying(IO::SVBK)) {
+    block_ = nullptr;
+  }
   Tick();
 }
 
+// KEY0 and KEY1 live in the CPU, and only exist in CGB mode.
+u8 Cpu::ReadBus8(u16 addr) {
+  if (addr == std::to_underlying(IO::P1) && input_) [[unlikely]] {
+    input_->OnCpuRead();
+  }
+  if (hardware_mode_ == HardwareMode::kCgbMode && !test_) {
+    switch (addr) {
+      case std::to_underlying(IO::KEY0): return key0_;
+      case std::to_underlying(IO::KEY1): return key1_;
+      default: break;
+    }
+  }
+  return mmu_->Read8(addr);
+}
+
+void Cpu::WriteBus8(u16 addr, u8 val) {
+  if (hardware_mode_ == HardwareMode::kCgbMode && !test_) {
+    switch (addr) {
+      case std::to_underlying(IO::KEY0): key0_ = val; return;
+      case std::to_underlying(IO::KEY1): key1_ = val; return;
+      default: break;
+    }
+  }
+  mmu_->Write8(addr, val);
+}
 
 u16 Cpu::Read16(u16 addr) {
   u8 lo = Read8(addr);
@@ -1472,6 +2140,8 @@ HardwareMode Cpu::GetHardwareMode() const {
 void Cpu::SetHardwareMode(HardwareMode mode) {
   hardware_mode_ = mode;
   mmu_->SetHardwareMode(mode);
+  block_cache_.Clear();
+  block_ = nullptr;
 }
 
 void Cpu::ExecuteStop() {
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <valarray>
 #include <vector>
 
 #include "types.hpp"
+#include "block_cache.hpp"
+#include "breakpoints.hpp"
 #include "decoder.hpp"
 #include "registers.hpp"
 #include "mmu.hpp"
@@ -13,13 +16,20 @@
 #include "interrupt_device.hpp"
 #include "synced_device.hpp"
 #include "cpu_state.hpp"
+#include "cpu_core.hpp"
 #include "hardware_mode.hpp"
+#include "trace_recorder.hpp"
 
 
+class InputDevice;
+
 struct CpuConfig {
   bool test = false;
+  CpuCore core = CpuCore::kCached;
   Mmu* mmu;
   InterruptDevice* interrupts;
+  // Told about P1 reads made by the CPU, see InputDevice::OnCpuRead.
+  InputDevice* input = nullptr;
 };
 
 class Cpu {
@@ -28,6 +38,7 @@ public:
 
   void Reset();
   u8 Execute();
+  u32 FastForward(u32 max_cycles);
   u8 ReadNext8();
   u16 ReadNext16();
 
@@ -50,20 +61,101 @@ public:
   HardwareMode GetHardwareMode() const;
   void SetHardwareMode(HardwareMode mode);
 
+  CpuCore GetCore() const;
+  // The JIT core falls back to the cached one where Jit::IsSupported is false.
+  void SetCore(CpuCore core);
+  // Checks every cached instruction against the bytes in memory before it
+  // runs, falling back to a fresh fetch when they differ. The JIT core also
+  // replays every compiled block through the interpreter, see RunVerified.
+  void SetVerifyCache(bool verify);
+  bool IsVerifyingCache() const;
+  size_t GetCacheMismatches() const;
+
+  // For writes that bypass the CPU, like the debugger's memory editor.
+  void InvalidateCode(u16 addr);
+
+  // Records every instruction to the tracer, nullptr stops tracing.
+  void SetTracer(TraceRecorder* tracer);
+
+  // Data accesses to watched addresses are reported through TakeWatchHit,
+  // nullptr stops checking.
+  void SetWatchpoints(const Watchpoints* watchpoints);
+  std::optional<WatchHit> TakeWatchHit();
+
 private:
   Mmu* mmu_ = nullptr;
   InterruptDevice* interrupts_ = nullptr;
+  InputDevice* input_ = nullptr;
   Registers regs_ {};
   CpuState state_ {};
   std::vector<SyncedDevice*> synced_devices {};
   uint64_t tick_counter = 0;
+  u64 total_ticks_ = 0;
   HardwareMode hardware_mode_ = HardwareMode::kDmgMode;
   u8 key0_;
   u8 key1_;
   bool test_;
 
+  CpuCore core_ = CpuCore::kCached;
+  bool verify_cache_ = false;
+  size_t cache_mismatches_ = 0;
+  BlockCache block_cache_ {};
+  const CodeBlock* block_ = nullptr;
+  size_t block_index_ = 0;
+  u16 block_pc_ = 0;
+  Jit jit_ {};
+
+  // Data accesses of a compiled block, recorded and then replayed to the
+  // interpreter when the JIT core is verified.
+  struct BusAccess {
+    u16 addr;
+    u8 value;
+    bool write;
+  };
+  enum class BusLog {
+    kOff,
+    kRecord,
+    kReplay,
+  };
+  BusLog bus_log_ = BusLog::kOff;
+  std::vector<BusAccess> bus_accesses_ {};
+  size_t bus_replayed_ = 0;
+  bool bus_diverged_ = false;
+
+  TraceRecorder* tracer_ = nullptr;
+  const Watchpoints* watchpoints_ = nullptr;
+  std::optional<WatchHit> watch_hit_ {};
+
 private:
   u8 ExecuteInterrupts();
+  u32 IdleTicks() const;
+  void TickIdle(u32 m_cycles);
+  u32 SkipIterations(u32 iteration_cycles, u32 max_cycles);
+  u32 RunTransfer(u32 iteration_cycles, u32 max_cycles);
+  u8 ExecuteInstruction(Instruction& instr);
+
+  u32 RunCompiled(u32 max_cycles);
+  u32 RunVerified(const CodeBlock& block, u32 max_cycles);
+  bool CanRunCompiled() const;
+  bool Compile(CodeBlock& block);
+  u8 LogRead8(u16 addr);
+  void LogWrite8(u16 addr, u8 val);
+
+  static void JitFetch(Cpu* cpu, u32 bytes);
+  static u32 JitExecute(Cpu* cpu, const Instruction* instr);
+  static void JitTick(Cpu* cpu);
+  static bool JitNext(Cpu* cpu);
+
+  Instruction FetchInstruction();
+  const Instruction* FetchCached();
+  CodeBlock* LookupBlock(u16 pc);
+  CodeBlock DecodeBlock(u16 pc) const;
+  bool IsCacheable(u16 addr) const;
+  bool VerifyCached(const CodeBlock& block, const Instruction& instr, u16 pc);
+  void TraceInstruction();
+
+  u8 ReadBus8(u16 addr);
+  void WriteBus8(u16 addr, u8 val);
 
   void ExecuteStop();
 };
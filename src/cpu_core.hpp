@@ -0,0 +1,8 @@
+#pragma once
+
+
+enum class CpuCore {
+  kCached,
+  kInterpreter,
+  kJit,
+};
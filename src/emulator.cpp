@@ -149,6 +149,7 @@ void Emulator::Init(EmulatorConfig emu_cfg) {
   config_ = std::move(emu_cfg);
 
   sample_bufffer_.resize(config_.num_channels * config_.buffer_size);
+  export_samples_.resize(kSampleBufferMaxSize);
 
   timer_.Init({
     .interrupts = &interrupts_,
@@ -178,6 +179,7 @@ void Emulator::Init(EmulatorConfig emu_cfg) {
   cpu_.Init({
     .mmu = &mmu_,
     .interrupts = &interrupts_,
+    .input = &input_device_,
   });
   cpu_.AddSyncedDevice(&timer_);
   cpu_.AddSyncedDevice(&ppu_);
@@ -193,6 +195,7 @@ void Emulator::Init(EmulatorConfig emu_cfg) {
 
   input_device_.Init({
     .interrupts = &interrupts_,
+    .latch = &input_latch_,
   });
 
   serial_device_.Init({
@@ -210,24 +213,89 @@ void Emulator::Update(float dt) {
   const auto clock_speed = cpu_.GetState().double_speed ? 2 * config_.clock_speed : config_.clock_speed;
   const auto target_cycles_per_frame = static_cast<int>(clock_speed / config_.frame_rate);
 
+  input_device_.PollLatch();
+
   int prev_cycles = current_cycles;
   do {
-    auto cycles = cpu_.Execute();
+    // Breakpoints are checked after every instruction, idle stretches are
+    // only skipped through when there are none.
+    int cycles = !debug_checks_ ? cpu_.FastForward(target_cycles_per_frame - current_cycles) : 0;
+    if (!cycles) {
+      cycles = cpu_.Execute();
+    }
     current_cycles += cycles;
     num_cycles_ += cycles;
 
-    if (breakpoints_.contains(cpu_.GetRegisters().pc)) {
+    if (debug_checks_ && ShouldBreak()) {
       running_ = false;
       break;
     }
   } while (current_cycles < target_cycles_per_frame);
   prev_cycles_ = current_cycles - prev_cycles;
   current_cycles -= target_cycles_per_frame;
+  emulated_dots_ += cpu_.GetState().double_speed ? prev_cycles_ / 2 : prev_cycles_;
+
+  if (shm_export_.IsOpen() || recorder_.IsRecording() || burst_remaining_) {
+    PublishOutputs();
+  }
+}
+
+// Brings already running outputs up to date before another one starts, so
+// the new output does not steal samples from the shared export cursor.
+void Emulator::BeginOutput() {
+  if (shm_export_.IsOpen() || recorder_.IsRecording() || burst_remaining_) {
+    PublishOutputs();
+  } else {
+    audio_.ReadExportSamples(export_samples_);
+    last_frame_count_ = ppu_.GetFrameCount();
+  }
+}
+
+void Emulator::PublishOutputs() {
+  ZoneScoped;
+
+  // The PPU frame counter can be reset (ResetFrameCount), so only compare it
+  // for changes and number exported frames separately.
+  const auto frame_count = ppu_.GetFrameCount();
+  const bool new_frame = frame_count != last_frame_count_;
+  last_frame_count_ = frame_count;
+
+  const auto num_samples = audio_.ReadExportSamples(export_samples_);
+  const auto samples = std::span(export_samples_).first(num_samples);
+
+  if (shm_export_.IsOpen()) {
+    if (new_frame) {
+      exported_frames_ += 1;
+      ppu_.ExpandLcdFrame(shm_export_.BeginFrame(exported_frames_));
+      shm_export_.PublishFrame();
+    }
+    shm_export_.PushSamples(samples);
+  }
+
+  if (recorder_.IsRecording()) {
+    if (new_frame) {
+      recorder_.PushFrame(ppu_.GetLcdFrame(), ppu_.GetDmgPalette(), GetLastVBlankTimestamp());
+    }
+    recorder_.PushSamples(samples);
+  }
 
-  ppu_.UpdateRenderTargets();
+  if (burst_remaining_ && new_frame) {
+    screenshots_.Submit(std::format("{}_{:04}.png", burst_prefix_, burst_index_), ppu_.GetLcdFrame(), ppu_.GetDmgPalette(), burst_options_);
+    burst_index_ += 1;
+    burst_remaining_ -= 1;
+  }
+}
+
+u64 Emulator::GetLastVBlankTimestamp() const {
+  return emulated_dots_ - std::min<u64>(ppu_.GetDotsSinceVBlank(), emulated_dots_);
 }
 
 void Emulator::Cleanup() {
+  burst_remaining_ = 0;
+  screenshots_.Stop();
+  recorder_.Stop();
+  StopTrace();
+  shm_export_.Close();
   ppu_.Cleanup();
 }
 
@@ -300,8 +368,11 @@ void Emulator::Step(int cycles) {
     auto c = cpu_.Execute();
     n += c;
     num_cycles_ += c;
+    emulated_dots_ += cpu_.GetState().double_speed ? c / 2 : c;
   }
-  ppu_.UpdateRenderTargets();
+  // Stepping stops by itself, a watched access on the way must not stop the
+  // next Play on its first instruction.
+  cpu_.TakeWatchHit();
 }
 
 void Emulator::Play() {
@@ -361,14 +432,55 @@ u16 Emulator::Read16(u16 addr) const {
   return lo | (hi << 8);
 }
 
+void Emulator::ReadSpan(u16 addr, std::span<u8> dst) const {
+  mmu_.ReadSpan(addr, dst);
+}
+
 void Emulator::Write8(u16 addr, u8 byte) {
   mmu_.Write8(addr, byte);
+  cpu_.InvalidateCode(addr);
 }
 
 const Texture2D& Emulator::GetTargetLCD() const {
   return ppu_.GetTextureLcd();
 }
 
+const IndexedFrame& Emulator::GetLcdFrame() const {
+  return ppu_.GetLcdFrame();
+}
+
+const Palette& Emulator::GetDmgPalette() const {
+  return ppu_.GetDmgPalette();
+}
+
+void Emulator::ExpandLcdFrame(std::span<Color> dst) const {
+  ppu_.ExpandLcdFrame(dst);
+}
+
+void Emulator::SetDeferredPresent(bool deferred) {
+  ppu_.SetDeferredPresent(deferred);
+}
+
+u64 Emulator::GetPresentCount() const {
+  return ppu_.GetPresentCount();
+}
+
+void Emulator::PresentFrame(const IndexedFrame& frame, const Palette& dmg_palette, FrameBufferFormat format) {
+  ppu_.PresentFrame(frame, dmg_palette, format);
+}
+
+void Emulator::CaptureDebugView(PpuDebugView& view) {
+  ppu_.CaptureDebugView(view);
+}
+
+void Emulator::AddRenderTargetChanges(const RenderTargetDirty& dirty) {
+  ppu_.AddRenderTargetChanges(dirty);
+}
+
+void Emulator::UpdateRenderTargets(const PpuDebugView& view, RenderTargetFlags targets) {
+  ppu_.UpdateRenderTargets(view, targets);
+}
+
 const RenderTexture2D& Emulator::GetTargetTiles() const {
   return ppu_.GetTextureTiles();
 }
@@ -390,20 +502,59 @@ const RenderTexture2D& Emulator::GetTargetPalettes() const {
   return ppu_.GetTexturePalettes();
 }
 
-void Emulator::AddBreakPoint(u16 addr) {
-  breakpoints_.insert(addr);
+void Emulator::AddBreakPoint(u16 addr, std::optional<u16> bank) {
+  // The bank belongs to whichever device is mapped at addr right now.
+  const auto device = static_cast<u16>(mmu_.GetBankKey(addr) >> 16);
+  breakpoints_.Add({ .addr = addr, .bank = bank, .device = device });
+  UpdateDebugChecks();
 }
 
-void Emulator::RemoveBreakPoint(u16 addr) {
-  breakpoints_.erase(addr);
+void Emulator::RemoveBreakPoint(u16 addr, std::optional<u16> bank) {
+  breakpoints_.Remove(addr, bank);
+  UpdateDebugChecks();
 }
 
 void Emulator::ClearBreakPoints() {
-  breakpoints_.clear();
+  breakpoints_.Clear();
+  UpdateDebugChecks();
+}
+
+const std::vector<Breakpoint>& Emulator::GetBreakpoints() const {
+  return breakpoints_.List();
+}
+
+void Emulator::AddWatchPoint(Watchpoint watchpoint) {
+  watchpoints_.Add(watchpoint);
+  UpdateDebugChecks();
+}
+
+void Emulator::RemoveWatchPoint(u16 addr) {
+  watchpoints_.Remove(addr);
+  UpdateDebugChecks();
+}
+
+void Emulator::ClearWatchPoints() {
+  watchpoints_.Clear();
+  UpdateDebugChecks();
+}
+
+const std::vector<Watchpoint>& Emulator::GetWatchpoints() const {
+  return watchpoints_.List();
+}
+
+void Emulator::UpdateDebugChecks() {
+  debug_checks_ = !breakpoints_.Empty() || !watchpoints_.Empty();
+  cpu_.SetWatchpoints(watchpoints_.Empty() ? nullptr : &watchpoints_);
 }
 
-const std::set<u16>& Emulator::GetBreakpoints() const {
-  return breakpoints_;
+bool Emulator::ShouldBreak() {
+  const u16 pc = cpu_.GetRegisters().pc;
+  // Taken first so a hit is never left over when a breakpoint stops too.
+  if (auto hit = cpu_.TakeWatchHit()) {
+    spdlog::info("Watchpoint: {} 0x{:04X}, stopped at 0x{:04X}", hit->write ? "write to" : "read from", hit->addr, pc);
+    return true;
+  }
+  return breakpoints_.MayMatch(pc) && breakpoints_.Matches(pc, mmu_.GetBankKey(pc));
 }
 
 void Emulator::UpdateInput(JoypadButton btn, bool pressed) {
@@ -414,6 +565,47 @@ bool Emulator::IsButtonPressed(JoypadButton btn) const {
   return input_device_.IsPressed(btn);
 }
 
+InputLatch& Emulator::GetInputLatch() {
+  return input_latch_;
+}
+
+void Emulator::PollInput() {
+  input_device_.PollLatch();
+}
+
+void Emulator::SetSubFrameInput(bool enable) {
+  input_device_.SetSubFramePolling(enable);
+  input_device_.ResetLatencyStats();
+}
+
+const InputLatencyStats& Emulator::GetInputLatencyStats() const {
+  return input_device_.GetLatencyStats();
+}
+
+void Emulator::ResetInputLatencyStats() {
+  input_device_.ResetLatencyStats();
+}
+
+void Emulator::SetCpuCore(CpuCore core) {
+  cpu_.SetCore(core);
+}
+
+CpuCore Emulator::GetCpuCore() const {
+  return cpu_.GetCore();
+}
+
+void Emulator::SetVerifyCpuCore(bool verify) {
+  cpu_.SetVerifyCache(verify);
+}
+
+bool Emulator::IsVerifyingCpuCore() const {
+  return cpu_.IsVerifyingCache();
+}
+
+size_t Emulator::GetCpuCoreMismatches() const {
+  return cpu_.GetCacheMismatches();
+}
+
 void Emulator::SetSkipBootRom(bool skip) {
   skip_bootrom_ = skip;
 }
@@ -477,6 +669,153 @@ size_t Emulator::GetFrameCount() const {
   return ppu_.GetFrameCount();
 }
 
+void Emulator::SetFrameSkip(u8 frame_skip) {
+  ppu_.SetFrameSkip(frame_skip);
+}
+
+u8 Emulator::GetFrameSkip() const {
+  return ppu_.GetFrameSkip();
+}
+
+void Emulator::SetThreadedRendering(bool enable) {
+  ppu_.SetThreadedRendering(enable);
+}
+
+bool Emulator::IsThreadedRendering() const {
+  return ppu_.IsThreadedRendering();
+}
+
+void Emulator::SetFrameBufferFormat(FrameBufferFormat format) {
+  ppu_.SetFrameBufferFormat(format);
+}
+
+FrameBufferFormat Emulator::GetFrameBufferFormat() const {
+  return ppu_.GetFrameBufferFormat();
+}
+
+void Emulator::SetColorCorrection(ColorCorrection profile) {
+  ppu_.SetColorCorrection(profile);
+}
+
+ColorCorrection Emulator::GetColorCorrection() const {
+  return ppu_.GetColorCorrection();
+}
+
+std::expected<void, std::string> Emulator::EnableShmExport(std::string_view name) {
+  BeginOutput();
+
+  auto result = shm_export_.Open(name, {
+    .sample_rate = static_cast<u32>(config_.sample_rate),
+    .num_channels = static_cast<u32>(config_.num_channels),
+  });
+  if (!result) {
+    return result;
+  }
+
+  exported_frames_ = 0;
+  return {};
+}
+
+void Emulator::DisableShmExport() {
+  shm_export_.Close();
+}
+
+bool Emulator::IsShmExportEnabled() const {
+  return shm_export_.IsOpen();
+}
+
+std::expected<void, std::string> Emulator::StartRecording(std::string_view path, RecordQueuePolicy policy) {
+  BeginOutput();
+
+  const auto start = GetLastVBlankTimestamp();
+  const auto audio_offset = (emulated_dots_ - start) * config_.sample_rate / kDotsPerSecond * config_.num_channels;
+  auto result = recorder_.Start(path, {
+    .sample_rate = static_cast<u32>(config_.sample_rate),
+    .num_channels = static_cast<u32>(config_.num_channels),
+    .policy = policy,
+  }, start, static_cast<u32>(audio_offset));
+  if (!result) {
+    return result;
+  }
+
+  recorder_.PushFrame(ppu_.GetLcdFrame(), ppu_.GetDmgPalette(), start);
+  return {};
+}
+
+void Emulator::StopRecording() {
+  if (recorder_.IsRecording()) {
+    PublishOutputs();
+  }
+  recorder_.Stop();
+}
+
+bool Emulator::IsRecording() const {
+  return recorder_.IsRecording();
+}
+
+size_t Emulator::GetDroppedRecordingFrames() const {
+  return recorder_.GetDroppedFrames();
+}
+
+std::expected<void, std::string> Emulator::StartTrace(std::string_view path) {
+  cpu_.SetTracer(nullptr);
+  auto result = tracer_.Start(path);
+  if (!result) {
+    return result;
+  }
+
+  cpu_.SetTracer(&tracer_);
+  return {};
+}
+
+void Emulator::StopTrace() {
+  cpu_.SetTracer(nullptr);
+  tracer_.Stop();
+}
+
+bool Emulator::IsTracing() const {
+  return tracer_.IsRecording();
+}
+
+void Emulator::SetDoctorMode(bool enable) {
+  ppu_.SetDoctorMode(enable);
+}
+
+std::expected<void, std::string> Emulator::TakeScreenshot(std::string_view path, ScreenshotOptions options) {
+  if (options.scale > 1 && !upscaler::SupportsScale(options.filter, options.scale)) {
+    return std::unexpected{std::format("Unsupported screenshot scale {}x for this filter", options.scale)};
+  }
+  screenshots_.Submit(std::string{path}, ppu_.GetLcdFrame(), ppu_.GetDmgPalette(), options);
+  return {};
+}
+
+std::expected<void, std::string> Emulator::StartScreenshotBurst(std::string_view path_prefix, int num_frames, ScreenshotOptions options) {
+  if (num_frames <= 0) {
+    return std::unexpected{"Screenshot burst needs at least one frame"};
+  }
+  if (options.scale > 1 && !upscaler::SupportsScale(options.filter, options.scale)) {
+    return std::unexpected{std::format("Unsupported screenshot scale {}x for this filter", options.scale)};
+  }
+
+  BeginOutput();
+
+  // The frame currently on screen is the first of the burst.
+  burst_prefix_ = path_prefix;
+  burst_options_ = options;
+  burst_index_ = 1;
+  burst_remaining_ = num_frames - 1;
+  screenshots_.Submit(std::format("{}_{:04}.png", burst_prefix_, 0), ppu_.GetLcdFrame(), ppu_.GetDmgPalette(), burst_options_);
+  return {};
+}
+
+bool Emulator::IsScreenshotBurstActive() const {
+  return burst_remaining_ > 0;
+}
+
+size_t Emulator::GetPendingScreenshots() const {
+  return screenshots_.GetPending();
+}
+
 void Emulator::UpdatePalette(std::array<Color, 4> palette) {
   ppu_.UpdatePalette(std::move(palette));
 }
@@ -1,15 +1,17 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <expected>
 #include <memory>
-#include <set>
+#include <optional>
 #include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "types.hpp"
+#include "breakpoints.hpp"
 #include "cpu.hpp"
 #include "ppu.hpp"
 #include "registers.hpp"
@@ -22,6 +24,10 @@
 #include "null_device.hpp"
 #include "input_device.hpp"
 #include "serial_device.hpp"
+#include "shm_export.hpp"
+#include "recorder.hpp"
+#include "trace_recorder.hpp"
+#include "screenshot.hpp"
 #include "emulation_mode.hpp"
 #include "hardware_mode.hpp"
 
@@ -69,21 +75,43 @@ public:
   [[nodiscard]] Instruction GetCurrentInstruction() const;
   [[nodiscard]] u8 Read8(u16 addr) const;
   [[nodiscard]] u16 Read16(u16 addr) const;
+  void ReadSpan(u16 addr, std::span<u8> dst) const;
   void Write8(u16 addr, u8 byte);
 
+  void CaptureDebugView(PpuDebugView& view);
+  void AddRenderTargetChanges(const RenderTargetDirty& dirty);
+  void UpdateRenderTargets(const PpuDebugView& view, RenderTargetFlags targets);
   [[nodiscard]] const Texture2D& GetTargetLCD() const;
+  [[nodiscard]] const IndexedFrame& GetLcdFrame() const;
+  [[nodiscard]] const Palette& GetDmgPalette() const;
+  void ExpandLcdFrame(std::span<Color> dst) const;
+  void SetDeferredPresent(bool deferred);
+  [[nodiscard]] u64 GetPresentCount() const;
+  void PresentFrame(const IndexedFrame& frame, const Palette& dmg_palette, FrameBufferFormat format);
   [[nodiscard]] const RenderTexture2D& GetTargetTiles() const;
   [[nodiscard]] const RenderTexture2D& GetTargetTilemap(u8 id) const;
   [[nodiscard]] const RenderTexture2D& GetTargetSprites() const;
   [[nodiscard]] const RenderTexture2D& GetTargetPalettes() const;
 
-  void AddBreakPoint(u16 addr);
-  void RemoveBreakPoint(u16 addr);
+  void AddBreakPoint(u16 addr, std::optional<u16> bank = std::nullopt);
+  void RemoveBreakPoint(u16 addr, std::optional<u16> bank = std::nullopt);
   void ClearBreakPoints();
-  const std::set<u16>& GetBreakpoints() const;
+  const std::vector<Breakpoint>& GetBreakpoints() const;
+
+  void AddWatchPoint(Watchpoint watchpoint);
+  void RemoveWatchPoint(u16 addr);
+  void ClearWatchPoints();
+  const std::vector<Watchpoint>& GetWatchpoints() const;
 
   void UpdateInput(JoypadButton btn, bool pressed);
   bool IsButtonPressed(JoypadButton btn) const;
+  // Written by the input thread without the emulator lock; picked up at the
+  // start of each frame and, with sub-frame input, whenever the game reads P1.
+  InputLatch& GetInputLatch();
+  void PollInput();
+  void SetSubFrameInput(bool enable);
+  const InputLatencyStats& GetInputLatencyStats() const;
+  void ResetInputLatencyStats();
 
   void ToggleChannel(AudioChannelID channel, bool enable);
   bool IsChannelEnabled(AudioChannelID channel) const;
@@ -98,6 +126,39 @@ public:
   void ResetFrameCount();
   size_t GetFrameCount() const;
 
+  void SetFrameSkip(u8 frame_skip);
+  u8 GetFrameSkip() const;
+
+  void SetThreadedRendering(bool enable);
+  bool IsThreadedRendering() const;
+
+  void SetFrameBufferFormat(FrameBufferFormat format);
+  FrameBufferFormat GetFrameBufferFormat() const;
+
+  void SetColorCorrection(ColorCorrection profile);
+  ColorCorrection GetColorCorrection() const;
+
+  std::expected<void, std::string> EnableShmExport(std::string_view name);
+  void DisableShmExport();
+  bool IsShmExportEnabled() const;
+
+  std::expected<void, std::string> StartRecording(std::string_view path, RecordQueuePolicy policy);
+  void StopRecording();
+  bool IsRecording() const;
+  size_t GetDroppedRecordingFrames() const;
+
+  // Binary instruction trace, see trace_layout.hpp. Doctor mode makes the
+  // trace comparable with gameboy-doctor's reference logs.
+  std::expected<void, std::string> StartTrace(std::string_view path);
+  void StopTrace();
+  bool IsTracing() const;
+  void SetDoctorMode(bool enable);
+
+  std::expected<void, std::string> TakeScreenshot(std::string_view path, ScreenshotOptions options);
+  std::expected<void, std::string> StartScreenshotBurst(std::string_view path_prefix, int num_frames, ScreenshotOptions options);
+  bool IsScreenshotBurstActive() const;
+  size_t GetPendingScreenshots() const;
+
   void UpdatePalette(std::array<Color, 4> palette);
 
   void SetClockSpeed(size_t clock_speed);
@@ -106,7 +167,19 @@ public:
   void SetEmulationMode(EmulationMode mode);
   EmulationMode GetEmulationMode() const;
 
+  void SetCpuCore(CpuCore core);
+  CpuCore GetCpuCore() const;
+  void SetVerifyCpuCore(bool verify);
+  bool IsVerifyingCpuCore() const;
+  size_t GetCpuCoreMismatches() const;
+
 private:
+  void BeginOutput();
+  void PublishOutputs();
+  u64 GetLastVBlankTimestamp() const;
+  void UpdateDebugChecks();
+  bool ShouldBreak();
+
   EmulatorConfig config_ {};
   Mmu mmu_ {};
   Cpu cpu_ {};
@@ -120,6 +193,7 @@ private:
   Audio audio_ {};
   NullDevice null_device_ {};
   InputDevice input_device_ {};
+  InputLatch input_latch_ {};
   SerialDevice serial_device_ {};
   EmulationMode mode_ = EmulationMode::kAutoMode;
   HardwareMode hardware_mode_ = HardwareMode::kDmgMode;
@@ -127,13 +201,29 @@ private:
   std::unordered_map<HardwareMode, BootRomData, std::hash<HardwareMode>> boot_roms_ {};
 
   std::vector<u8> cart_bytes_ {};
-  std::set<u16> breakpoints_ {};
+  Breakpoints breakpoints_ {};
+  Watchpoints watchpoints_ {};
+  // Set while any breakpoint or watchpoint exists.
+  bool debug_checks_ = false;
 
   std::vector<float> sample_bufffer_ {};
 
+  ShmExport shm_export_ {};
+  Recorder recorder_ {};
+  TraceRecorder tracer_ {};
+  ScreenshotEncoder screenshots_ {};
+  ScreenshotOptions burst_options_ {};
+  std::string burst_prefix_ {};
+  int burst_index_ = 0;
+  int burst_remaining_ = 0;
+  std::vector<float> export_samples_ {};
+  size_t last_frame_count_ = 0;
+  u64 exported_frames_ = 0;
+
   size_t prev_cycles_ = 0;
   size_t num_cycles_ = 0;
+  u64 emulated_dots_ = 0;
 
   bool skip_bootrom_ = true;
-  bool running_ = false;
+  std::atomic<bool> running_ = false;
 };
@@ -0,0 +1,347 @@
+#include <tracy/Tracy.hpp>
+
+#include "emulator_thread.hpp"
+#include "overloaded.hpp"
+
+
+namespace {
+  constexpr size_t kMemoryChunkSize = 0x100;
+  // Frames run back to back to catch up after a stall before the schedule
+  // is reset instead.
+  constexpr int kMaxCatchUpFrames = 4;
+}
+
+EmulatorLock::EmulatorLock(EmulatorThread& owner) : owner_(owner), lock_(owner.LockEmulator()) {
+}
+
+EmulatorLock::~EmulatorLock() {
+  owner_.Publish();
+}
+
+Emulator* EmulatorLock::operator->() const {
+  return owner_.emulator_;
+}
+
+Emulator& EmulatorLock::operator*() const {
+  return *owner_.emulator_;
+}
+
+EmulatorThread::~EmulatorThread() {
+  Cleanup();
+}
+
+void EmulatorThread::Init(EmulatorThreadConfig cfg) {
+  emulator_ = cfg.emulator;
+  frame_time_ = cfg.frame_time;
+
+  emulator_->SetDeferredPresent(true);
+  present_count_ = emulator_->GetPresentCount() - 1;
+  Publish();
+}
+
+void EmulatorThread::Cleanup() {
+  SetThreaded(false);
+}
+
+void EmulatorThread::SetThreaded(bool enable) {
+#if defined(__EMSCRIPTEN__)
+  enable = false;
+#endif
+  if (enable == IsThreaded()) {
+    return;
+  }
+
+  if (enable) {
+    running_ = true;
+    thread_ = std::thread(&EmulatorThread::Run, this);
+  } else {
+    {
+      std::lock_guard lock(wake_mutex_);
+      running_ = false;
+    }
+    wake_cv_.notify_one();
+    thread_.join();
+  }
+  accumulated_time_ = 0.0;
+}
+
+bool EmulatorThread::IsThreaded() const {
+  return thread_.joinable();
+}
+
+void EmulatorThread::Submit(EmulatorCommand command) {
+  while (!commands_.Push(command)) {
+    if (!IsThreaded()) {
+      std::lock_guard lock(mutex_);
+      DrainCommands();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  if (IsThreaded()) {
+    {
+      std::lock_guard lock(wake_mutex_);
+    }
+    wake_cv_.notify_one();
+  }
+}
+
+void EmulatorThread::SetInput(const ButtonStates& buttons, Clock::time_point timestamp) {
+  u8 pressed = 0;
+  for (size_t i = 0; i < buttons.size(); i += 1) {
+    pressed |= buttons[i] ? (1 << i) : 0;
+  }
+  const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch());
+  emulator_->GetInputLatch().Publish(pressed, static_cast<u64>(nanoseconds.count()));
+  // Wakes a paused emulator so the input panel reflects it, a running frame
+  // has usually picked it up by then.
+  Submit(cmd::PollInput{});
+}
+
+void EmulatorThread::SetSpeed(int speed) {
+  speed_.store(speed, std::memory_order_relaxed);
+}
+
+void EmulatorThread::SetCaptureMemory(bool enable) {
+  capture_memory_.store(enable, std::memory_order_relaxed);
+}
+
+void EmulatorThread::Update(double dt) {
+  ZoneScoped;
+
+  if (IsThreaded()) {
+    return;
+  }
+
+  std::lock_guard lock(mutex_);
+  DrainCommands();
+  if (emulator_->IsPlaying()) {
+    accumulated_time_ += dt;
+    while (accumulated_time_ >= frame_time_) {
+      RunFrame();
+      accumulated_time_ -= frame_time_;
+    }
+  } else {
+    accumulated_time_ = 0.0;
+  }
+  Publish();
+}
+
+EmulatorLock EmulatorThread::Lock() {
+  return EmulatorLock{*this};
+}
+
+void EmulatorThread::UpdateRenderTargets(RenderTargetFlags targets) {
+  // Closed panels leave the emulator alone.
+  if (!targets.tiles && !targets.tilemap1 && !targets.tilemap2 && !targets.sprites && !targets.palettes) {
+    return;
+  }
+  emulator_->UpdateRenderTargets(GetSnapshot().debug_view, targets);
+}
+
+void EmulatorThread::AcquireSnapshot() {
+  if (snapshots_.Acquire()) {
+    emulator_->AddRenderTargetChanges(GetSnapshot().debug_view.dirty);
+  }
+}
+
+const EmulatorSnapshot& EmulatorThread::GetSnapshot() const {
+  return snapshots_.Front();
+}
+
+const LcdOutput* EmulatorThread::AcquireFrame() {
+  return frames_.Acquire() ? &frames_.Front() : nullptr;
+}
+
+std::unique_lock<std::mutex> EmulatorThread::LockEmulator() {
+  lock_requests_.fetch_add(1, std::memory_order_acq_rel);
+  std::unique_lock lock(mutex_);
+  lock_requests_.fetch_sub(1, std::memory_order_release);
+  return lock;
+}
+
+void EmulatorThread::Run() {
+  const auto frame_period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frame_time_));
+  auto next_frame = Clock::now();
+  bool playing = emulator_->IsPlaying();
+
+  while (true) {
+    {
+      std::unique_lock lock(wake_mutex_);
+      const auto wake = [this] {
+        return !running_ || !commands_.Empty();
+      };
+      if (playing) {
+        wake_cv_.wait_until(lock, next_frame, wake);
+      } else {
+        wake_cv_.wait(lock, wake);
+      }
+      if (!running_) {
+        break;
+      }
+    }
+
+    // The UI thread only takes the lock for short updates, let it in first.
+    while (lock_requests_.load(std::memory_order_acquire) > 0) {
+      std::this_thread::yield();
+    }
+
+    std::lock_guard lock(mutex_);
+    DrainCommands();
+
+    const auto now = Clock::now();
+    if (!emulator_->IsPlaying()) {
+      next_frame = now;
+    } else if (now >= next_frame) {
+      RunFrame();
+      next_frame += frame_period;
+      if (now - next_frame > kMaxCatchUpFrames * frame_period) {
+        next_frame = now;
+      }
+    }
+    playing = emulator_->IsPlaying();
+
+    Publish();
+  }
+}
+
+void EmulatorThread::DrainCommands() {
+  EmulatorCommand command;
+  while (commands_.Pop(command)) {
+    Dispatch(command);
+  }
+}
+
+void EmulatorThread::Dispatch(const EmulatorCommand& command) {
+  std::visit(overloaded {
+    [this](const cmd::Play&) {
+      if (emulator_->IsCartLoaded()) {
+        emulator_->Play();
+      }
+    },
+    [this](const cmd::Stop&) {
+      emulator_->Stop();
+    },
+    [this](const cmd::Step& step) {
+      if (emulator_->IsCartLoaded()) {
+        emulator_->Step(step.cycles);
+      }
+    },
+    [this](const cmd::StepFrame&) {
+      if (emulator_->IsCartLoaded()) {
+        emulator_->Update(static_cast<float>(frame_time_));
+      }
+    },
+    [this](const cmd::Reset&) {
+      if (!emulator_->IsCartLoaded()) {
+        return;
+      }
+      const auto was_playing = emulator_->IsPlaying();
+      emulator_->Stop();
+      emulator_->Reset();
+      if (was_playing) {
+        emulator_->Play();
+      }
+    },
+    [this](const cmd::PollInput&) {
+      emulator_->PollInput();
+    },
+    [this](const cmd::AddBreakPoint& breakpoint) {
+      emulator_->AddBreakPoint(breakpoint.addr, breakpoint.bank);
+    },
+    [this](const cmd::ClearBreakPoints&) {
+      emulator_->ClearBreakPoints();
+    },
+    [this](const cmd::AddWatchPoint& watchpoint) {
+      emulator_->AddWatchPoint(watchpoint.watchpoint);
+    },
+    [this](const cmd::ClearWatchPoints&) {
+      emulator_->ClearWatchPoints();
+    },
+    [this](const cmd::UpdatePalette& palette) {
+      emulator_->UpdatePalette(palette.palette);
+    },
+    [this](const cmd::Write8& write) {
+      emulator_->Write8(write.addr, write.byte);
+    },
+    [this](const cmd::SetPc& pc) {
+      emulator_->GetRegisters().pc = pc.pc;
+    },
+    [this](const cmd::SetFrameSkip& frame_skip) {
+      emulator_->SetFrameSkip(frame_skip.frame_skip);
+    },
+    [this](const cmd::SetFrameBufferFormat& format) {
+      emulator_->SetFrameBufferFormat(format.format);
+    },
+    [this](const cmd::SetColorCorrection& profile) {
+      emulator_->SetColorCorrection(profile.profile);
+    },
+  }, command);
+}
+
+void EmulatorThread::RunFrame() {
+  ZoneScoped;
+
+  const auto start = Clock::now();
+  const auto speed = speed_.load(std::memory_order_relaxed);
+  int frames = 0;
+  for (; frames < speed && emulator_->IsPlaying(); frames += 1) {
+    emulator_->Update(static_cast<float>(frame_time_));
+  }
+  if (frames) {
+    emulation_time_ = std::chrono::duration<double>(Clock::now() - start).count() / frames;
+    frames_run_ += frames;
+  }
+}
+
+void EmulatorThread::Publish() {
+  ZoneScoped;
+
+  auto& snapshot = snapshots_.Back();
+  snapshot.registers = emulator_->GetRegisters();
+  snapshot.state = emulator_->GetState();
+  snapshot.total_cycles = emulator_->GetTotalCycles();
+  snapshot.prev_cycles = emulator_->GetPrevCycles();
+  snapshot.frame_count = emulator_->GetFrameCount();
+  snapshot.clock_speed = emulator_->GetClockSpeed();
+  snapshot.emulation_mode = emulator_->GetEmulationMode();
+  snapshot.frame_skip = emulator_->GetFrameSkip();
+  snapshot.emulation_time = emulation_time_;
+  snapshot.frames_run = frames_run_;
+  snapshot.cart_loaded = emulator_->IsCartLoaded();
+  snapshot.playing = emulator_->IsPlaying();
+  snapshot.recording = emulator_->IsRecording();
+  snapshot.screenshot_burst = emulator_->IsScreenshotBurstActive();
+  snapshot.dropped_recording_frames = emulator_->GetDroppedRecordingFrames();
+  for (size_t i = 0; i < snapshot.buttons.size(); i += 1) {
+    snapshot.buttons[i] = emulator_->IsButtonPressed(static_cast<JoypadButton>(i));
+  }
+  snapshot.input_latency = emulator_->GetInputLatencyStats();
+  snapshot.breakpoints = emulator_->GetBreakpoints();
+  snapshot.watchpoints = emulator_->GetWatchpoints();
+
+  if (!snapshots_.HasUnread()) {
+    unread_dirty_ = {};
+  }
+  emulator_->CaptureDebugView(snapshot.debug_view);
+  unread_dirty_ |= snapshot.debug_view.dirty;
+  snapshot.debug_view.dirty = unread_dirty_;
+
+  snapshot.has_memory = capture_memory_.load(std::memory_order_relaxed);
+  if (snapshot.has_memory) {
+    for (size_t addr = 0; addr < snapshot.memory.size(); addr += kMemoryChunkSize) {
+      emulator_->ReadSpan(static_cast<u16>(addr), std::span(snapshot.memory).subspan(addr, kMemoryChunkSize));
+    }
+  }
+  snapshots_.Publish();
+
+  if (const auto count = emulator_->GetPresentCount(); count != present_count_) {
+    present_count_ = count;
+    auto& output = frames_.Back();
+    output.frame = emulator_->GetLcdFrame();
+    output.dmg_palette = emulator_->GetDmgPalette();
+    output.format = emulator_->GetFrameBufferFormat();
+    frames_.Publish();
+  }
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <variant>
+#include <vector>
+#include <magic_enum/magic_enum.hpp>
+
+#include "types.hpp"
+#include "emulator.hpp"
+#include "joypad.hpp"
+#include "spsc_queue.hpp"
+#include "triple_buffer.hpp"
+
+
+using ButtonStates = std::array<bool, magic_enum::enum_integer(JoypadButton::COUNT)>;
+
+namespace cmd {
+  struct Play {};
+  struct Stop {};
+  struct Step { int cycles = 4; };
+  struct StepFrame {};
+  struct Reset {};
+  struct PollInput {};
+  struct AddBreakPoint { u16 addr; std::optional<u16> bank; };
+  struct ClearBreakPoints {};
+  struct AddWatchPoint { Watchpoint watchpoint; };
+  struct ClearWatchPoints {};
+  struct UpdatePalette { Palette palette; };
+  struct Write8 { u16 addr; u8 byte; };
+  struct SetPc { u16 pc; };
+  struct SetFrameSkip { u8 frame_skip; };
+  struct SetFrameBufferFormat { FrameBufferFormat format; };
+  struct SetColorCorrection { ColorCorrection profile; };
+}
+
+using EmulatorCommand = std::variant<
+  cmd::Play,
+  cmd::Stop,
+  cmd::Step,
+  cmd::StepFrame,
+  cmd::Reset,
+  cmd::PollInput,
+  cmd::AddBreakPoint,
+  cmd::ClearBreakPoints,
+  cmd::AddWatchPoint,
+  cmd::ClearWatchPoints,
+  cmd::UpdatePalette,
+  cmd::Write8,
+  cmd::SetPc,
+  cmd::SetFrameSkip,
+  cmd::SetFrameBufferFormat,
+  cmd::SetColorCorrection
+>;
+
+// Copy of the emulator state the debug panels show, taken between frames.
+struct EmulatorSnapshot {
+  Registers registers {};
+  CpuState state {};
+  size_t total_cycles = 0;
+  size_t prev_cycles = 0;
+  size_t frame_count = 0;
+  size_t clock_speed = 0;
+  EmulationMode emulation_mode = EmulationMode::kAutoMode;
+  u8 frame_skip = 0;
+  // Wall time per emulated frame, averaged over the last batch RunFrame ran.
+  double emulation_time = 0.0;
+  // Frames run while playing, changes whenever emulation_time is measured.
+  u64 frames_run = 0;
+  bool cart_loaded = false;
+  bool playing = false;
+  bool recording = false;
+  bool screenshot_burst = false;
+  size_t dropped_recording_frames = 0;
+  ButtonStates buttons {};
+  InputLatencyStats input_latency {};
+  std::vector<Breakpoint> breakpoints {};
+  std::vector<Watchpoint> watchpoints {};
+  // Also carries the render target changes of snapshots the UI skipped.
+  PpuDebugView debug_view {};
+  // Only filled while memory capture is enabled.
+  bool has_memory = false;
+  std::array<u8, 0x10000> memory {};
+
+  [[nodiscard]] bool IsButtonPressed(JoypadButton btn) const {
+    return buttons[magic_enum::enum_integer(btn)];
+  }
+
+  [[nodiscard]] u8 Read8(u16 addr) const {
+    return memory[addr];
+  }
+
+  [[nodiscard]] u16 Read16(u16 addr) const {
+    return memory[addr] | (memory[static_cast<u16>(addr + 1)] << 8);
+  }
+};
+
+struct LcdOutput {
+  IndexedFrame frame {};
+  Palette dmg_palette {};
+  FrameBufferFormat format = FrameBufferFormat::kIndexed8;
+};
+
+struct EmulatorThreadConfig {
+  Emulator* emulator;
+  double frame_time;
+};
+
+class EmulatorThread;
+
+// Exclusive access to the emulator between frames. Publishes a fresh
+// snapshot when released so changes show up without waiting for a frame.
+class EmulatorLock {
+public:
+  EmulatorLock(const EmulatorLock&) = delete;
+  EmulatorLock& operator=(const EmulatorLock&) = delete;
+  ~EmulatorLock();
+
+  Emulator* operator->() const;
+  Emulator& operator*() const;
+
+private:
+  friend class EmulatorThread;
+  explicit EmulatorLock(EmulatorThread& owner);
+
+  EmulatorThread& owner_;
+  std::unique_lock<std::mutex> lock_;
+};
+
+// Runs the emulator, paced to the frame time, either on its own thread or
+// inline from Update() where threads are unavailable. The UI talks to it
+// through a lock-free command queue and reads results from triple buffered
+// snapshots and LCD frames, so a stalled UI frame never holds up emulation
+// or audio. Rare operations (loading carts, settings) take the emulator lock.
+class EmulatorThread {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  ~EmulatorThread();
+
+  void Init(EmulatorThreadConfig cfg);
+  void Cleanup();
+
+  void SetThreaded(bool enable);
+  [[nodiscard]] bool IsThreaded() const;
+
+  void Submit(EmulatorCommand command);
+  // Latches the joypad state sampled at `timestamp` (steady clock). The
+  // game sees it at its next P1 read, even in the middle of a frame.
+  void SetInput(const ButtonStates& buttons, Clock::time_point timestamp);
+  void SetSpeed(int speed);
+  void SetCaptureMemory(bool enable);
+
+  // Runs the catch-up loop when not threaded; does nothing otherwise.
+  void Update(double dt);
+
+  [[nodiscard]] EmulatorLock Lock();
+  // Redraws the debug targets from the current snapshot, never waits for
+  // the emulator.
+  void UpdateRenderTargets(RenderTargetFlags targets);
+
+  // Picks up the newest published snapshot; GetSnapshot() stays valid until
+  // the next call.
+  void AcquireSnapshot();
+  [[nodiscard]] const EmulatorSnapshot& GetSnapshot() const;
+  // The newest LCD frame if one was published since the last call.
+  [[nodiscard]] const LcdOutput* AcquireFrame();
+
+private:
+  friend class EmulatorLock;
+
+  std::unique_lock<std::mutex> LockEmulator();
+  void Run();
+  void DrainCommands();
+  void Dispatch(const EmulatorCommand& command);
+  void RunFrame();
+  void Publish();
+
+  Emulator* emulator_ = nullptr;
+  double frame_time_ = 0.0;
+  double accumulated_time_ = 0.0;
+  double emulation_time_ = 0.0;
+  u64 frames_run_ = 0;
+  u64 present_count_ = 0;
+  RenderTargetDirty unread_dirty_ {};
+
+  SpscQueue<EmulatorCommand, 256> commands_ {};
+  TripleBuffer<EmulatorSnapshot> snapshots_ {};
+  TripleBuffer<LcdOutput> frames_ {};
+  std::atomic<int> speed_ {1};
+  std::atomic<bool> capture_memory_ {false};
+
+  std::mutex mutex_ {};
+  std::atomic<int> lock_requests_ {0};
+
+  std::mutex wake_mutex_ {};
+  std::condition_variable wake_cv_ {};
+  std::thread thread_ {};
+  bool running_ = false;
+};
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <chrono>
 #include <utility>
 #include <spdlog/spdlog.h>
 #include <magic_enum/magic_enum.hpp>
@@ -7,8 +9,34 @@
 #include "input_device.hpp"
 
 
+namespace {
+  constexpr u64 kTimestampMask = (u64{1} << 56) - 1;
+
+  u64 Now() {
+    return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+}
+
+void InputLatch::Publish(u8 pressed, u64 timestamp) {
+  state_.store((u64{pressed} << 56) | (timestamp & kTimestampMask), std::memory_order_release);
+}
+
+u64 InputLatch::Load() const {
+  return state_.load(std::memory_order_acquire);
+}
+
+u8 InputLatch::Pressed(u64 state) {
+  return static_cast<u8>(state >> 56);
+}
+
+u64 InputLatch::Timestamp(u64 state) {
+  return state & kTimestampMask;
+}
+
 void InputDevice::Init(InputDeviceConfig cfg) {
   interrupts_ = cfg.interrupts;
+  latch_ = cfg.latch;
 }
 
 [[nodiscard]] bool InputDevice::IsValidFor(u16 addr) const {
@@ -34,6 +62,10 @@ void InputDevice::Write8(u16 addr, u8 byte) {
 void InputDevice::Reset() {
   reg_buttons_.reset();
   reg_dpad_.reset();
+  // Buttons still held are applied again on the next poll, without counting
+  // as new input.
+  latch_state_ = InputLatch::Timestamp(latch_state_);
+  pending_timestamp_ = 0;
 }
 
 void InputDevice::Update(JoypadButton button, bool pressed) {
@@ -96,3 +128,61 @@ bool InputDevice::IsPressed(JoypadButton button) const {
     default: std::unreachable();
   }
 }
+
+void InputDevice::PollLatch() {
+  if (!latch_) {
+    return;
+  }
+  const auto state = latch_->Load();
+  if (state == latch_state_) {
+    return;
+  }
+
+  const bool new_input = InputLatch::Timestamp(state) != InputLatch::Timestamp(latch_state_);
+  latch_state_ = state;
+  const auto pressed = InputLatch::Pressed(state);
+  for (u8 i = 0; i < std::to_underlying(JoypadButton::COUNT); i += 1) {
+    Update(static_cast<JoypadButton>(i), pressed & (1 << i));
+  }
+  if (new_input) {
+    pending_timestamp_ = InputLatch::Timestamp(state);
+  }
+}
+
+void InputDevice::OnCpuRead() {
+  // Input that arrived during the frame is seen here rather than at the next
+  // frame. Only the emulation thread gets here, the latch is the only shared
+  // state.
+  if (!latch_) {
+    return;
+  }
+  if (sub_frame_polling_) {
+    PollLatch();
+  }
+  MeasureLatency();
+}
+
+void InputDevice::SetSubFramePolling(bool enable) {
+  sub_frame_polling_ = enable;
+}
+
+const InputLatencyStats& InputDevice::GetLatencyStats() const {
+  return latency_;
+}
+
+void InputDevice::ResetLatencyStats() {
+  latency_ = {};
+  pending_timestamp_ = 0;
+}
+
+void InputDevice::MeasureLatency() {
+  if (!pending_timestamp_) {
+    return;
+  }
+  const auto now = Now() & kTimestampMask;
+  const auto latency_ms = now > pending_timestamp_ ? static_cast<double>(now - pending_timestamp_) / 1e6 : 0.0;
+  pending_timestamp_ = 0;
+  latency_.count += 1;
+  latency_.total_ms += latency_ms;
+  latency_.max_ms = std::max(latency_.max_ms, latency_ms);
+}
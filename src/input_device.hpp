@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #include "types.hpp"
 #include "mmu_device.hpp"
 #include "joypad.hpp"
@@ -34,8 +36,35 @@ struct InputRegister {
   }
 };
 
+// Newest joypad state from the thread sampling the host input, packed with
+// its host timestamp (steady clock nanoseconds) into a single atomic so the
+// emulator can pick it up in the middle of a frame without locking.
+class InputLatch {
+public:
+  void Publish(u8 pressed, u64 timestamp);
+  [[nodiscard]] u64 Load() const;
+
+  [[nodiscard]] static u8 Pressed(u64 state);
+  [[nodiscard]] static u64 Timestamp(u64 state);
+
+private:
+  std::atomic<u64> state_ {0};
+};
+
+// Host time from sampling an input to the first P1 read that returns it.
+struct InputLatencyStats {
+  u64 count = 0;
+  double total_ms = 0.0;
+  double max_ms = 0.0;
+
+  [[nodiscard]] double Average() const {
+    return count ? total_ms / static_cast<double>(count) : 0.0;
+  }
+};
+
 struct InputDeviceConfig {
   InterruptDevice* interrupts;
+  InputLatch* latch;
 };
 
 class InputDevice : public MmuDevice {
@@ -50,8 +79,25 @@ public:
   void Update(JoypadButton button, bool pressed);
   bool IsPressed(JoypadButton button) const;
 
+  // Applies the latched state if it changed since the last poll. With
+  // sub-frame polling on, every P1 read by the CPU polls as well.
+  void PollLatch();
+  // Reading P1 is the moment the game samples the joypad. Only the CPU calls
+  // this, so debugger and memory viewer reads leave the device alone.
+  void OnCpuRead();
+  void SetSubFramePolling(bool enable);
+  [[nodiscard]] const InputLatencyStats& GetLatencyStats() const;
+  void ResetLatencyStats();
+
 private:
+  void MeasureLatency();
+
   InterruptDevice* interrupts_ = nullptr;
+  InputLatch* latch_ = nullptr;
+  bool sub_frame_polling_ = true;
+  u64 latch_state_ = 0;
+  u64 pending_timestamp_ = 0;
+  InputLatencyStats latency_ {};
 
   InputRegister reg_buttons_ {};
   InputRegister reg_dpad_ {};
@@ -1,5 +1,7 @@
 #include <charconv>
+#include <chrono>
 #include <filesystem>
+#include <optional>
 #include <span>
 #include <string>
 #include <raylib.h>
@@ -61,12 +63,18 @@ constexpr char const* kErrorKeyDmgBootRom = "DmgBootRomError";
 constexpr char const* kErrorKeyCgbBootRom = "CgbBootRomError";
 constexpr char const* kErrorKeyCartRom = "CartRomError";
 constexpr char const* kErrorKeyShader = "ShaderError";
+constexpr char const* kErrorKeyShmExport = "ShmExportError";
+constexpr char const* kErrorKeyRecording = "RecordingError";
+constexpr char const* kErrorKeyScreenshot = "ScreenshotError";
 
 constexpr int kTargetEmulatorFrameRate = 60;
 constexpr double kTargetEmulatorFrameTime = 1.0 / kTargetEmulatorFrameRate;
 
 constexpr int kLockedFrameRate = 60;
 
+constexpr double kAutoFrameSkipRaise = 0.8;
+constexpr double kAutoFrameSkipLower = 0.4;
+
 constexpr char const* kShaderPathNoop = "resources/shaders/{}/noop.glsl";
 constexpr char const* kShaderPathScanline = "resources/shaders/{}/scanlines.glsl";
 
@@ -175,6 +183,17 @@ static auto SerializeInterfaceSettings(const InterfaceSettings& settings) -> tom
         { "skip_boot_rom", settings.skip_boot_rom },
         { "dmg_boot_rom_path", settings.dmg_boot_rom_path },
         { "cgb_boot_rom_path", settings.cgb_boot_rom_path },
+        { "frame_skip", settings.frame_skip },
+        { "auto_frame_skip", settings.auto_frame_skip },
+        { "turbo_speed", settings.turbo_speed },
+        { "emulation_thread", settings.emulation_thread },
+        { "sub_frame_input", settings.sub_frame_input },
+        { "shm_export", settings.shm_export },
+        { "shm_export_name", settings.shm_export_name },
+        { "record_policy", std::string(magic_enum::enum_name(settings.record_policy)) },
+        { "screenshot_filter", std::string(magic_enum::enum_name(settings.screenshot_filter)) },
+        { "screenshot_scale", settings.screenshot_scale },
+        { "screenshot_burst_frames", settings.screenshot_burst_frames },
         { "show_debugger", settings.show_debugger },
         { "show_breakpoints", settings.show_breakpoints },
       },
@@ -205,6 +224,9 @@ static auto SerializeInterfaceSettings(const InterfaceSettings& settings) -> tom
       "graphics",
       toml::table{
         { "show_options", settings.show_graphic_options },
+        { "threaded_rendering", settings.threaded_rendering },
+        { "frame_buffer_format", std::string(magic_enum::enum_name(settings.frame_buffer_format)) },
+        { "color_correction", std::string(magic_enum::enum_name(settings.color_correction)) },
         { "palette", toml::array{
             ColorToString(settings.palette[0]),
             ColorToString(settings.palette[1]),
@@ -248,6 +270,19 @@ static auto DeserializeInterfaceSettings(const toml::table& table, InterfaceSett
   settings.skip_boot_rom = table["emulator"]["skip_boot_rom"].value_or(true);
   settings.dmg_boot_rom_path = table["emulator"]["dmg_boot_rom_path"].value_or(std::string{kDmgDefaultBootRomPath});
   settings.cgb_boot_rom_path = table["emulator"]["cgb_boot_rom_path"].value_or(std::string{kCgbDefaultBootRomPath});
+  settings.frame_skip = std::clamp(table["emulator"]["frame_skip"].value_or(0), 0, kMaxFrameSkip);
+  settings.auto_frame_skip = table["emulator"]["auto_frame_skip"].value_or(false);
+  settings.turbo_speed = std::clamp(table["emulator"]["turbo_speed"].value_or(kDefaultTurboSpeed), 2, 16);
+  settings.emulation_thread = table["emulator"]["emulation_thread"].value_or(true);
+  settings.sub_frame_input = table["emulator"]["sub_frame_input"].value_or(true);
+  settings.shm_export = table["emulator"]["shm_export"].value_or(false);
+  settings.shm_export_name = table["emulator"]["shm_export_name"].value_or(std::string{shm::kDefaultName});
+  settings.record_policy = magic_enum::enum_cast<RecordQueuePolicy>(table["emulator"]["record_policy"].value_or(""))
+    .value_or(RecordQueuePolicy::kDropFrames);
+  settings.screenshot_filter = magic_enum::enum_cast<upscaler::Filter>(table["emulator"]["screenshot_filter"].value_or(""))
+    .value_or(upscaler::Filter::kNearest);
+  settings.screenshot_scale = std::clamp(table["emulator"]["screenshot_scale"].value_or(1), 1, kMaxScreenshotScale);
+  settings.screenshot_burst_frames = std::clamp(table["emulator"]["screenshot_burst_frames"].value_or(kDefaultScreenshotBurstFrames), 1, kMaxScreenshotBurstFrames);
   settings.show_debugger = table["emulator"]["show_debugger"].value_or(true);
   settings.show_breakpoints = table["emulator"]["show_breakpoints"].value_or(false);
 
@@ -271,6 +306,11 @@ static auto DeserializeInterfaceSettings(const toml::table& table, InterfaceSett
   settings.master_volume = std::clamp(table["hardware"]["master_volume"].value_or(100.0f), 0.0f, 100.0f);
 
   settings.show_graphic_options = table["graphics"]["show_options"].value_or(false);
+  settings.threaded_rendering = table["graphics"]["threaded_rendering"].value_or(false);
+  settings.frame_buffer_format = magic_enum::enum_cast<FrameBufferFormat>(table["graphics"]["frame_buffer_format"].value_or(""))
+    .value_or(FrameBufferFormat::kIndexed8);
+  settings.color_correction = magic_enum::enum_cast<ColorCorrection>(table["graphics"]["color_correction"].value_or(""))
+    .value_or(ColorCorrection::kGbcLcd);
 
   std::array<Color, 4> palette = kDefaultPalette;
   if (auto arr = table["graphics"]["palette"].as_array()) {
@@ -305,24 +345,25 @@ static auto SpdLogTraceLog(int log_level, const char* text, va_list args) -> voi
 }
 
 static u8 MemEditorCustomRead(const u8* data, size_t offset, void* user_data) {
-  auto emulator = static_cast<Emulator*>(user_data);
-  return emulator->Read8(offset);
+  auto emulator_thread = static_cast<EmulatorThread*>(user_data);
+  return emulator_thread->GetSnapshot().Read8(offset);
 }
 
 static void MemEditorCustomWrite(u8* data, size_t offset, u8 d, void* user_data) {
-  auto emulator = static_cast<Emulator*>(user_data);
-  emulator->Write8(offset, d);
+  auto emulator_thread = static_cast<EmulatorThread*>(user_data);
+  emulator_thread->Submit(cmd::Write8{ .addr = static_cast<u16>(offset), .byte = d });
 }
 
 static u32 MemEditorCustomBgColor(const u8* data, size_t offset, void* user_data) {
-  auto emulator = static_cast<Emulator*>(user_data);
+  auto emulator_thread = static_cast<EmulatorThread*>(user_data);
+  const auto& regs = emulator_thread->GetSnapshot().registers;
 
-  u16 pc = emulator->GetRegisters().pc;
+  u16 pc = regs.pc;
   if (pc == offset || pc == offset + 1) {
     return IM_COL32(128, 24, 21, 255);
   }
 
-  u16 sp = emulator->GetRegisters().sp;
+  u16 sp = regs.sp;
   if (sp == offset || sp == offset + 1) {
     return IM_COL32(32, 72, 128, 255);
   }
@@ -330,6 +371,24 @@ static u32 MemEditorCustomBgColor(const u8* data, size_t offset, void* user_data
   return IM_COL32(0, 0, 0, 0);
 }
 
+// Accepts decimal or 0x-prefixed hex, as typed into the debugger popups.
+static auto ParseNumber(const std::string& text) -> std::optional<u16> {
+  try {
+    int val;
+    if (text.starts_with("0x") || text.starts_with("0X")) {
+      val = std::stoi(text.substr(2), nullptr, 16);
+    } else {
+      val = std::stoi(text);
+    }
+
+    if (val >= 0 && val < 65536) {
+      return static_cast<u16>(val);
+    }
+  } catch (std::exception&) {
+  }
+  return std::nullopt;
+}
+
 static void AudioInputCallback(void *buffer, unsigned int frames) {
   std::span<float> buffer_span{static_cast<float*>(buffer), frames * kAudioNumChannels};
   g_audio_callback(buffer_span);
@@ -343,9 +402,9 @@ void Interface::Init(Args args) {
   mem_editor_.ReadFn = MemEditorCustomRead;
   mem_editor_.WriteFn = MemEditorCustomWrite;
   mem_editor_.BgColorFn = MemEditorCustomBgColor;
-  mem_editor_.UserData = static_cast<void*>(&emulator_);
+  mem_editor_.UserData = static_cast<void*>(&emulator_thread_);
 
-  assembly_viewer_.Initialize(&emulator_);
+  assembly_viewer_.Initialize(&emulator_thread_);
 
   SetTraceLogCallback(SpdLogTraceLog);
 
@@ -421,6 +480,14 @@ void Interface::Init(Args args) {
   };
 
   emulator_.Init(emu_cfg);
+  emulator_.SetThreadedRendering(config_.settings.threaded_rendering);
+  emulator_.SetFrameBufferFormat(config_.settings.frame_buffer_format);
+  emulator_.SetColorCorrection(config_.settings.color_correction);
+  emulator_thread_.Init({
+    .emulator = &emulator_,
+    .frame_time = kTargetEmulatorFrameTime,
+  });
+  UpdateShmExport();
 
   if (auto result = emulator_.SetBootRomPath(HardwareMode::kDmgMode, config_.settings.dmg_boot_rom_path); !result) {
     spdlog::error("Failed to set boot rom path: {}", result.error());
@@ -436,6 +503,21 @@ void Interface::Init(Args args) {
     error_messages_.ClearError(kErrorKeyCgbBootRom);
   }
 
+  emulator_.SetCpuCore(args_.cpu_core);
+  emulator_.SetVerifyCpuCore(args_.verify_cpu_core);
+  spdlog::info("CPU core: {}{}", magic_enum::enum_name(args_.cpu_core), args_.verify_cpu_core ? " (verified)" : "");
+
+  emulator_.SetDoctorMode(args_.doctor_log);
+  if (!args_.trace_path.empty()) {
+    if (auto result = emulator_.StartTrace(args_.trace_path); !result) {
+      spdlog::error("Failed to start trace: {}", result.error());
+    }
+  }
+
+  emulator_.SetSkipBootRom(config_.settings.skip_boot_rom);
+  emulator_.SetSubFrameInput(config_.settings.sub_frame_input);
+  emulator_thread_.SetThreaded(config_.settings.emulation_thread);
+
   while (!IsWindowReady()) {
     // pass
   }
@@ -463,8 +545,6 @@ void Interface::Run() {
 
   PlayAudioStream(stream);
 
-  emulator_.SetSkipBootRom(config_.settings.skip_boot_rom);
-
   while (!should_close_) {
     Update();
   }
@@ -483,7 +563,6 @@ void Interface::Update() {
     should_close_ = true;
   }
 
-  const auto frame_time = GetFrameTime();
   config_.settings.screen_width = GetScreenWidth();
   config_.settings.screen_height = GetScreenHeight();
 
@@ -503,28 +582,56 @@ void Interface::Update() {
 
   const int gamepad = 0;
 
-  emulator_.UpdateInput(JoypadButton::Up, g_button_state[magic_enum::enum_integer(JoypadButton::Up)] || IsKeyDown(KEY_UP) || IsKeyDown(KEY_W) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_UP));
-  emulator_.UpdateInput(JoypadButton::Down, g_button_state[magic_enum::enum_integer(JoypadButton::Down)] || IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_DOWN));
-  emulator_.UpdateInput(JoypadButton::Left, g_button_state[magic_enum::enum_integer(JoypadButton::Left)] || IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_LEFT));
-  emulator_.UpdateInput(JoypadButton::Right, g_button_state[magic_enum::enum_integer(JoypadButton::Right)] || IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_RIGHT));
-  emulator_.UpdateInput(JoypadButton::Select, g_button_state[magic_enum::enum_integer(JoypadButton::Select)] || IsKeyDown(KEY_U) || IsKeyDown(KEY_RIGHT_SHIFT) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_MIDDLE_LEFT));
-  emulator_.UpdateInput(JoypadButton::Start, g_button_state[magic_enum::enum_integer(JoypadButton::Start)] || IsKeyDown(KEY_I) || IsKeyDown(KEY_ENTER) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_MIDDLE_RIGHT));
-  emulator_.UpdateInput(JoypadButton::B, g_button_state[magic_enum::enum_integer(JoypadButton::B)] || IsKeyDown(KEY_J) || IsKeyDown(KEY_Z) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_LEFT) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_UP));
-  emulator_.UpdateInput(JoypadButton::A, g_button_state[magic_enum::enum_integer(JoypadButton::A)] || IsKeyDown(KEY_K) || IsKeyDown(KEY_X) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_RIGHT) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_DOWN));
+  const auto input_timestamp = EmulatorThread::Clock::now();
+  ButtonStates buttons {};
+  auto set_button = [&buttons](JoypadButton btn, bool down) {
+    const auto idx = magic_enum::enum_integer(btn);
+    buttons[idx] = g_button_state[idx] || down;
+  };
+  set_button(JoypadButton::Up, IsKeyDown(KEY_UP) || IsKeyDown(KEY_W) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_UP));
+  set_button(JoypadButton::Down, IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_DOWN));
+  set_button(JoypadButton::Left, IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_LEFT));
+  set_button(JoypadButton::Right, IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_LEFT_FACE_RIGHT));
+  set_button(JoypadButton::Select, IsKeyDown(KEY_U) || IsKeyDown(KEY_RIGHT_SHIFT) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_MIDDLE_LEFT));
+  set_button(JoypadButton::Start, IsKeyDown(KEY_I) || IsKeyDown(KEY_ENTER) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_MIDDLE_RIGHT));
+  set_button(JoypadButton::B, IsKeyDown(KEY_J) || IsKeyDown(KEY_Z) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_LEFT) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_UP));
+  set_button(JoypadButton::A, IsKeyDown(KEY_K) || IsKeyDown(KEY_X) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_RIGHT) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_FACE_DOWN));
+
+  if (buttons != buttons_) {
+    buttons_ = buttons;
+    emulator_thread_.SetInput(buttons, input_timestamp);
+  }
 
   ClearButtonState();
 
-  static double last_update = 0;
-  if (emulator_.IsPlaying()) {
-    last_update += GetFrameTime();
-    while (last_update >= kTargetEmulatorFrameTime) {
-      emulator_.Update(frame_time);
-      last_update -= kTargetEmulatorFrameTime;
-    }
-  } else {
-    last_update = 0;
+  if (IsKeyPressed(KEY_F12) && emulator_thread_.GetSnapshot().cart_loaded) {
+    TakeScreenshot(IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT));
+  }
+
+  const bool turbo = IsKeyDown(KEY_TAB) || IsGamepadButtonDown(gamepad, GAMEPAD_BUTTON_RIGHT_TRIGGER_2);
+  speed_ = turbo ? config_.settings.turbo_speed : 1;
+  emulator_thread_.SetSpeed(speed_);
+  emulator_thread_.SetCaptureMemory(config_.settings.show_memory || config_.settings.show_instructions);
+
+  emulator_thread_.Update(GetFrameTime());
+  emulator_thread_.AcquireSnapshot();
+  if (const auto* output = emulator_thread_.AcquireFrame()) {
+    emulator_.PresentFrame(output->frame, output->dmg_palette, output->format);
+  }
+
+  const auto& snapshot = emulator_thread_.GetSnapshot();
+  if (snapshot.playing) {
+    UpdateFrameSkip(snapshot, speed_);
   }
 
+  emulator_thread_.UpdateRenderTargets({
+    .tiles = config_.settings.show_tiles,
+    .tilemap1 = config_.settings.show_tilemap1,
+    .tilemap2 = config_.settings.show_tilemap2,
+    .sprites = config_.settings.show_sprites,
+    .palettes = config_.settings.show_palettes,
+  });
+
   if (IsShaderValid(g_screen_shader)) {
     BeginTextureMode(g_screen_target);
     BeginShaderMode(g_screen_shader);
@@ -577,6 +684,89 @@ void Interface::Update() {
   FrameMark;
 }
 
+void Interface::UpdateFrameSkip(const EmulatorSnapshot& snapshot, int speed) {
+  // Only a snapshot with newly run frames carries a new measurement, host
+  // frames in between (high refresh rate displays) leave the value alone.
+  const bool measured = snapshot.frames_run != frame_skip_frames_run_;
+  frame_skip_frames_run_ = snapshot.frames_run;
+
+  if (!config_.settings.auto_frame_skip) {
+    auto_frame_skip_ = config_.settings.frame_skip;
+  } else if (measured) {
+    if (snapshot.emulation_time > kTargetEmulatorFrameTime * kAutoFrameSkipRaise) {
+      auto_frame_skip_ = std::min(auto_frame_skip_ + 1, kMaxFrameSkip);
+    } else if (snapshot.emulation_time < kTargetEmulatorFrameTime * kAutoFrameSkipLower) {
+      auto_frame_skip_ = std::max(auto_frame_skip_ - 1, config_.settings.frame_skip);
+    }
+  }
+
+  // Turbo skips at least the extra frames it runs. That floor is applied
+  // here only, so the auto value neither climbs during turbo nor has to
+  // decay after it.
+  const auto frame_skip = static_cast<u8>(std::max(auto_frame_skip_, speed - 1));
+  if (frame_skip != snapshot.frame_skip) {
+    emulator_thread_.Submit(cmd::SetFrameSkip{ .frame_skip = frame_skip });
+  }
+}
+
+void Interface::UpdateShmExport() {
+  auto emulator = emulator_thread_.Lock();
+  if (!config_.settings.shm_export) {
+    emulator->DisableShmExport();
+    error_messages_.ClearError(kErrorKeyShmExport);
+    return;
+  }
+  if (emulator->IsShmExportEnabled()) {
+    return;
+  }
+
+  if (auto result = emulator->EnableShmExport(config_.settings.shm_export_name); !result) {
+    spdlog::error("Failed to start shared memory export: {}", result.error());
+    error_messages_.AddError(kErrorKeyShmExport, std::format("Failed to start shared memory export: {}", result.error()));
+    config_.settings.shm_export = false;
+  } else {
+    error_messages_.ClearError(kErrorKeyShmExport);
+  }
+}
+
+void Interface::ToggleRecording() {
+  auto emulator = emulator_thread_.Lock();
+  if (emulator->IsRecording()) {
+    emulator->StopRecording();
+    return;
+  }
+
+  const auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+  const auto path = std::format("recording_{:%Y%m%d_%H%M%S}", now);
+  if (auto result = emulator->StartRecording(path, config_.settings.record_policy); !result) {
+    spdlog::error("Failed to start recording: {}", result.error());
+    error_messages_.AddError(kErrorKeyRecording, std::format("Failed to start recording: {}", result.error()));
+  } else {
+    error_messages_.ClearError(kErrorKeyRecording);
+  }
+}
+
+void Interface::TakeScreenshot(bool burst) {
+  const ScreenshotOptions options{
+    .filter = config_.settings.screenshot_filter,
+    .scale = config_.settings.screenshot_scale,
+  };
+
+  const auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+  const auto path = std::format("screenshot_{:%Y%m%d_%H%M%S}", now);
+  auto emulator = emulator_thread_.Lock();
+  auto result = burst
+    ? emulator->StartScreenshotBurst(path, config_.settings.screenshot_burst_frames, options)
+    : emulator->TakeScreenshot(std::format("{}.png", path), options);
+
+  if (!result) {
+    spdlog::error("Failed to take screenshot: {}", result.error());
+    error_messages_.AddError(kErrorKeyScreenshot, std::format("Failed to take screenshot: {}", result.error()));
+  } else {
+    error_messages_.ClearError(kErrorKeyScreenshot);
+  }
+}
+
 void Interface::ConfigureDockSpace() {
   ImGuiID dockspace_id = ImGui::DockSpaceOverViewport(0, ImGui::GetMainViewport());
   if (config_.settings.reset_view) {
@@ -630,22 +820,22 @@ void HandleUploadFile(std::string const &filename, std::string const &mime_type,
 }
 
 void Interface::LoadCartridge() {
-  g_was_playing = emulator_.IsPlaying();
-  emulator_.Stop();
+  g_was_playing = emulator_thread_.GetSnapshot().playing;
+  emulator_thread_.Submit(cmd::Stop{});
   emscripten_browser_file::upload(".gb,.bin,.rom", HandleUploadFile, this);
 }
 
 void Interface::LoadCartridgeCallback(std::string_view buffer) {
   if (buffer.empty()) {
     if (g_was_playing) {
-      emulator_.Play();
+      emulator_thread_.Submit(cmd::Play{});
     }
     return;
   }
 
   spdlog::info("File upload succeeded...");
   std::vector<u8> rom_bytes(buffer.begin(), buffer.end());
-  emulator_.LoadCartBytes(std::move(rom_bytes));
+  emulator_thread_.Lock()->LoadCartBytes(std::move(rom_bytes));
 
   if (config_.settings.auto_start) {
     Play();
@@ -659,8 +849,8 @@ void Interface::LoadCartridgeCallback(std::string_view) {
 }
 
 void Interface::LoadCartridge() {
-  bool was_playing = emulator_.IsPlaying();
-  emulator_.Stop();
+  bool was_playing = emulator_thread_.GetSnapshot().playing;
+  emulator_thread_.Submit(cmd::Stop{});
 
   nfdchar_t* file_path = nullptr;
   std::array<nfdfilteritem_t, 4> filter_items = {{
@@ -676,7 +866,7 @@ void Interface::LoadCartridge() {
   } else if (result == NFD_CANCEL) {
     spdlog::info("Load cancelled by user.");
     if (was_playing) {
-      emulator_.Play();
+      emulator_thread_.Submit(cmd::Play{});
     }
   } else {
     spdlog::error("Loading failed: {}", NFD_GetError());
@@ -707,14 +897,16 @@ void Interface::LoadCartRom(std::string_view file_path) {
     error_messages_.ClearError(kErrorKeyCartRom);
   }
 
-  emulator_.LoadCartBytes(std::move(load_result.value()));
+  {
+    auto emulator = emulator_thread_.Lock();
+    emulator->LoadCartBytes(std::move(load_result.value()));
+    emulator->ToggleChannel(AudioChannelID::MASTER, config_.settings.enable_audio);
+  }
   spdlog::info("Loaded cartridge: '{}'", fs::absolute(path).string());
 
   fs::path rom_path{path};
   SetWindowTitle(std::format("{} - {}", kWindowTitle, rom_path.stem().string()).c_str());
 
-  emulator_.ToggleChannel(AudioChannelID::MASTER, config_.settings.enable_audio);
-
   if (config_.settings.auto_start) {
     Play();
   }
@@ -723,7 +915,7 @@ void Interface::LoadCartRom(std::string_view file_path) {
 }
 
 void Interface::UnloadCartridge() {
-  emulator_.ClearCartBytes();
+  emulator_thread_.Lock()->ClearCartBytes();
 }
 
 void Interface::RenderDebugger() {
@@ -734,8 +926,8 @@ void Interface::RenderDebugger() {
   }
 
   if (ImGui::Begin("Debugger", &config_.settings.show_debugger)) {
-    const auto is_cart_loaded = emulator_.IsCartLoaded();
-    const auto is_playing = emulator_.IsPlaying();
+    const auto is_cart_loaded = emulator_thread_.GetSnapshot().cart_loaded;
+    const auto is_playing = emulator_thread_.GetSnapshot().playing;
 
     ImGuiStyle& style = ImGui::GetStyle();
     const int num_buttons = 5;
@@ -785,31 +977,69 @@ void Interface::RenderDebugger() {
 void Interface::RenderBreakpoints() {
   ZoneScoped;
 
-  bool add_breakpoint;
+  bool add_breakpoint = false;
+  bool add_watchpoint = false;
 
   if (config_.settings.show_breakpoints) {
     if (ImGui::Begin("Breakpoints", &config_.settings.show_breakpoints)) {
-      add_breakpoint = ImGui::Button("Add");
+      const auto& snapshot = emulator_thread_.GetSnapshot();
 
-      ImGui::SameLine();
-      if (ImGui::Button("Clear")) {
-        emulator_.ClearBreakPoints();
-      }
+      if (ImGui::BeginTabBar("debug_points")) {
+        if (ImGui::BeginTabItem("Breakpoints")) {
+          add_breakpoint = ImGui::Button("Add");
+
+          ImGui::SameLine();
+          if (ImGui::Button("Clear")) {
+            emulator_thread_.Submit(cmd::ClearBreakPoints{});
+          }
+
+          if (ImGui::BeginChild("scrolling", ImVec2(0, 0), ImGuiChildFlags_None, ImGuiWindowFlags_HorizontalScrollbar)) {
+            const auto& breakpoints = snapshot.breakpoints;
+            ImGuiListClipper clipper;
+            clipper.Begin(breakpoints.size());
+            while (clipper.Step()) {
+              for (int line = clipper.DisplayStart; line < clipper.DisplayEnd; line++) {
+                const auto& breakpoint = breakpoints[line];
+                if (breakpoint.bank) {
+                  ImGui::Text("0x%04X (bank %d)", breakpoint.addr, *breakpoint.bank);
+                } else {
+                  ImGui::Text("0x%04X", breakpoint.addr);
+                }
+              }
+            }
+            clipper.End();
+
+            ImGui::EndChild();
+          }
+          ImGui::EndTabItem();
+        }
+
+        if (ImGui::BeginTabItem("Watchpoints")) {
+          add_watchpoint = ImGui::Button("Add");
 
-      if (ImGui::BeginChild("scrolling", ImVec2(0, 0), ImGuiChildFlags_None, ImGuiWindowFlags_HorizontalScrollbar)) {
-        auto& breakpoints = emulator_.GetBreakpoints();
-        ImGuiListClipper clipper;
-        clipper.Begin(emulator_.GetBreakpoints().size());
-        while (clipper.Step()) {
-          int line = clipper.DisplayStart;
-          auto it = std::next(breakpoints.begin(), line);
-          for (; line < clipper.DisplayEnd; it++, line++) {
-            ImGui::Text("0x%02X", *it);
+          ImGui::SameLine();
+          if (ImGui::Button("Clear")) {
+            emulator_thread_.Submit(cmd::ClearWatchPoints{});
           }
+
+          if (ImGui::BeginChild("scrolling", ImVec2(0, 0), ImGuiChildFlags_None, ImGuiWindowFlags_HorizontalScrollbar)) {
+            const auto& watchpoints = snapshot.watchpoints;
+            ImGuiListClipper clipper;
+            clipper.Begin(watchpoints.size());
+            while (clipper.Step()) {
+              for (int line = clipper.DisplayStart; line < clipper.DisplayEnd; line++) {
+                const auto& watchpoint = watchpoints[line];
+                ImGui::Text("0x%04X %s%s", watchpoint.addr, watchpoint.read ? "R" : "", watchpoint.write ? "W" : "");
+              }
+            }
+            clipper.End();
+
+            ImGui::EndChild();
+          }
+          ImGui::EndTabItem();
         }
-        clipper.End();
 
-        ImGui::EndChild();
+        ImGui::EndTabBar();
       }
 
       ImGui::End();
@@ -817,13 +1047,16 @@ void Interface::RenderBreakpoints() {
   }
 
   static std::string text;
+  static std::string bank_text;
   if (add_breakpoint) {
     text = "";
+    bank_text = "";
     ImGui::OpenPopup("Add breakpoint");
   }
 
   if (ImGui::BeginPopupModal("Add breakpoint", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
     ImGui::InputText("Address", &text);
+    ImGui::InputText("Bank (optional)", &bank_text);
 
     if (ImGui::Button("Cancel")) {
       ImGui::CloseCurrentPopup();
@@ -831,28 +1064,52 @@ void Interface::RenderBreakpoints() {
 
     ImGui::SameLine();
     if (ImGui::Button("Add")) {
-      try {
-        int val;
-        if (text.starts_with("0x") || text.starts_with("0X")) {
-          val = std::stoi(text.substr(2), nullptr, 16);
-        } else {
-          val = std::stoi(text);
-        }
+      auto addr = ParseNumber(text);
+      auto bank = bank_text.empty() ? std::optional<u16>{} : ParseNumber(bank_text);
+      if (addr && (bank_text.empty() || bank)) {
+        emulator_thread_.Submit(cmd::AddBreakPoint{ .addr = *addr, .bank = bank });
+        text = "";
+        bank_text = "";
+        ImGui::CloseCurrentPopup();
+      } else {
+        spdlog::error("Invalid breakpoint: {} {}", text, bank_text);
+      }
+    }
 
-        if (val >= 0 && val < 65536) {
-          emulator_.AddBreakPoint(val);
-        }
+    ImGui::EndPopup();
+  }
+
+  static bool watch_read = false;
+  static bool watch_write = true;
+  if (add_watchpoint) {
+    text = "";
+    ImGui::OpenPopup("Add watchpoint");
+  }
+
+  if (ImGui::BeginPopupModal("Add watchpoint", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+    ImGui::InputText("Address", &text);
+    ImGui::Checkbox("Read", &watch_read);
+    ImGui::SameLine();
+    ImGui::Checkbox("Write", &watch_write);
+
+    if (ImGui::Button("Cancel")) {
+      ImGui::CloseCurrentPopup();
+    }
 
+    ImGui::SameLine();
+    if (ImGui::Button("Add")) {
+      auto addr = ParseNumber(text);
+      if (addr && (watch_read || watch_write)) {
+        emulator_thread_.Submit(cmd::AddWatchPoint{ Watchpoint{ .addr = *addr, .read = watch_read, .write = watch_write } });
         text = "";
         ImGui::CloseCurrentPopup();
-      } catch (std::exception&) {
-        spdlog::error("Invalid breakpoint address: {}", text);
+      } else {
+        spdlog::error("Invalid watchpoint: {}", text);
       }
     }
 
     ImGui::EndPopup();
   }
-
 }
 
 void Interface::RenderLCD() {
@@ -965,7 +1222,8 @@ void Interface::RenderRegisters() {
   }
 
   if (ImGui::Begin("Registers", &config_.settings.show_cpu_registers)) {
-    auto& regs = emulator_.GetRegisters();
+    const auto& snapshot = emulator_thread_.GetSnapshot();
+    const auto& regs = snapshot.registers;
 
     auto a = regs.Get(Reg8::A);
     auto f = regs.Get(Reg8::F);
@@ -988,7 +1246,7 @@ void Interface::RenderRegisters() {
     if (ImGui::InputText("PC##Input", &pc_str)) {
       try {
         int new_pc = std::stoi(pc_str, nullptr, 16);
-        regs.pc = new_pc;
+        emulator_thread_.Submit(cmd::SetPc{ .pc = static_cast<u16>(new_pc) });
       } catch (std::exception& e) {
         // pass
       }
@@ -1000,7 +1258,7 @@ void Interface::RenderRegisters() {
     ImGui::Text("AF=%04X BC=%04X DE=%04X HL=%04X", af, bc, de, hl);
     ImGui::Text("Flags Z=%d N=%d H=%d C=%d", zero, neg, half_carry, carry);
 
-    const auto& state = emulator_.GetState();
+    const auto& state = snapshot.state;
     ImGui::Text("State IME=%d HALT=%d STOP=%d HARD_LOCK=%d", state.ime, state.halt, state.stop, state.hard_lock);
   }
   ImGui::End();
@@ -1041,7 +1299,7 @@ void Interface::RenderInput() {
 
     alignForWidth(288);
     ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 32);
-    drawMaybePressed(emulator_.IsButtonPressed(JoypadButton::Up), [&]() {
+    drawMaybePressed(emulator_thread_.GetSnapshot().IsButtonPressed(JoypadButton::Up), [&]() {
       ImGui::Button(ICON_FA_CARET_UP, { 32, 32 });
       if (ImGui::IsItemActive()) {
         SetButtonPressed(JoypadButton::Up);
@@ -1051,14 +1309,14 @@ void Interface::RenderInput() {
     ImGui::SameLine(0, 32);
     ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(6, 2));
     ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 8.0f);
-    drawMaybePressed(emulator_.IsButtonPressed(JoypadButton::Select), [&]() {
+    drawMaybePressed(emulator_thread_.GetSnapshot().IsButtonPressed(JoypadButton::Select), [&]() {
       ImGui::Button("select");
       if (ImGui::IsItemActive()) {
         SetButtonPressed(JoypadButton::Select);
       }
     });
     ImGui::SameLine(0, 4);
-    drawMaybePressed(emulator_.IsButtonPressed(JoypadButton::Start), [&]() {
+    drawMaybePressed(emulator_thread_.GetSnapshot().IsButtonPressed(JoypadButton::Start), [&]() {
       ImGui::Button("start");
       if (ImGui::IsItemActive()) {
         SetButtonPressed(JoypadButton::Start);
@@ -1069,14 +1327,14 @@ void Interface::RenderInput() {
 
     ImGui::NewLine();
     alignForWidth(288);
-    drawMaybePressed(emulator_.IsButtonPressed(JoypadButton::Left), [&]() {
+    drawMaybePressed(emulator_thread_.GetSnapshot().IsButtonPressed(JoypadButton::Left), [&]() {
       ImGui::Button(ICON_FA_CARET_LEFT, { 32, 32 });
       if (ImGui::IsItemActive()) {
         SetButtonPressed(JoypadButton::Left);
       }
     });
     ImGui::SameLine(0, 32);
-    drawMaybePressed(emulator_.IsButtonPressed(JoypadButton::Right), [&]() {
+    drawMaybePressed(emulator_thread_.GetSnapshot().IsButtonPressed(JoypadButton::Right), [&]() {
       ImGui::Button(ICON_FA_CARET_RIGHT, { 32, 32 });
       if (ImGui::IsItemActive()) {
         SetButtonPressed(JoypadButton::Right);
@@ -1085,14 +1343,14 @@ void Interface::RenderInput() {
 
     ImGui::SameLine(0, 64);
     ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 24.0f);
-    drawMaybePressed(emulator_.IsButtonPressed(JoypadButton::B), [&]() {
+    drawMaybePressed(emulator_thread_.GetSnapshot().IsButtonPressed(JoypadButton::B), [&]() {
       ImGui::Button("B", { 32, 32 });
       if (ImGui::IsItemActive()) {
         SetButtonPressed(JoypadButton::B);
       }
     });
     ImGui::SameLine();
-    drawMaybePressed(emulator_.IsButtonPressed(JoypadButton::A), [&]() {
+    drawMaybePressed(emulator_thread_.GetSnapshot().IsButtonPressed(JoypadButton::A), [&]() {
       ImGui::Button("A", { 32, 32 });
       if (ImGui::IsItemActive()) {
         SetButtonPressed(JoypadButton::A);
@@ -1103,7 +1361,7 @@ void Interface::RenderInput() {
     ImGui::NewLine();
     alignForWidth(288);
     ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 32);
-    drawMaybePressed(emulator_.IsButtonPressed(JoypadButton::Down), [&]() {
+    drawMaybePressed(emulator_thread_.GetSnapshot().IsButtonPressed(JoypadButton::Down), [&]() {
       ImGui::Button(ICON_FA_CARET_DOWN, { 32, 32 });
       if (ImGui::IsItemActive()) {
         SetButtonPressed(JoypadButton::Down);
@@ -1112,6 +1370,18 @@ void Interface::RenderInput() {
 
     ImGui::PopStyleVar();
     ImGui::PopStyleVar();
+
+    ImGui::NewLine();
+    ImGui::Separator();
+    const auto& latency = emulator_thread_.GetSnapshot().input_latency;
+    ImGui::Text("Latency %.2f ms avg, %.2f ms max (%llu inputs)", latency.Average(), latency.max_ms, static_cast<unsigned long long>(latency.count));
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("Host time from sampling the input to the game reading it from P1");
+    }
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Reset")) {
+      emulator_thread_.Lock()->ResetInputLatencyStats();
+    }
   }
   ImGui::End();
 }
@@ -1205,7 +1475,7 @@ void Interface::RenderGraphicOptions() {
       spdlog::debug("  2: ({}, {}, {}, {})", p[2].r, p[2].g, p[2].b, p[2].a);
       spdlog::debug("  3: ({}, {}, {}, {})", p[3].r, p[3].g, p[3].b, p[3].a);
 
-      emulator_.UpdatePalette(config_.settings.palette);
+      emulator_thread_.Submit(cmd::UpdatePalette{ .palette = config_.settings.palette });
     }
   }
   ImGui::End();
@@ -1222,7 +1492,8 @@ void Interface::RenderMainMenu() {
       LoadCartridge();
     }
 
-    if (ImGui::MenuItem("Unload Cartridge", nullptr, nullptr, emulator_.IsCartLoaded())) {
+    const auto& snapshot = emulator_thread_.GetSnapshot();
+    if (ImGui::MenuItem("Unload Cartridge", nullptr, nullptr, snapshot.cart_loaded)) {
       spdlog::info("Unloading cart...");
       Stop();
       UnloadCartridge();
@@ -1256,6 +1527,52 @@ void Interface::RenderMainMenu() {
       ImGui::EndMenu();
     }
 
+    ImGui::Separator();
+    if (ImGui::MenuItem(snapshot.recording ? "Stop Recording" : "Start Recording", nullptr, nullptr, snapshot.cart_loaded)) {
+      ToggleRecording();
+    }
+    if (ImGui::MenuItem("Screenshot", "F12", nullptr, snapshot.cart_loaded)) {
+      TakeScreenshot(false);
+    }
+    if (ImGui::MenuItem("Screenshot Burst", "Shift+F12", nullptr, snapshot.cart_loaded && !snapshot.screenshot_burst)) {
+      TakeScreenshot(true);
+    }
+    if (ImGui::BeginMenu("Screenshot Options")) {
+      const auto filter = config_.settings.screenshot_filter;
+      if (ImGui::MenuItem("Nearest", nullptr, filter == upscaler::Filter::kNearest)) {
+        config_.settings.screenshot_filter = upscaler::Filter::kNearest;
+      }
+      if (ImGui::MenuItem("Scale2x", nullptr, filter == upscaler::Filter::kScale2x)) {
+        config_.settings.screenshot_filter = upscaler::Filter::kScale2x;
+      }
+      if (ImGui::MenuItem("Scale3x", nullptr, filter == upscaler::Filter::kScale3x)) {
+        config_.settings.screenshot_filter = upscaler::Filter::kScale3x;
+      }
+      if (ImGui::MenuItem("xBR Lite", nullptr, filter == upscaler::Filter::kXbrLite)) {
+        config_.settings.screenshot_filter = upscaler::Filter::kXbrLite;
+      }
+      ImGui::Separator();
+      for (int scale = 1; scale <= kMaxScreenshotScale; scale += 1) {
+        const bool supported = scale == 1 || upscaler::SupportsScale(config_.settings.screenshot_filter, scale);
+        if (ImGui::MenuItem(std::format("x{}", scale).c_str(), nullptr, config_.settings.screenshot_scale == scale, supported)) {
+          config_.settings.screenshot_scale = scale;
+        }
+      }
+      ImGui::Separator();
+      ImGui::SliderInt("Burst Frames", &config_.settings.screenshot_burst_frames, 1, kMaxScreenshotBurstFrames);
+      ImGui::EndMenu();
+    }
+    if (ImGui::BeginMenu("Recording Queue")) {
+      const auto policy = config_.settings.record_policy;
+      if (ImGui::MenuItem("Drop Frames", nullptr, policy == RecordQueuePolicy::kDropFrames)) {
+        config_.settings.record_policy = RecordQueuePolicy::kDropFrames;
+      }
+      if (ImGui::MenuItem("Block Emulation", nullptr, policy == RecordQueuePolicy::kBlock)) {
+        config_.settings.record_policy = RecordQueuePolicy::kBlock;
+      }
+      ImGui::EndMenu();
+    }
+
     ImGui::Separator();
     if (ImGui::MenuItem("Settings...")) {
       spdlog::debug("Open settings...");
@@ -1274,26 +1591,41 @@ void Interface::RenderMainMenu() {
     ImGui::EndMenu();
   }
   if (ImGui::BeginMenu("Emulator")) {
-    const auto is_cart_loaded = emulator_.IsCartLoaded();
-    const auto is_playing = emulator_.IsPlaying();
+    const auto is_cart_loaded = emulator_thread_.GetSnapshot().cart_loaded;
+    const auto is_playing = emulator_thread_.GetSnapshot().playing;
 
     ImGui::MenuItem("Auto-Start", nullptr, &config_.settings.auto_start);
     if (ImGui::MenuItem("Skip Boot ROM", nullptr, &config_.settings.skip_boot_rom)) {
-      emulator_.SetSkipBootRom(config_.settings.skip_boot_rom);
+      emulator_thread_.Lock()->SetSkipBootRom(config_.settings.skip_boot_rom);
     }
     if (ImGui::BeginMenu("Emulation Mode")) {
-      const auto mode = emulator_.GetEmulationMode();
+      const auto mode = emulator_thread_.GetSnapshot().emulation_mode;
+      std::optional<EmulationMode> selected;
       if (ImGui::MenuItem("Auto", nullptr, mode == EmulationMode::kAutoMode)) {
-        emulator_.SetEmulationMode(EmulationMode::kAutoMode);
+        selected = EmulationMode::kAutoMode;
       }
       if (ImGui::MenuItem("GameBoy", nullptr, mode == EmulationMode::kDmgMode)) {
-        emulator_.SetEmulationMode(EmulationMode::kDmgMode);
+        selected = EmulationMode::kDmgMode;
       }
       if (ImGui::MenuItem("GameBoy Color", nullptr, mode == EmulationMode::kCgbMode)) {
-        emulator_.SetEmulationMode(EmulationMode::kCgbMode);
+        selected = EmulationMode::kCgbMode;
+      }
+      if (selected) {
+        emulator_thread_.Lock()->SetEmulationMode(*selected);
       }
       ImGui::EndMenu();
     }
+#if !defined(__EMSCRIPTEN__)
+    if (ImGui::MenuItem("Emulation Thread", nullptr, &config_.settings.emulation_thread)) {
+      emulator_thread_.SetThreaded(config_.settings.emulation_thread);
+    }
+#endif
+    if (ImGui::MenuItem("Sub-frame Input", nullptr, &config_.settings.sub_frame_input)) {
+      emulator_thread_.Lock()->SetSubFrameInput(config_.settings.sub_frame_input);
+    }
+    if (ImGui::MenuItem("Shared Memory Export", nullptr, &config_.settings.shm_export)) {
+      UpdateShmExport();
+    }
     ImGui::Separator();
     if (ImGui::MenuItem("Play", nullptr, nullptr, is_cart_loaded && !is_playing)) {
       Play();
@@ -1302,6 +1634,25 @@ void Interface::RenderMainMenu() {
       Stop();
     }
     ImGui::Separator();
+    if (ImGui::BeginMenu("Frame Skip")) {
+      ImGui::MenuItem("Auto", nullptr, &config_.settings.auto_frame_skip);
+      ImGui::Separator();
+      for (int i = 0; i <= kMaxFrameSkip; i += 1) {
+        if (ImGui::MenuItem(std::format("{}", i).c_str(), nullptr, config_.settings.frame_skip == i)) {
+          config_.settings.frame_skip = i;
+        }
+      }
+      ImGui::EndMenu();
+    }
+    if (ImGui::BeginMenu("Turbo Speed")) {
+      for (int speed : { 2, 4, 8, 16 }) {
+        if (ImGui::MenuItem(std::format("x{}", speed).c_str(), nullptr, config_.settings.turbo_speed == speed)) {
+          config_.settings.turbo_speed = speed;
+        }
+      }
+      ImGui::EndMenu();
+    }
+    ImGui::Separator();
     if (ImGui::MenuItem("Step", nullptr, nullptr, is_cart_loaded && !is_playing)) {
       Step();
     }
@@ -1314,12 +1665,12 @@ void Interface::RenderMainMenu() {
   if (ImGui::BeginMenu("Hardware")) {
     if (ImGui::BeginMenu("CPU")) {
       if (ImGui::BeginMenu("Clock speed")) {
-        const auto clock_speed = emulator_.GetClockSpeed();
+        const auto clock_speed = emulator_thread_.GetSnapshot().clock_speed;
         if (ImGui::MenuItem("4MHz", nullptr, clock_speed == kDmgClockSpeed)) {
-          emulator_.SetClockSpeed(kDmgClockSpeed);
+          emulator_thread_.Lock()->SetClockSpeed(kDmgClockSpeed);
         }
         if (ImGui::MenuItem("8MHz", nullptr, clock_speed == kGbcClockSpeed)) {
-          emulator_.SetClockSpeed(kGbcClockSpeed);
+          emulator_thread_.Lock()->SetClockSpeed(kGbcClockSpeed);
         }
         ImGui::EndMenu();
       }
@@ -1336,7 +1687,7 @@ void Interface::RenderMainMenu() {
     }
     if (ImGui::BeginMenu("APU")) {
       if (ImGui::MenuItem("Enable Sound", nullptr, &config_.settings.enable_audio)) {
-        emulator_.ToggleChannel(AudioChannelID::MASTER, config_.settings.enable_audio);
+        emulator_thread_.Lock()->ToggleChannel(AudioChannelID::MASTER, config_.settings.enable_audio);
       }
       if (ImGui::BeginMenu("Volume")) {
         auto volume = GetMasterVolume() * 100;
@@ -1353,16 +1704,16 @@ void Interface::RenderMainMenu() {
       }
       if (ImGui::BeginMenu("Channels")) {
         if (ImGui::MenuItem("CH1 - Square", nullptr, &config_.settings.enable_ch1)) {
-          emulator_.ToggleChannel(AudioChannelID::CH1, config_.settings.enable_ch1);
+          emulator_thread_.Lock()->ToggleChannel(AudioChannelID::CH1, config_.settings.enable_ch1);
         }
         if (ImGui::MenuItem("CH2 - Square", nullptr, &config_.settings.enable_ch2)) {
-          emulator_.ToggleChannel(AudioChannelID::CH2, config_.settings.enable_ch2);
+          emulator_thread_.Lock()->ToggleChannel(AudioChannelID::CH2, config_.settings.enable_ch2);
         }
         if (ImGui::MenuItem("CH3 - Wave", nullptr, &config_.settings.enable_ch3)) {
-          emulator_.ToggleChannel(AudioChannelID::CH3, config_.settings.enable_ch3);
+          emulator_thread_.Lock()->ToggleChannel(AudioChannelID::CH3, config_.settings.enable_ch3);
         }
         if (ImGui::MenuItem("CH4 - Noise", nullptr, &config_.settings.enable_ch4)) {
-          emulator_.ToggleChannel(AudioChannelID::CH4, config_.settings.enable_ch4);
+          emulator_thread_.Lock()->ToggleChannel(AudioChannelID::CH4, config_.settings.enable_ch4);
         }
         ImGui::EndMenu();
       }
@@ -1396,7 +1747,7 @@ void Interface::RenderMainMenu() {
 
     if (ImGui::Button("OK") && value > 0) {
       spdlog::info("Stepping {} cycles", value);
-      emulator_.Step(value);
+      emulator_thread_.Submit(cmd::Step{ .cycles = value });
       ImGui::CloseCurrentPopup();
     }
     ImGui::SameLine();
@@ -1435,6 +1786,47 @@ void Interface::RenderMainMenu() {
         error_messages_.ClearError(kErrorKeyShader);
       }
     }
+#if !defined(__EMSCRIPTEN__)
+    if (ImGui::MenuItem("Threaded Rendering", nullptr, &config_.settings.threaded_rendering)) {
+      emulator_thread_.Lock()->SetThreadedRendering(config_.settings.threaded_rendering);
+    }
+#endif
+    if (ImGui::BeginMenu("Frame Buffer Format")) {
+      const auto format = config_.settings.frame_buffer_format;
+      std::optional<FrameBufferFormat> selected;
+      if (ImGui::MenuItem("Indexed 8-bit", nullptr, format == FrameBufferFormat::kIndexed8)) {
+        selected = FrameBufferFormat::kIndexed8;
+      }
+      if (ImGui::MenuItem("RGB565", nullptr, format == FrameBufferFormat::kRgb565)) {
+        selected = FrameBufferFormat::kRgb565;
+      }
+      if (ImGui::MenuItem("RGBA8888", nullptr, format == FrameBufferFormat::kRgba8888)) {
+        selected = FrameBufferFormat::kRgba8888;
+      }
+      if (selected) {
+        config_.settings.frame_buffer_format = *selected;
+        emulator_thread_.Submit(cmd::SetFrameBufferFormat{*selected});
+      }
+      ImGui::EndMenu();
+    }
+    if (ImGui::BeginMenu("Color Correction")) {
+      const auto profile = config_.settings.color_correction;
+      std::optional<ColorCorrection> selected;
+      if (ImGui::MenuItem("Raw", nullptr, profile == ColorCorrection::kRaw)) {
+        selected = ColorCorrection::kRaw;
+      }
+      if (ImGui::MenuItem("GBC LCD", nullptr, profile == ColorCorrection::kGbcLcd)) {
+        selected = ColorCorrection::kGbcLcd;
+      }
+      if (ImGui::MenuItem("GBA SP", nullptr, profile == ColorCorrection::kGbaSp)) {
+        selected = ColorCorrection::kGbaSp;
+      }
+      if (selected) {
+        config_.settings.color_correction = *selected;
+        emulator_thread_.Submit(cmd::SetColorCorrection{*selected});
+      }
+      ImGui::EndMenu();
+    }
     ImGui::Separator();
     if (ImGui::MenuItem("Reset View")) {
       ResetView();
@@ -1464,7 +1856,7 @@ void Interface::RenderSettingsPopup() {
 
       spdlog::debug("Set DMG boot rom path: {}", dmg_boot_rom_path);
       config_.settings.dmg_boot_rom_path = dmg_boot_rom_path;
-      if (auto result = emulator_.SetBootRomPath(HardwareMode::kDmgMode, config_.settings.dmg_boot_rom_path); !result) {
+      if (auto result = emulator_thread_.Lock()->SetBootRomPath(HardwareMode::kDmgMode, config_.settings.dmg_boot_rom_path); !result) {
         error_messages_.AddError(kErrorKeyDmgBootRom, std::format("Failed to load DMG boot rom: {}", result.error()));
       } else {
         error_messages_.ClearError(kErrorKeyDmgBootRom);
@@ -1472,7 +1864,7 @@ void Interface::RenderSettingsPopup() {
 
       spdlog::debug("Set CGB boot rom path: {}", cgb_boot_rom_path);
       config_.settings.cgb_boot_rom_path = cgb_boot_rom_path;
-      if (auto result = emulator_.SetBootRomPath(HardwareMode::kCgbMode, config_.settings.cgb_boot_rom_path); !result) {
+      if (auto result = emulator_thread_.Lock()->SetBootRomPath(HardwareMode::kCgbMode, config_.settings.cgb_boot_rom_path); !result) {
         error_messages_.AddError(kErrorKeyCgbBootRom, std::format("Failed to load CGB boot rom: {}", result.error()));
       } else {
         error_messages_.ClearError(kErrorKeyCgbBootRom);
@@ -1510,22 +1902,26 @@ void Interface::RenderStatusBar() {
         ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 32);
         ImGui::Text("FrameTime: %0.4fms", frame_time);
       }
+      const auto& snapshot = emulator_thread_.GetSnapshot();
       {
-        size_t cycles = emulator_.GetPrevCycles();
+        size_t cycles = snapshot.prev_cycles;
         ImGui::SameLine();
         ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 32);
         ImGui::Text("Cycles/Update: %3lu", cycles);
       }
       {
         static double last_update = 0.0;
+        static size_t last_frame_count = 0;
         static size_t gb_frames = 0;
         double current_time = GetTime();
         double delta_time = current_time - last_update;
 
         if (delta_time >= 1.0) {
+          // The count restarts when the emulator is reset.
+          const auto frame_count = snapshot.frame_count;
           last_update = current_time;
-          gb_frames = emulator_.GetFrameCount();
-          emulator_.ResetFrameCount();
+          gb_frames = frame_count >= last_frame_count ? frame_count - last_frame_count : frame_count;
+          last_frame_count = frame_count;
         }
 
         ImGui::SameLine();
@@ -1535,12 +1931,27 @@ void Interface::RenderStatusBar() {
       {
         ImGui::SameLine();
         ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 32);
-        ImGui::Text("Cycles: %012lu", emulator_.GetTotalCycles());
+        ImGui::Text("Cycles: %012lu", snapshot.total_cycles);
+      }
+      {
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 32);
+        ImGui::Text("Clock Speed: %lu", snapshot.clock_speed);
+      }
+      {
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 32);
+        ImGui::Text("Speed: x%d", speed_);
       }
       {
         ImGui::SameLine();
         ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 32);
-        ImGui::Text("Clock Speed: %lu", emulator_.GetClockSpeed());
+        ImGui::Text("Frame Skip: %d", snapshot.frame_skip);
+      }
+      if (snapshot.recording) {
+        ImGui::SameLine();
+        ImGui::SetCursorPosX(ImGui::GetCursorPosX() + 32);
+        ImGui::TextColored(ImVec4{0.902f, 0.160f, 0.216f, 1.0f}, "REC (dropped: %lu)", snapshot.dropped_recording_frames);
       }
       ImGui::EndMenuBar();
     }
@@ -1551,6 +1962,7 @@ void Interface::RenderStatusBar() {
 void Interface::Cleanup() {
   spdlog::info("Cleaning up interface");
 
+  emulator_thread_.Cleanup();
   emulator_.Cleanup();
 
   rlImGuiShutdown();
@@ -1569,8 +1981,11 @@ void Interface::SaveSettings() {
   config_.settings.screen_x = static_cast<int>(window_pos.x);
   config_.settings.screen_y = static_cast<int>(window_pos.y);
   config_.settings.master_volume = GetMasterVolume() * 100.0f;
-  config_.settings.dmg_boot_rom_path = emulator_.GetBootRomPath(HardwareMode::kDmgMode);
-  config_.settings.cgb_boot_rom_path = emulator_.GetBootRomPath(HardwareMode::kCgbMode);
+  {
+    auto emulator = emulator_thread_.Lock();
+    config_.settings.dmg_boot_rom_path = emulator->GetBootRomPath(HardwareMode::kDmgMode);
+    config_.settings.cgb_boot_rom_path = emulator->GetBootRomPath(HardwareMode::kCgbMode);
+  }
 
   if (auto res = config_.Save(args_.settings_filename); !res.has_value()) {
     spdlog::warn("Failed to save settings to file: {}", res.error());
@@ -1578,48 +1993,23 @@ void Interface::SaveSettings() {
 }
 
 void Interface::Play() {
-  if (!emulator_.IsCartLoaded()) {
-    return;
-  }
-
-  emulator_.Play();
+  emulator_thread_.Submit(cmd::Play{});
 }
 
 void Interface::Stop() {
-  if (!emulator_.IsCartLoaded()) {
-    return;
-  }
-
-  emulator_.Stop();
+  emulator_thread_.Submit(cmd::Stop{});
 }
 
 void Interface::Step() {
-  if (!emulator_.IsCartLoaded()) {
-    return;
-  }
-
-  emulator_.Step();
+  emulator_thread_.Submit(cmd::Step{});
 }
 
 void Interface::StepFrame() {
-  if (!emulator_.IsCartLoaded()) {
-    return;
-  }
-
-  emulator_.Update(GetFrameTime());
+  emulator_thread_.Submit(cmd::StepFrame{});
 }
 
 void Interface::Reset() {
-  if (!emulator_.IsCartLoaded()) {
-    return;
-  }
-
-  const auto was_playing = emulator_.IsPlaying();
-  emulator_.Stop();
-  emulator_.Reset();
-  if (was_playing) {
-    emulator_.Play();
-  }
+  emulator_thread_.Submit(cmd::Reset{});
 }
 
 void Interface::ResetView() {
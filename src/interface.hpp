@@ -11,6 +11,7 @@
 #include "assembly_viewer.hpp"
 #include "config.hpp"
 #include "emulator.hpp"
+#include "emulator_thread.hpp"
 #include "error_messages.hpp"
 #include "recent_files.hpp"
 
@@ -23,6 +24,13 @@ constexpr float kFrameRate = 59.73;
 
 constexpr size_t kMaxRecentFiles = 10;
 
+constexpr int kMaxFrameSkip = 9;
+constexpr int kDefaultTurboSpeed = 4;
+
+constexpr int kMaxScreenshotScale = 4;
+constexpr int kDefaultScreenshotBurstFrames = 60;
+constexpr int kMaxScreenshotBurstFrames = 600;
+
 struct InterfaceSettings {
   int screen_width;
   int screen_height;
@@ -36,6 +44,17 @@ struct InterfaceSettings {
   bool skip_boot_rom;
   std::string dmg_boot_rom_path;
   std::string cgb_boot_rom_path;
+  int frame_skip;
+  bool auto_frame_skip;
+  int turbo_speed;
+  bool emulation_thread;
+  bool sub_frame_input;
+  bool shm_export;
+  std::string shm_export_name;
+  RecordQueuePolicy record_policy;
+  upscaler::Filter screenshot_filter;
+  int screenshot_scale;
+  int screenshot_burst_frames;
 
   // Hardware
   bool show_lcd;
@@ -62,6 +81,9 @@ struct InterfaceSettings {
 
   bool lock_framerate;
   bool show_scanlines;
+  bool threaded_rendering;
+  FrameBufferFormat frame_buffer_format;
+  ColorCorrection color_correction;
 
   std::array<Color, 4> palette;
 };
@@ -87,6 +109,10 @@ private:
   void Reset();
 
   void Update();
+  void UpdateFrameSkip(const EmulatorSnapshot& snapshot, int speed);
+  void UpdateShmExport();
+  void ToggleRecording();
+  void TakeScreenshot(bool burst);
   void ConfigureDockSpace();
   void RenderError();
   void RenderDebugger();
@@ -110,12 +136,19 @@ private:
 
   Args args_ {};
   Emulator emulator_ {};
+  EmulatorThread emulator_thread_ {};
   AssemblyViewer assembly_viewer_ {};
   Config<InterfaceSettings> config_ {};
   MemoryEditor mem_editor_ {};
   AppLog app_log_ {};
   ErrorMessages error_messages_ {};
 
+  ButtonStates buttons_ {};
+  int auto_frame_skip_ = 0;
+  // frames_run of the snapshot the auto frame skip last looked at.
+  u64 frame_skip_frames_run_ = 0;
+  int speed_ = 1;
+
   bool should_close_ = false;
   bool show_settings_ = false;
   bool init_dock_ = false;
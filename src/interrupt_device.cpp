@@ -17,12 +17,13 @@ void InterruptDevice::Write8(u16 addr, u8 byte) {
   switch (addr) {
     case std::to_underlying(IO::IF):
       flag_.val = byte;
-      return;
+      break;
     case std::to_underlying(IO::IE):
       enable_.val = byte;
-      return;
+      break;
     default: std::unreachable();
   }
+  UpdatePending();
 }
 
 u8 InterruptDevice::Read8(u16 addr) const {
@@ -38,90 +39,95 @@ u8 InterruptDevice::Read8(u16 addr) const {
 void InterruptDevice::Reset() {
   flag_.reset();
   enable_.reset();
+  UpdatePending();
 }
 
 void InterruptDevice::EnableInterrupt(Interrupt interrupt) {
   switch (interrupt) {
     case Interrupt::VBlank:
       enable_.vblank = 1;
-      return;
+      break;
     case Interrupt::Stat:
       enable_.lcd = 1;
-      return;
+      break;
     case Interrupt::Timer:
       enable_.timer = 1;
-      return;
+      break;
     case Interrupt::Serial:
       enable_.serial = 1;
-      return;
+      break;
     case Interrupt::Joypad:
       enable_.joypad = 1;
-      return;
+      break;
     default: std::unreachable();
   }
+  UpdatePending();
 }
 
 void InterruptDevice::DisableInterrupt(Interrupt interrupt) {
   switch (interrupt) {
     case Interrupt::VBlank:
       enable_.vblank = 0;
-      return;
+      break;
     case Interrupt::Stat:
       enable_.lcd = 0;
-      return;
+      break;
     case Interrupt::Timer:
       enable_.timer = 0;
-      return;
+      break;
     case Interrupt::Serial:
       enable_.serial = 0;
-      return;
+      break;
     case Interrupt::Joypad:
       enable_.joypad = 0;
-      return;
+      break;
     default: std::unreachable();
   }
+  UpdatePending();
 }
 
 void InterruptDevice::RequestInterrupt(Interrupt interrupt) {
   switch (interrupt) {
     case Interrupt::VBlank:
       flag_.vblank = 1;
-      return;
+      break;
     case Interrupt::Stat:
       flag_.lcd = 1;
-      return;
+      break;
     case Interrupt::Timer:
       flag_.timer = 1;
-      return;
+      break;
     case Interrupt::Serial:
       flag_.serial = 1;
-      return;
+      break;
     case Interrupt::Joypad:
       flag_.joypad = 1;
-      return;
+      break;
     default: std::unreachable();
   }
+  UpdatePending();
 }
 
 void InterruptDevice::ClearInterrupt(Interrupt interrupt) {
   switch (interrupt) {
     case Interrupt::VBlank:
       flag_.vblank = 0;
-      return;
+      break;
     case Interrupt::Stat:
       flag_.lcd = 0;
-      return;
+      break;
     case Interrupt::Timer:
       flag_.timer = 0;
-      return;
+      break;
     case Interrupt::Serial:
       flag_.serial = 0;
-      return;
+      break;
     case Interrupt::Joypad:
       flag_.joypad = 0;
-      return;
+      break;
     default: std::unreachable();
   }
+  UpdatePending();
 }
 
 bool InterruptDevice::IsInterruptRequested(Interrupt interrupt) const {
@@ -139,3 +145,7 @@ bool InterruptDevice::IsInterruptRequested(Interrupt interrupt) const {
     default: std::unreachable();
   }
 }
+
+void InterruptDevice::UpdatePending() {
+  pending_ = enable_.val & flag_.val & 0x1f;
+}
@@ -36,7 +36,20 @@ public:
 
   [[nodiscard]] bool IsInterruptRequested(Interrupt interrupt) const;
 
+  // Interrupts that are both enabled and requested, one bit per Interrupt.
+  [[nodiscard]] u8 Pending() const {
+    return pending_;
+  }
+
+  [[nodiscard]] bool HasPendingInterrupt() const {
+    return pending_ != 0;
+  }
+
 private:
+  void UpdatePending();
+
   InterruptRegister flag_ {};
   InterruptRegister enable_ {};
+  // IE & IF, kept up to date so the CPU can check it before every instruction.
+  u8 pending_ = 0;
 };
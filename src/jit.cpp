@@ -0,0 +1,390 @@
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <tracy/Tracy.hpp>
+
+#if defined(__x86_64__) && !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+#include "jit.hpp"
+#include "block_cache.hpp"
+#include "overloaded.hpp"
+
+
+namespace {
+  // Room for a few thousand blocks, far more than the ROM of any game
+  // keeps hot.
+  constexpr size_t kCodeSize = 16 << 20;
+
+  static_assert(std::is_standard_layout_v<Registers>, "Compiled code addresses Registers by offset");
+  static_assert(sizeof(Registers) < 128, "Registers must be reachable through 8-bit displacements");
+
+  constexpr u8 kPcOffset = offsetof(Registers, pc);
+  constexpr u8 kSpOffset = offsetof(Registers, sp);
+  constexpr u8 kFlagOpOffset = offsetof(Registers, lazy) + offsetof(LazyFlags, op);
+  constexpr u8 kFlagCarryOffset = offsetof(Registers, lazy) + offsetof(LazyFlags, carry);
+  constexpr u8 kFlagAOffset = offsetof(Registers, lazy) + offsetof(LazyFlags, a);
+  constexpr u8 kFlagBOffset = offsetof(Registers, lazy) + offsetof(LazyFlags, b);
+  constexpr u8 kFlagResultOffset = offsetof(Registers, lazy) + offsetof(LazyFlags, result);
+
+  // Same layout as Registers::Byte.
+  constexpr u8 Offset(Reg8 reg) {
+    return offsetof(Registers, pairs) + (std::to_underlying(reg) >> 1) * sizeof(Registers::Pair) + ((std::to_underlying(reg) & 1) ^ 1);
+  }
+
+  constexpr u8 Offset(Reg16 reg) {
+    return offsetof(Registers, pairs) + (std::to_underlying(reg) >> 1) * sizeof(Registers::Pair);
+  }
+
+  // A, B, C, D, E, H and L. F is only ever written through the lazy flags.
+  constexpr bool IsPlain(Reg8 reg) {
+    return reg != Reg8::F && reg != Reg8::Count;
+  }
+
+  // Registers in the generated code: rbx points at the Registers, r12 at the
+  // Cpu, r13d adds up the cycles and r14d holds max_cycles. All of them are
+  // callee-saved, so they survive the hook calls.
+  class Emitter {
+  public:
+    explicit Emitter(const JitHooks& hooks) : hooks_(hooks) {}
+
+    [[nodiscard]] const std::vector<u8>& Code() const {
+      return code_;
+    }
+
+    void Prologue() {
+      // push rbp, rbx, r12, r13, r14, which also aligns the stack for calls.
+      Emit({0x55, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56});
+      // mov r12, rdi / mov rbx, rsi / mov r14d, edx / xor r13d, r13d
+      Emit({0x49, 0x89, 0xFC, 0x48, 0x89, 0xF3, 0x41, 0x89, 0xD6, 0x45, 0x31, 0xED});
+    }
+
+    void Epilogue() {
+      for (auto at : exits_) {
+        const auto rel = static_cast<u32>(code_.size() - (at + 4));
+        std::memcpy(code_.data() + at, &rel, sizeof(rel));
+      }
+      // mov eax, r13d / pop r14, r13, r12, rbx, rbp / ret
+      Emit({0x44, 0x89, 0xE8, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0x5D, 0xC3});
+    }
+
+    // Leaves the block when the cycles are used up or the CPU has to look at
+    // something other than the next instruction.
+    void CheckNext() {
+      // cmp r13d, r14d / jae exit
+      Emit({0x45, 0x39, 0xF5, 0x0F, 0x83});
+      Exit();
+      CallHook(reinterpret_cast<const void*>(hooks_.next), false);
+      // test al, al / jz exit
+      Emit({0x84, 0xC0, 0x0F, 0x84});
+      Exit();
+    }
+
+    void Fetch(u8 bytes) {
+      // mov esi, bytes
+      Emit({0xBE});
+      Imm32(bytes);
+      CallHook(reinterpret_cast<const void*>(hooks_.fetch), false);
+    }
+
+    void Tick() {
+      CallHook(reinterpret_cast<const void*>(hooks_.tick), false);
+    }
+
+    void Interpret(const Instruction& instr) {
+      // mov rsi, &instr
+      Emit({0x48, 0xBE});
+      Imm64(reinterpret_cast<u64>(&instr));
+      CallHook(reinterpret_cast<const void*>(hooks_.execute), true);
+    }
+
+    void AddCycles(u8 cycles) {
+      // add r13d, cycles
+      Emit({0x41, 0x83, 0xC5, cycles});
+    }
+
+    // Emits instr inline, returns false when it has to be interpreted.
+    bool Native(const Instruction& instr) {
+      switch (instr.opcode) {
+      case Opcode::NOP:
+        return true;
+      case Opcode::LD:
+        return std::visit(overloaded{
+          [&](const Operands_Reg8_Reg8& operands) {
+            if (!IsPlain(operands.reg1) || !IsPlain(operands.reg2)) {
+              return false;
+            }
+            LoadA(operands.reg2);
+            StoreA(operands.reg1);
+            return true;
+          },
+          [&](const Operands_Reg8_Imm8& operands) {
+            if (!IsPlain(operands.reg)) {
+              return false;
+            }
+            // mov byte [rbx + reg], imm
+            Emit({0xC6, 0x43, Offset(operands.reg), operands.imm});
+            return true;
+          },
+          [&](const Operands_Reg16_Imm16& operands) {
+            if (operands.reg == Reg16::AF) {
+              return false;
+            }
+            StoreImm16(Offset(operands.reg), operands.imm);
+            return true;
+          },
+          [&](const Operands_SP_Imm16& operands) {
+            StoreImm16(kSpOffset, operands.imm);
+            return true;
+          },
+          [&](const auto&) { return false; },
+        }, instr.operands);
+      case Opcode::INC:
+      case Opcode::DEC: {
+        u8 offset = 0;
+        if (const auto* operands = std::get_if<Operands_Reg16>(&instr.operands); operands && operands->reg != Reg16::AF) {
+          offset = Offset(operands->reg);
+        } else if (std::holds_alternative<Operands_SP>(instr.operands)) {
+          offset = kSpOffset;
+        } else {
+          return false;
+        }
+        // inc/dec word [rbx + offset]
+        Emit({0x66, 0xFF, static_cast<u8>(instr.opcode == Opcode::INC ? 0x43 : 0x4B), offset});
+        Tick();
+        return true;
+      }
+      case Opcode::ADD:
+      case Opcode::SUB:
+      case Opcode::CP:
+      case Opcode::AND:
+      case Opcode::OR:
+      case Opcode::XOR:
+        return Alu(instr);
+      case Opcode::JP:
+        if (const auto* operands = std::get_if<Operands_Imm16>(&instr.operands)) {
+          StoreImm16(kPcOffset, operands->imm);
+          Tick();
+          return true;
+        }
+        return false;
+      case Opcode::JR:
+        if (const auto* operands = std::get_if<Operands_Offset>(&instr.operands)) {
+          // add word [rbx + pc], offset
+          Emit({0x66, 0x83, 0x43, kPcOffset, static_cast<u8>(operands->offset)});
+          Tick();
+          return true;
+        }
+        return false;
+      default:
+        return false;
+      }
+    }
+
+  private:
+    // A op r or A op imm, with the flags recorded as Registers::SetFlags does.
+    bool Alu(const Instruction& instr) {
+      std::optional<Reg8> reg;
+      std::optional<u8> imm;
+      std::visit(overloaded{
+        [&](const Operands_Reg8& operands) { reg = operands.reg; },
+        [&](const Operands_Imm8& operands) { imm = operands.imm; },
+        [&](const Operands_Reg8_Reg8& operands) {
+          if (operands.reg1 == Reg8::A) {
+            reg = operands.reg2;
+          }
+        },
+        [&](const Operands_Reg8_Imm8& operands) {
+          if (operands.reg == Reg8::A) {
+            imm = operands.imm;
+          }
+        },
+        [&](const auto&) {},
+      }, instr.operands);
+      if ((!reg || !IsPlain(*reg)) && !imm) {
+        return false;
+      }
+
+      LoadA(Reg8::A);
+      FlagOp op = FlagOp::kOr;
+      switch (instr.opcode) {
+      case Opcode::AND:
+      case Opcode::OR:
+      case Opcode::XOR: {
+        // and/or/xor al, [rbx + reg] or al, imm
+        const u8 index = instr.opcode == Opcode::AND ? 0 : instr.opcode == Opcode::OR ? 1 : 2;
+        if (reg) {
+          Emit({std::array<u8, 3>{0x22, 0x0A, 0x32}[index], 0x43, Offset(*reg)});
+        } else {
+          Emit({std::array<u8, 3>{0x24, 0x0C, 0x34}[index], *imm});
+        }
+        op = instr.opcode == Opcode::AND ? FlagOp::kAnd : FlagOp::kOr;
+        // mov word [rbx + a], 0 / mov word [rbx + b], 0
+        StoreImm16(kFlagAOffset, 0);
+        StoreImm16(kFlagBOffset, 0);
+        break;
+      }
+      default: {
+        if (reg) {
+          // movzx ecx, byte [rbx + reg]
+          Emit({0x0F, 0xB6, 0x4B, Offset(*reg)});
+        } else {
+          // mov ecx, imm
+          Emit({0xB9});
+          Imm32(*imm);
+        }
+        // mov word [rbx + a], ax / mov word [rbx + b], cx
+        Emit({0x66, 0x89, 0x43, kFlagAOffset, 0x66, 0x89, 0x4B, kFlagBOffset});
+        // add eax, ecx or sub eax, ecx, both as 32 bits like the interpreter
+        Emit({static_cast<u8>(instr.opcode == Opcode::ADD ? 0x01 : 0x29), 0xC8});
+        op = instr.opcode == Opcode::ADD ? FlagOp::kAdd8 : FlagOp::kSub8;
+        break;
+      }
+      }
+
+      // mov dword [rbx + result], eax
+      Emit({0x89, 0x43, kFlagResultOffset});
+      // mov byte [rbx + op], op / mov byte [rbx + carry], 0
+      Emit({0xC6, 0x43, kFlagOpOffset, std::to_underlying(op), 0xC6, 0x43, kFlagCarryOffset, 0});
+      if (instr.opcode != Opcode::CP) {
+        StoreA(Reg8::A);
+      }
+      return true;
+    }
+
+    // movzx eax, byte [rbx + reg]
+    void LoadA(Reg8 reg) {
+      Emit({0x0F, 0xB6, 0x43, Offset(reg)});
+    }
+
+    // mov byte [rbx + reg], al
+    void StoreA(Reg8 reg) {
+      Emit({0x88, 0x43, Offset(reg)});
+    }
+
+    // mov word [rbx + offset], imm
+    void StoreImm16(u8 offset, u16 imm) {
+      Emit({0x66, 0xC7, 0x43, offset});
+      Emit({static_cast<u8>(imm & 0xff), static_cast<u8>(imm >> 8)});
+    }
+
+    // mov rdi, r12 / mov rax, fn / call rax, adding eax to the cycles if the
+    // hook returns them.
+    void CallHook(const void* fn, bool returns_cycles) {
+      Emit({0x4C, 0x89, 0xE7, 0x48, 0xB8});
+      Imm64(reinterpret_cast<u64>(fn));
+      Emit({0xFF, 0xD0});
+      if (returns_cycles) {
+        // add r13d, eax
+        Emit({0x41, 0x01, 0xC5});
+      }
+    }
+
+    // The rel32 of a jump to the epilogue, patched once it is placed.
+    void Exit() {
+      exits_.push_back(code_.size());
+      Imm32(0);
+    }
+
+    void Emit(std::initializer_list<u8> bytes) {
+      code_.insert(code_.end(), bytes);
+    }
+
+    void Imm32(u32 value) {
+      for (int i = 0; i < 4; i += 1) {
+        code_.push_back(static_cast<u8>(value >> (i * 8)));
+      }
+    }
+
+    void Imm64(u64 value) {
+      for (int i = 0; i < 8; i += 1) {
+        code_.push_back(static_cast<u8>(value >> (i * 8)));
+      }
+    }
+
+    const JitHooks& hooks_;
+    std::vector<u8> code_ {};
+    std::vector<size_t> exits_ {};
+  };
+}
+
+Jit::~Jit() {
+#if defined(JIT_SUPPORTED)
+  if (code_) {
+    munmap(code_, kCodeSize);
+  }
+#endif
+}
+
+bool Jit::IsSupported() {
+#if defined(JIT_SUPPORTED)
+  return true;
+#else
+  return false;
+#endif
+}
+
+JitFunction Jit::Compile(const CodeBlock& block, const JitHooks& hooks) {
+  ZoneScoped;
+
+#if defined(JIT_SUPPORTED)
+  if (!code_) {
+    void* code = mmap(nullptr, kCodeSize, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+      spdlog::error("Failed to map {} bytes for compiled code", kCodeSize);
+      return nullptr;
+    }
+    code_ = static_cast<u8*>(code);
+  }
+
+  Emitter emitter(hooks);
+  emitter.Prologue();
+  for (size_t i = 0; i < block.instructions.size(); i += 1) {
+    const auto& instr = block.instructions[i];
+    // RunCompiled checked the first one.
+    if (i > 0) {
+      emitter.CheckNext();
+    }
+    emitter.Fetch(instr.bytes);
+    if (emitter.Native(instr)) {
+      emitter.AddCycles(instr.cycles);
+    } else {
+      emitter.Interpret(instr);
+    }
+  }
+  emitter.Epilogue();
+
+  const auto& code = emitter.Code();
+  if (used_ + code.size() > kCodeSize) {
+    return nullptr;
+  }
+
+  // Code is never writable and executable at the same time.
+  u8* start = code_ + used_;
+  if (mprotect(code_, kCodeSize, PROT_READ | PROT_WRITE) != 0) {
+    return nullptr;
+  }
+  std::memcpy(start, code.data(), code.size());
+  mprotect(code_, kCodeSize, PROT_READ | PROT_EXEC);
+  // Blocks start 16-byte aligned.
+  used_ += (code.size() + 15) & ~size_t{15};
+  return reinterpret_cast<JitFunction>(start);
+#else
+  (void)block;
+  (void)hooks;
+  return nullptr;
+#endif
+}
+
+void Jit::Clear() {
+  used_ = 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "types.hpp"
+#include "instructions.hpp"
+#include "registers.hpp"
+
+class Cpu;
+struct CodeBlock;
+
+// Native code for one block. Runs the block's instructions from the first
+// one while they fit in max_cycles and the CPU lets it go on (see
+// JitHooks::next), and returns the cycles they took.
+using JitFunction = u32 (*)(Cpu* cpu, Registers* regs, u32 max_cycles);
+
+// Calls from compiled code back into the CPU.
+struct JitHooks {
+  // Spends the cycles fetching an instruction of that many bytes takes and
+  // moves PC past it.
+  void (*fetch)(Cpu* cpu, u32 bytes);
+  // Runs one instruction through the interpreter, returns its cycles.
+  u32 (*execute)(Cpu* cpu, const Instruction* instr);
+  // Spends one internal M-cycle.
+  void (*tick)(Cpu* cpu);
+  // Whether the next instruction of the block may run.
+  bool (*next)(Cpu* cpu);
+};
+
+// Translates CodeBlocks into x86-64 code. Register loads, 16-bit increments,
+// ALU operations on A and plain jumps are emitted inline against Registers,
+// everything that touches memory or needs the current flags goes through
+// JitHooks::execute. Cycles are added up in a register and returned when the
+// block is left.
+class Jit {
+public:
+  Jit() = default;
+  ~Jit();
+
+  Jit(const Jit&) = delete;
+  Jit& operator=(const Jit&) = delete;
+
+  // False off x86-64, on Windows and under emscripten, Compile then always
+  // fails.
+  [[nodiscard]] static bool IsSupported();
+
+  // Returns nullptr when the code buffer is full, Clear makes room again.
+  [[nodiscard]] JitFunction Compile(const CodeBlock& block, const JitHooks& hooks);
+  // Frees every compiled block at once.
+  void Clear();
+
+private:
+  u8* code_ = nullptr;
+  size_t used_ = 0;
+};
@@ -0,0 +1,126 @@
+#include <utility>
+
+#include "loop_idioms.hpp"
+#include "io.hpp"
+
+
+namespace {
+  constexpr LoopStep kLdhAImm8Ptr {0xF0};
+  constexpr LoopStep kLdAImm16Ptr {0xFA};
+  constexpr LoopStep kLdAHlInc {0x2A};
+  constexpr LoopStep kLdADe {0x1A};
+  constexpr LoopStep kLdAB {0x78};
+  constexpr LoopStep kLdAC {0x79};
+  constexpr LoopStep kLdDeA {0x12};
+  constexpr LoopStep kLdHlIncA {0x22};
+  constexpr LoopStep kLdHlDecA {0x32};
+  constexpr LoopStep kIncDe {0x13};
+  constexpr LoopStep kDecBc {0x0B};
+  // DEC B or DEC C.
+  constexpr LoopStep kDecBOrC {0x05, 0xFFF7};
+  constexpr LoopStep kAndA {0xA7};
+  constexpr LoopStep kOrA {0xB7};
+  constexpr LoopStep kOrB {0xB0};
+  constexpr LoopStep kOrC {0xB1};
+  constexpr LoopStep kXorA {0xAF};
+  constexpr LoopStep kAndImm8 {0xE6};
+  constexpr LoopStep kCpImm8 {0xFE};
+  constexpr LoopStep kBitA {0xCB47, 0xFFC7};
+  constexpr LoopStep kJrCond {0x20, 0xFFE7};
+  constexpr u8 kJrNz = 0x20;
+
+  constexpr LoopTransfer kHlToDe {LoopOperand::kHl, LoopOperand::kDe};
+  constexpr LoopTransfer kDeToHl {LoopOperand::kDe, LoopOperand::kHl};
+
+  constexpr u16 kWramStart = 0xC000;
+  constexpr u16 kWramEnd = 0xDFFF;
+  constexpr u16 kHramStart = 0xFF80;
+  constexpr u16 kHramEnd = 0xFFFE;
+
+  // Whether a loop waiting on addr can be skipped ahead to the next device
+  // event. Only the PPU and interrupt requests change these behind the CPU's
+  // back, the serial port, APU, joypad and cartridge RAM can change at any
+  // time and are always polled for real.
+  bool IsIdlePollAddress(u16 addr) {
+    return addr == std::to_underlying(IO::LY) || addr == std::to_underlying(IO::STAT) ||
+      addr == std::to_underlying(IO::IF) || (addr >= kWramStart && addr <= kWramEnd) ||
+      (addr >= kHramStart && addr <= kHramEnd);
+  }
+
+  // The address the LDH A,(n) or LD A,(nn) starting a polling loop reads.
+  u16 PolledAddress(const CodeBlock& block) {
+    if (block.code[0] == 0xF0) {
+      return 0xFF00 | block.code[1];
+    }
+    return block.code[1] | (block.code[2] << 8);
+  }
+
+  const std::vector<LoopPattern> kPatterns {
+    {"ldh a,(n) / cp n / jr cc", LoopIdiom::kPolling, {kLdhAImm8Ptr, kCpImm8, kJrCond}},
+    {"ldh a,(n) / and n / jr cc", LoopIdiom::kPolling, {kLdhAImm8Ptr, kAndImm8, kJrCond}},
+    {"ldh a,(n) / and n / cp n / jr cc", LoopIdiom::kPolling, {kLdhAImm8Ptr, kAndImm8, kCpImm8, kJrCond}},
+    {"ldh a,(n) / and a / jr cc", LoopIdiom::kPolling, {kLdhAImm8Ptr, kAndA, kJrCond}},
+    {"ldh a,(n) / bit b,a / jr cc", LoopIdiom::kPolling, {kLdhAImm8Ptr, kBitA, kJrCond}},
+    {"ld a,(nn) / cp n / jr cc", LoopIdiom::kPolling, {kLdAImm16Ptr, kCpImm8, kJrCond}},
+    {"ld a,(nn) / and a / jr cc", LoopIdiom::kPolling, {kLdAImm16Ptr, kAndA, kJrCond}},
+    {"ld a,(nn) / or a / jr cc", LoopIdiom::kPolling, {kLdAImm16Ptr, kOrA, kJrCond}},
+    {"ld a,(hl+) / ld (de),a / inc de / dec bc / ld a,b / or c / jr cc", LoopIdiom::kCopy,
+      {kLdAHlInc, kLdDeA, kIncDe, kDecBc, kLdAB, kOrC, kJrCond}, kHlToDe},
+    {"ld a,(hl+) / ld (de),a / inc de / dec bc / ld a,c / or b / jr cc", LoopIdiom::kCopy,
+      {kLdAHlInc, kLdDeA, kIncDe, kDecBc, kLdAC, kOrB, kJrCond}, kHlToDe},
+    {"ld a,(de) / ld (hl+),a / inc de / dec bc / ld a,b / or c / jr cc", LoopIdiom::kCopy,
+      {kLdADe, kLdHlIncA, kIncDe, kDecBc, kLdAB, kOrC, kJrCond}, kDeToHl},
+    {"ld a,(de) / ld (hl+),a / inc de / dec bc / ld a,c / or b / jr cc", LoopIdiom::kCopy,
+      {kLdADe, kLdHlIncA, kIncDe, kDecBc, kLdAC, kOrB, kJrCond}, kDeToHl},
+    {"ld a,(hl+) / ld (de),a / inc de / dec r / jr cc", LoopIdiom::kCopy,
+      {kLdAHlInc, kLdDeA, kIncDe, kDecBOrC, kJrCond}, kHlToDe},
+    {"ld a,(de) / ld (hl+),a / inc de / dec r / jr cc", LoopIdiom::kCopy,
+      {kLdADe, kLdHlIncA, kIncDe, kDecBOrC, kJrCond}, kDeToHl},
+    {"ld a,(de) / inc de / ld (hl+),a / dec r / jr cc", LoopIdiom::kCopy,
+      {kLdADe, kIncDe, kLdHlIncA, kDecBOrC, kJrCond}, kDeToHl},
+    {"ld (hl+),a / dec r / jr cc", LoopIdiom::kFill, {kLdHlIncA, kDecBOrC, kJrCond},
+      {LoopOperand::kA, LoopOperand::kHl}},
+    {"ld (hl-),a / dec r / jr cc", LoopIdiom::kFill, {kLdHlDecA, kDecBOrC, kJrCond},
+      {LoopOperand::kA, LoopOperand::kHl, -1}},
+    {"xor a / ld (hl+),a / dec bc / ld a,b / or c / jr cc", LoopIdiom::kFill,
+      {kXorA, kLdHlIncA, kDecBc, kLdAB, kOrC, kJrCond}, {LoopOperand::kZero, LoopOperand::kHl}},
+  };
+}
+
+const std::vector<LoopPattern>& loop_idioms::GetPatterns() {
+  return kPatterns;
+}
+
+const LoopPattern* loop_idioms::Match(const CodeBlock& block) {
+  for (const auto& pattern : kPatterns) {
+    if (pattern.steps.size() > block.instructions.size()) {
+      continue;
+    }
+
+    size_t offset = 0;
+    bool matches = true;
+    for (size_t i = 0; i < pattern.steps.size() && matches; i += 1) {
+      u16 opcode = block.code[offset];
+      if (opcode == 0xCB) {
+        opcode = (opcode << 8) | block.code[offset + 1];
+      }
+      matches = (opcode & pattern.steps[i].mask) == pattern.steps[i].opcode;
+      offset += block.instructions[i].bytes;
+    }
+
+    // The offset of the JR is its last byte, it has to land on the first
+    // instruction again.
+    if (!matches || static_cast<u16>(block.pc + offset + static_cast<i8>(block.code[offset - 1])) != block.pc) {
+      continue;
+    }
+    if (pattern.idiom == LoopIdiom::kPolling && !IsIdlePollAddress(PolledAddress(block))) {
+      continue;
+    }
+    // Copies and fills run until their counter reaches zero.
+    if (pattern.idiom != LoopIdiom::kPolling && block.code[offset - 2] != kJrNz) {
+      continue;
+    }
+    return &pattern;
+  }
+  return nullptr;
+}
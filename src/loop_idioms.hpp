@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "types.hpp"
+#include "block_cache.hpp"
+
+
+enum class LoopIdiom {
+  kPolling,
+  kCopy,
+  kFill,
+};
+
+// Where a copy or fill loop takes its bytes from and puts them.
+enum class LoopOperand : u8 {
+  kNone,
+  kA,
+  kZero,
+  kDe,
+  kHl,
+};
+
+// The data movement of one iteration of a copy or fill loop: a byte from src
+// (a pointer that moves forward, A or zero) stored at dst, which moves by
+// dst_step. The DEC in the loop counts the iterations.
+struct LoopTransfer {
+  LoopOperand src = LoopOperand::kNone;
+  LoopOperand dst = LoopOperand::kNone;
+  i8 dst_step = 1;
+};
+
+// One instruction of a loop, matched on its opcode. Prefixed instructions
+// are 0xCBxx, the mask lets one step cover a register or condition field.
+struct LoopStep {
+  u16 opcode;
+  u16 mask = 0xFFFF;
+};
+
+// A tight loop that only moves or tests data and ends in a conditional JR
+// back to its first instruction, a JR NZ for copies and fills. The CPU runs these without going through
+// Execute for every instruction, see Cpu::FastForward.
+struct LoopPattern {
+  std::string_view name;
+  LoopIdiom idiom;
+  std::vector<LoopStep> steps;
+  LoopTransfer transfer {};
+};
+
+namespace loop_idioms {
+  const std::vector<LoopPattern>& GetPatterns();
+  // The pattern the instructions at the start of the block form, if any.
+  const LoopPattern* Match(const CodeBlock& block);
+}
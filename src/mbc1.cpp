@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 #include <spdlog/spdlog.h>
 
@@ -24,41 +25,95 @@ Mbc1::Mbc1(const std::vector<u8>& bytes, CartInfo info, bool has_ram, bool has_b
 }
 
 u8 Mbc1::ReadRom0(u16 addr) const {
+  return Rom0Bank()[addr];
+}
+
+u8 Mbc1::ReadRom1(u16 addr) const {
+  return Rom1Bank()[addr & 0x3fff];
+}
+
+u16 Mbc1::GetRomBank(u16 addr) const {
+  return static_cast<u16>(addr <= kRomBank00End ? Rom0BankIndex() : Rom1BankIndex());
+}
+
+u8 Mbc1::ReadRam(u16 addr) const {
+  if (!ram_enable_ | !info_.ram_size_bytes) {
+    return 0xff;
+  }
+
+  return RamBank()[addr & 0x1fff];
+}
+
+void Mbc1::ReadRom0Span(u16 addr, std::span<u8> dst) const {
+  std::copy_n(Rom0Bank().begin() + addr, dst.size(), dst.begin());
+}
+
+void Mbc1::ReadRom1Span(u16 addr, std::span<u8> dst) const {
+  std::copy_n(Rom1Bank().begin() + (addr & 0x3fff), dst.size(), dst.begin());
+}
+
+void Mbc1::ReadRamSpan(u16 addr, std::span<u8> dst) const {
+  if (!ram_enable_ | !info_.ram_size_bytes) {
+    std::fill(dst.begin(), dst.end(), 0xff);
+    return;
+  }
+
+  std::copy_n(RamBank().begin() + (addr & 0x1fff), dst.size(), dst.begin());
+}
+
+void Mbc1::WriteRamSpan(u16 addr, std::span<const u8> src) {
+  if (!ram_enable_ || !info_.ram_num_banks) {
+    return;
+  }
+
+  std::copy(src.begin(), src.end(), RamBank().begin() + (addr & 0x1fff));
+}
+
+size_t Mbc1::Rom0BankIndex() const {
   if (mbc1m_ && banking_mode_) {
-      return rom_[(ram_bank_number << 4) % info_.rom_num_banks][addr];
+      return (ram_bank_number << 4) % info_.rom_num_banks;
   }
 
   if (!banking_mode_ || info_.rom_num_banks <= 32) {
-    return rom_[0][addr];
+    return 0;
   }
 
-  return rom_[(ram_bank_number << 5) % info_.rom_num_banks][addr];
+  return (ram_bank_number << 5) % info_.rom_num_banks;
 }
 
-u8 Mbc1::ReadRom1(u16 addr) const {
+size_t Mbc1::Rom1BankIndex() const {
   u16 bank = rom_bank_number & 0b11111;
   if (bank == 0) {
     bank = 1;
   }
 
   if (mbc1m_) {
-    return rom_[((bank & 0b1111) | (ram_bank_number << 4))][addr & 0x3fff];
+    return (bank & 0b1111) | (ram_bank_number << 4);
   }
 
   if (info_.rom_num_banks > 32) {
-    return rom_[(bank | (ram_bank_number << 5)) % info_.rom_num_banks][addr & 0x3fff];
+    return (bank | (ram_bank_number << 5)) % info_.rom_num_banks;
   }
 
-  return rom_[bank % info_.rom_num_banks][addr & 0x3fff];
+  return bank % info_.rom_num_banks;
 }
 
-u8 Mbc1::ReadRam(u16 addr) const {
-  if (!ram_enable_ | !info_.ram_size_bytes) {
-    return 0xff;
-  }
+const Mbc1::rom_bank& Mbc1::Rom0Bank() const {
+  return rom_[Rom0BankIndex()];
+}
+
+const Mbc1::rom_bank& Mbc1::Rom1Bank() const {
+  return rom_[Rom1BankIndex()];
+}
 
+const Mbc1::ram_bank& Mbc1::RamBank() const {
   auto bank_idx = !banking_mode_ ? 0 : ram_bank_number % info_.ram_num_banks;
-  return ram_[bank_idx][addr & 0x1fff];
+  return ram_[bank_idx];
+}
+
+Mbc1::ram_bank& Mbc1::RamBank() {
+  auto bank_idx = !banking_mode_ ? 0 : ram_bank_number % info_.ram_num_banks;
+  return ram_[bank_idx];
 }
 
 void Mbc1::WriteReg(u16 addr, u8 byte) {
@@ -85,7 +140,6 @@ void Mbc1::WriteRam(u16 addr, u8 byte) {
     return;
   }
 
-  auto bank_idx = !banking_mode_ ? 0 : ram_bank_number % info_.ram_num_banks;
-  ram_[bank_idx][addr & 0x1fff] = byte;
+  RamBank()[addr & 0x1fff] = byte;
 }
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 #include <spdlog/spdlog.h>
 
@@ -23,6 +24,10 @@ u8 Mbc2::ReadRom1(u16 addr) const {
   return rom_[rom_bank_number_ % info_.rom_num_banks][addr & 0x3fff];
 }
 
+u16 Mbc2::GetRomBank(u16 addr) const {
+  return addr <= kRomBank00End ? 0 : rom_bank_number_ % info_.rom_num_banks;
+}
+
 u8 Mbc2::ReadRam(u16 addr) const {
   if (!ram_enable_) {
     return 0xff;
@@ -30,6 +35,15 @@ u8 Mbc2::ReadRam(u16 addr) const {
   return ram_[addr & 0x1ff] | 0b11110000;
 }
 
+void Mbc2::ReadRom0Span(u16 addr, std::span<u8> dst) const {
+  std::copy_n(rom_[0].begin() + addr, dst.size(), dst.begin());
+}
+
+void Mbc2::ReadRom1Span(u16 addr, std::span<u8> dst) const {
+  const auto& bank = rom_[rom_bank_number_ % info_.rom_num_banks];
+  std::copy_n(bank.begin() + (addr & 0x3fff), dst.size(), dst.begin());
+}
+
 void Mbc2::WriteReg(u16 addr, u8 byte) {
   if (addr > 0x3fff) {
     return;
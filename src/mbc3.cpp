@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 #include <spdlog/spdlog.h>
 
@@ -23,10 +24,23 @@ u8 Mbc3::ReadRom1(u16 addr) const {
   return rom_[rom_bank_number_ % info_.rom_num_banks][addr & 0x3fff];
 }
 
+u16 Mbc3::GetRomBank(u16 addr) const {
+  return addr <= kRomBank00End ? 0 : rom_bank_number_ % info_.rom_num_banks;
+}
+
 u8 Mbc3::ReadRam(u16 addr) const {
   return ram_or_clock_[(addr - 0xa000) % ram_or_clock_mod_];
 }
 
+void Mbc3::ReadRom0Span(u16 addr, std::span<u8> dst) const {
+  std::copy_n(rom_[0].begin() + addr, dst.size(), dst.begin());
+}
+
+void Mbc3::ReadRom1Span(u16 addr, std::span<u8> dst) const {
+  const auto& bank = rom_[rom_bank_number_ % info_.rom_num_banks];
+  std::copy_n(bank.begin() + (addr & 0x3fff), dst.size(), dst.begin());
+}
+
 void Mbc3::WriteReg(u16 addr, u8 byte) {
   if (addr <= 0x1fff) {
     ram_enable_ = (byte & 0b1111) == 0x0a;
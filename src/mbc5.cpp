@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 #include <spdlog/spdlog.h>
 
@@ -26,6 +27,10 @@ u8 Mbc5::ReadRom1(u16 addr) const {
   return rom_[rom_bank_number_ % info_.rom_num_banks][addr & 0x3fff];
 }
 
+u16 Mbc5::GetRomBank(u16 addr) const {
+  return addr <= kRomBank00End ? 0 : rom_bank_number_ % info_.rom_num_banks;
+}
+
 u8 Mbc5::ReadRam(u16 addr) const {
   if (!ram_enable_) {
     return 0xff;
@@ -33,6 +38,32 @@ u8 Mbc5::ReadRam(u16 addr) const {
   return ram_[ram_bank_number_ % info_.ram_num_banks][addr & 0x1fff];
 }
 
+void Mbc5::ReadRom0Span(u16 addr, std::span<u8> dst) const {
+  std::copy_n(rom_[0].begin() + addr, dst.size(), dst.begin());
+}
+
+void Mbc5::ReadRom1Span(u16 addr, std::span<u8> dst) const {
+  const auto& bank = rom_[rom_bank_number_ % info_.rom_num_banks];
+  std::copy_n(bank.begin() + (addr & 0x3fff), dst.size(), dst.begin());
+}
+
+void Mbc5::ReadRamSpan(u16 addr, std::span<u8> dst) const {
+  if (!ram_enable_) {
+    std::fill(dst.begin(), dst.end(), 0xff);
+    return;
+  }
+  const auto& bank = ram_[ram_bank_number_ % info_.ram_num_banks];
+  std::copy_n(bank.begin() + (addr & 0x1fff), dst.size(), dst.begin());
+}
+
+void Mbc5::WriteRamSpan(u16 addr, std::span<const u8> src) {
+  if (!ram_enable_) {
+    return;
+  }
+  auto& bank = ram_[ram_bank_number_ % info_.ram_num_banks];
+  std::copy(src.begin(), src.end(), bank.begin() + (addr & 0x1fff));
+}
+
 void Mbc5::WriteReg(u16 addr, u8 byte) {
   if (addr <= 0x1fff) {
     ram_enable_ = (byte & 0b1111) == 0x0a;
@@ -13,10 +13,16 @@ public:
   [[nodiscard]] u8 ReadRom0(u16 addr) const override;
   [[nodiscard]] u8 ReadRom1(u16 addr) const override;
   [[nodiscard]] u8 ReadRam(u16 addr) const override;
+  [[nodiscard]] u16 GetRomBank(u16 addr) const override;
 
   void WriteReg(u16 addr, u8 byte) override;
   void WriteRam(u16 addr, u8 byte) override;
 
+  void ReadRom0Span(u16 addr, std::span<u8> dst) const override;
+  void ReadRom1Span(u16 addr, std::span<u8> dst) const override;
+  void ReadRamSpan(u16 addr, std::span<u8> dst) const override;
+  void WriteRamSpan(u16 addr, std::span<const u8> src) override;
+
 private:
   using rom_bank = std::array<u8, 16384>;
   using ram_bank = std::array<u8, 8192>;
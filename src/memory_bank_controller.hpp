@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include "types.hpp"
 
 
@@ -18,6 +20,33 @@ public:
   [[nodiscard]] virtual u8 ReadRom1(u16 addr) const = 0;
   [[nodiscard]] virtual u8 ReadRam(u16 addr) const = 0;
 
+  // The ROM bank currently mapped at addr (0x0000-0x7FFF).
+  [[nodiscard]] virtual u16 GetRomBank(u16 addr) const = 0;
+
   virtual void WriteReg(u16 addr, u8 byte) = 0;
   virtual void WriteRam(u16 addr, u8 byte) = 0;
+
+  virtual void ReadRom0Span(u16 addr, std::span<u8> dst) const {
+    for (auto& byte : dst) {
+      byte = ReadRom0(addr++);
+    }
+  }
+
+  virtual void ReadRom1Span(u16 addr, std::span<u8> dst) const {
+    for (auto& byte : dst) {
+      byte = ReadRom1(addr++);
+    }
+  }
+
+  virtual void ReadRamSpan(u16 addr, std::span<u8> dst) const {
+    for (auto& byte : dst) {
+      byte = ReadRam(addr++);
+    }
+  }
+
+  virtual void WriteRamSpan(u16 addr, std::span<const u8> src) {
+    for (auto byte : src) {
+      WriteRam(addr++, byte);
+    }
+  }
 };
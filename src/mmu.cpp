@@ -3,6 +3,12 @@
 
 #include "mmu.hpp"
 
+namespace {
+  // Overlapping devices (the boot rom) leave holes of at least a page, so a
+  // span no larger than that is owned by one device if both ends are.
+  constexpr size_t kMaxSpanSize = 0x100;
+}
+
 void Mmu::Init() {
   // Do nothing, just for consistency
 }
@@ -42,6 +48,57 @@ u8 Mmu::Read8(u16 addr) const {
   std::unreachable();
 }
 
+void Mmu::ReadSpan(u16 addr, std::span<u8> dst) const {
+  ZoneScoped;
+  if (auto* device = DeviceForRange(addr, dst.size())) {
+    return device->ReadSpan(addr, dst);
+  }
+  for (auto& byte : dst) {
+    byte = Read8(addr++);
+  }
+}
+
+void Mmu::WriteSpan(u16 addr, std::span<const u8> src) {
+  ZoneScoped;
+  if (auto* device = DeviceForRange(addr, src.size())) {
+    return device->WriteSpan(addr, src);
+  }
+  for (auto byte : src) {
+    Write8(addr++, byte);
+  }
+}
+
+u32 Mmu::GetBankKey(u16 addr) const {
+  for (size_t i = 0; i < devices_.size(); i += 1) {
+    if (devices_[i]->IsValidFor(addr)) {
+      return static_cast<u32>(i << 16) | devices_[i]->GetBank(addr);
+    }
+  }
+  std::unreachable();
+}
+
+MmuDevicePtr Mmu::DeviceForRange(u16 addr, size_t size) const {
+  if (size == 0 || size > kMaxSpanSize || addr + size - 1 > 0xFFFF) {
+    return nullptr;
+  }
+
+  auto device_for = [this](u16 a) -> MmuDevicePtr {
+    for (const auto& device : devices_) {
+      if (device->IsValidFor(a)) {
+        return device;
+      }
+    }
+    return nullptr;
+  };
+
+  const u16 last = addr + size - 1;
+  auto* device = device_for(addr);
+  if (!device || device != device_for(last) || !device->IsValidForRange(addr, last)) {
+    return nullptr;
+  }
+  return device;
+}
+
 void Mmu::ResetDevices() {
   for (auto& device : devices_) {
     device->Reset();
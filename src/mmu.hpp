@@ -1,5 +1,6 @@
 #pragma once
 
+#include <span>
 #include <vector>
 
 #include "mmu_device.hpp"
@@ -14,11 +15,17 @@ public:
 
   [[nodiscard]] u8 Read8(u16 addr) const;
   void Write8(u16 addr, u8 byte);
+  void ReadSpan(u16 addr, std::span<u8> dst) const;
+  void WriteSpan(u16 addr, std::span<const u8> src);
+  // Unique for every device and bank that can be mapped at addr.
+  [[nodiscard]] u32 GetBankKey(u16 addr) const;
 
   void ResetDevices();
 
 
 private:
+  [[nodiscard]] MmuDevicePtr DeviceForRange(u16 addr, size_t size) const;
+
   std::vector<MmuDevicePtr> devices_;
 };
 
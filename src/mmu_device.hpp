@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include "types.hpp"
 #include "hardware_mode.hpp"
 
@@ -16,6 +18,27 @@ public:
   [[nodiscard]] virtual u8 Read8(u16 addr) const = 0;
   virtual void Reset() = 0;
 
+  [[nodiscard]] virtual bool IsValidForRange(u16 first, u16 last) const {
+    return false;
+  }
+
+  virtual void ReadSpan(u16 addr, std::span<u8> dst) const {
+    for (auto& byte : dst) {
+      byte = Read8(addr++);
+    }
+  }
+
+  virtual void WriteSpan(u16 addr, std::span<const u8> src) {
+    for (auto byte : src) {
+      Write8(addr++, byte);
+    }
+  }
+
+  // Identifies the bank mapped at addr, for caches keyed by address.
+  [[nodiscard]] virtual u16 GetBank(u16 addr) const {
+    return 0;
+  }
+
   void SetHardwareMode(HardwareMode mode) {
     hardware_mode_ = mode;
   }
@@ -13,10 +13,30 @@ u8 NoMbc::ReadRom1(u16 addr) const {
   return rom_[addr];
 }
 
+u16 NoMbc::GetRomBank(u16 addr) const {
+  return 0;
+}
+
 u8 NoMbc::ReadRam(u16 addr) const {
   return ram_[addr & 0x1fff];
 }
 
+void NoMbc::ReadRom0Span(u16 addr, std::span<u8> dst) const {
+  std::copy_n(rom_.begin() + addr, dst.size(), dst.begin());
+}
+
+void NoMbc::ReadRom1Span(u16 addr, std::span<u8> dst) const {
+  std::copy_n(rom_.begin() + addr, dst.size(), dst.begin());
+}
+
+void NoMbc::ReadRamSpan(u16 addr, std::span<u8> dst) const {
+  std::copy_n(ram_.begin() + (addr & 0x1fff), dst.size(), dst.begin());
+}
+
+void NoMbc::WriteRamSpan(u16 addr, std::span<const u8> src) {
+  std::copy(src.begin(), src.end(), ram_.begin() + (addr & 0x1fff));
+}
+
 void NoMbc::WriteReg(u16 addr, u8 byte) {
 }
 
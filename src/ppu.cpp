@@ -1,15 +1,17 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <span>
 #include <utility>
 #include <spdlog/spdlog.h>
 #include <tracy/Tracy.hpp>
 
 #include "io.hpp"
 #include "ppu.hpp"
+#include "ppu_render_thread.hpp"
 
 
 namespace {
-  constexpr u16 kLCDWidth = 160;
-  constexpr u16 kLCDHeight = 144;
-
   constexpr u16 kVRAMAddrStart = 0x8000;
   constexpr u16 kVRAMAddrEnd = 0x9FFF;
   constexpr u16 kVRAMRelStart = 0x9000;
@@ -21,9 +23,18 @@ namespace {
   constexpr u16 kExtRamBusEnd = 0xDFFF;
   constexpr u16 kExtRamBusMask = kExtRamBusEnd - kExtRamBusStart;
 
-  constexpr size_t kDotsPerOAM = 80;
-  constexpr size_t kDotsPerDraw = 172;
-  constexpr size_t kDotsPerRow = 456;
+  constexpr u16 kVramIndexMask = 0x1FFF;
+  constexpr u16 kHdmaBlockSize = 0x10;
+
+  constexpr u16 kDotsPerOAM = 80;
+  constexpr u16 kDotsPerDraw = 172;
+  constexpr u16 kDotsPerRow = 456;
+
+  constexpr size_t kMaxSpritesPerLine = 10;
+  constexpr int kMaxSpriteHeight = 16;
+
+  constexpr u16 kTileDataSize = kNumTiles * 16;
+  constexpr size_t kTilesPerRow = 16;
 }
 
 inline u8 GetPaletteIndex(u8 id, u8 palette) {
@@ -42,18 +53,101 @@ inline u16 AddrWithMode(u8 mode, u8 addr) {
   return mode ? AddrMode8000(addr) : AddrMode8800(addr);
 }
 
+inline u16 ToRgb565(Color color) {
+  return static_cast<u16>(((color.r >> 3) << 11) | ((color.g >> 2) << 5) | (color.b >> 3));
+}
+
+template <typename Pixel, typename Convert>
+inline void ExpandFrame(const IndexedFrame& frame, const Palette& dmg_palette, Pixel* out, Convert convert) {
+  std::array<Pixel, 256> lut;
+  lut.fill(convert(BLANK));
+
+  const bool is_dmg = frame.hardware_mode == HardwareMode::kDmgMode;
+  if (is_dmg) {
+    for (size_t i = 0; i < dmg_palette.size(); i += 1) {
+      lut[i] = convert(dmg_palette[i]);
+    }
+  }
+
+  size_t lut_palette = SIZE_MAX;
+  for (size_t y = 0; y < kLCDHeight; y += 1) {
+    if (!is_dmg && !frame.palettes.empty()) {
+      const size_t idx = std::min<size_t>(frame.line_palettes[y], frame.palettes.size() - 1);
+      if (idx != lut_palette) {
+        const auto& palette = frame.palettes[idx];
+        for (size_t i = 0; i < palette.size(); i += 1) {
+          lut[i] = convert(palette[i]);
+        }
+        lut_palette = idx;
+      }
+    }
+
+    const auto* row = frame.pixels.data() + y * kLCDWidth;
+    for (size_t x = 0; x < kLCDWidth; x += 1) {
+      *out++ = lut[row[x]];
+    }
+  }
+}
+
+inline void DrawTile(const std::array<u16, 8>& tile, int x, int y, const Palette& palette) {
+  for (int row = 0; row < tile.size(); row += 1) {
+    u16 hi = (tile[row] >> 8) << 1;
+    u8 lo = tile[row];
+    for (int b = 7; b >= 0; b -= 1) {
+      u8 bits = (hi & 0b10) | (lo & 0b1);
+      DrawPixel(x + b, y + row, palette[bits]);
+
+      hi >>= 1;
+      lo >>= 1;
+    }
+  }
+}
+
+inline void DrawTileFrom(const Texture2D& tiles, size_t tile_idx, int x, int y) {
+  auto dst_y = tile_idx / 16;
+  auto dst_x = tile_idx % 16;
+
+  Rectangle rect {
+    static_cast<float>(dst_x * 8),
+    static_cast<float>(tiles.height - (dst_y * 8) - 8),
+    8.f,
+    -8.f,
+  };
+
+  Vector2 pos {
+    static_cast<float>(x),
+    static_cast<float>(y),
+  };
+
+  DrawTextureRec(tiles, rect, pos, WHITE);
+}
+
+inline void DrawOverlay(const TilemapOverlay& overlay) {
+  if (!overlay.visible) {
+    return;
+  }
+
+  const auto color = overlay.window ? BLUE : RED;
+  const int x1 = overlay.x1;
+  const int y1 = overlay.y1;
+  const int x2 = overlay.x2;
+  const int y2 = overlay.y2;
+
+  DrawLine(x1, y1, x2 < x1 ? 255 : x2, y1, color);
+  DrawLine(x1, y2, x2 < x1 ? 255 : x2, y2, color);
+  DrawLine(x1, y1, x1, y2 < y1 ? 255 : y2, color);
+  DrawLine(x2, y1, x2, y2 < y1 ? 255 : y2, color);
+}
+
 void Ppu::Init(PpuConfig cfg) {
   mmu_ = cfg.mmu;
   state_ = cfg.state;
   interrupts_ = cfg.interrupts;
+  SetColorCorrection(color_correction_);
 
-  auto logger = spdlog::get("doctor_logger");
-  log_doctor_ = logger != nullptr;
-
-  target_lcd_back_ = GenImageColor(kLCDWidth, kLCDHeight, BLACK);
-  ImageFormat(&target_lcd_back_, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
-
-  target_lcd_front_ = LoadTextureFromImage(target_lcd_back_);
+  lcd_frame_back_.pixels.fill(kBlankPixel);
+  lcd_frame_front_ = lcd_frame_back_;
+  LoadLcdTargets();
 
   constexpr int tiles_width = 16 * 8;
   constexpr int tiles_height = 48 * 8;
@@ -72,20 +166,36 @@ void Ppu::Init(PpuConfig cfg) {
   constexpr int sprites_height = 5 * 16;
   target_sprites_ = LoadRenderTexture(sprites_width, sprites_height);
 
-  target_lcd_back_ = GenImageColor(kLCDWidth, kLCDHeight, BLACK);
-  ImageFormat(&target_lcd_back_, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
-
   palette_ = std::move(cfg.palette);
 }
 
+Ppu::Ppu() = default;
+Ppu::~Ppu() = default;
+
 void Ppu::Cleanup() {
+  render_thread_.reset();
+
   UnloadRenderTexture(target_tiles_);
   UnloadRenderTexture(target_tilemap1_);
   UnloadRenderTexture(target_tilemap2_);
   UnloadRenderTexture(target_sprites_);
   UnloadRenderTexture(target_palettes_);
 
-  UnloadImage(target_lcd_back_);
+  UnloadLcdTargets();
+}
+
+void Ppu::LoadLcdTargets() {
+  const auto pixel_format = lcd_format_ == FrameBufferFormat::kRgb565
+    ? PIXELFORMAT_UNCOMPRESSED_R5G6B5
+    : PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+  target_lcd_image_ = GenImageColor(kLCDWidth, kLCDHeight, BLACK);
+  ImageFormat(&target_lcd_image_, pixel_format);
+  target_lcd_front_ = LoadTextureFromImage(target_lcd_image_);
+}
+
+void Ppu::UnloadLcdTargets() {
+  UnloadImage(target_lcd_image_);
   UnloadTexture(target_lcd_front_);
 }
 
@@ -98,14 +208,43 @@ void Ppu::OnTick(bool double_speed) {
     Step();
   }}
 
+// Between mode transitions a dot only bumps the counters, unless one of the
+// VRAM DMAs is waiting for its next block.
+u32 Ppu::IdleTicks(bool double_speed) const {
+  if (dma_state_.length && state_->halt && !dma_state_.hdma) {
+    return 0;
+  }
+  if (!regs_.lcdc.lcd_enable) {
+    return kIdleForever;
+  }
+  if (hblank_dma_counter_) {
+    return 0;
+  }
+  const u32 dots = double_speed ? 2 : 4;
+  if (next_transition_ <= cycle_counter_ + dots) {
+    return 0;
+  }
+  return (next_transition_ - cycle_counter_ - 1) / dots;
+}
+
+void Ppu::OnTicks(u32 m_cycles, bool double_speed) {
+  const u32 dots = m_cycles * (double_speed ? 2 : 4);
+  tick_counter_ = (tick_counter_ + dots) % 4;
+  if (regs_.lcdc.lcd_enable) {
+    cycle_counter_ += dots;
+  }
+}
+
 inline void Ppu::Step() {
   ZoneScoped;
 
   auto n = tick_counter_++;
   tick_counter_ %= 4;
 
-  if (n % 4 == 0 && state_->halt && dma_state_.length && !dma_state_.hdma) {
-    Bank().bytes[dma_state_.destination++] = mmu_->Read8(dma_state_.source++);
+  if (dma_state_.length && n % 4 == 0 && state_->halt && !dma_state_.hdma) {
+    if (dma_state_.length % kHdmaBlockSize == 0) {
+      TransferDmaBlock(kHdmaBlockSize);
+    }
     dma_state_.length--;
     if (!dma_state_.length) {
       state_->halt = false;
@@ -116,17 +255,26 @@ inline void Ppu::Step() {
     return;
   }
 
-  const auto mode = this->GetMode();
+  if (hblank_dma_counter_ && n % 4 == 0 && GetMode() == PPUMode::HBlank && !state_->halt) {
+    TransferDmaBlock(hblank_dma_counter_);
+    dma_state_.length -= hblank_dma_counter_;
+    hblank_dma_counter_ = 0;
+  }
 
-  static u8 hblank_dma_counter = 0;
-  if (n % 4 == 0 && mode == PPUMode::HBlank && !state_->halt && hblank_dma_counter) {
-    mmu_->Write8(dma_state_.destination++, mmu_->Read8(dma_state_.source++));
-    hblank_dma_counter--;
-    dma_state_.length--;
+  if (++cycle_counter_ < next_transition_) {
+    return;
   }
 
-  if (++cycle_counter_ >= kDotsPerRow) {
-    regs_.ly = (regs_.ly + 1) % (kLCDHeight + 10);
+  StepMode();
+}
+
+void Ppu::StepMode() {
+  ZoneScoped;
+
+  const auto mode = this->GetMode();
+
+  if (cycle_counter_ >= kDotsPerRow) {
+    regs_.ly = (regs_.ly + 1) % kNumScanlines;
     regs_.stat.coincidence_flag = regs_.ly == regs_.lyc;
     if (regs_.stat.coincidence_flag && regs_.stat.stat_interrupt_lyc) {
       interrupts_->RequestInterrupt(Interrupt::Stat);
@@ -145,6 +293,7 @@ inline void Ppu::Step() {
       }
       SwapLcdTargets();
     }
+    next_transition_ = kDotsPerRow;
   } else if (cycle_counter_ < kDotsPerOAM) {
     if (mode != PPUMode::OAM) {
       regs_.stat.ppu_mode = std::to_underlying(PPUMode::OAM);
@@ -152,10 +301,13 @@ inline void Ppu::Step() {
         interrupts_->RequestInterrupt(Interrupt::Stat);
       }
     }
-  } else if (cycle_counter_ <= (kDotsPerOAM + kDotsPerDraw)) {
+    next_transition_ = kDotsPerOAM;
+  } else if (cycle_counter_ <= (kDotsPerOAM + draw_length_)) {
     if (mode != PPUMode::Draw) {
       regs_.stat.ppu_mode = std::to_underlying(PPUMode::Draw);
+      draw_length_ = GetDrawLength();
     }
+    next_transition_ = kDotsPerOAM + draw_length_ + 1;
   } else {
     if (mode != PPUMode::HBlank) {
       regs_.stat.ppu_mode = std::to_underlying(PPUMode::HBlank);
@@ -163,19 +315,94 @@ inline void Ppu::Step() {
         interrupts_->RequestInterrupt(Interrupt::Stat);
       }
       if (dma_state_.hdma && dma_state_.length) {
-        hblank_dma_counter = static_cast<u8>(std::clamp<u16>(dma_state_.length, 0, 0x10));
+        hblank_dma_counter_ = static_cast<u8>(std::clamp<u16>(dma_state_.length, 0, 0x10));
       }
-      DrawLcdRow();
+      if (!skipped_frames_) {
+        if (render_thread_) {
+          render_thread_->SubmitLine(CaptureLine());
+        } else {
+          DrawLcdRow(CaptureLine(), banks_, oam_, lcd_frame_back_);
+        }
+      }
+      AdvanceWindowLine();
     }
+    next_transition_ = kDotsPerRow;
   }
 }
 
+u16 Ppu::GetDrawLength() const {
+  return kDotsPerDraw;
+}
+
 void Ppu::SwapLcdTargets() {
   frame_count_ += 1;
-  UpdateTexture(target_lcd_front_, target_lcd_back_.data);
+  if (!skipped_frames_) {
+    if (render_thread_) {
+      render_thread_->WaitIdle();
+    }
+    lcd_frame_front_ = lcd_frame_back_;
+    lcd_frame_back_.palettes.clear();
+    PresentLcd();
+  }
+  skipped_frames_ = skipped_frames_ >= frame_skip_ ? 0 : skipped_frames_ + 1;
+}
+
+PpuLineState Ppu::CaptureLine() const {
+  return {
+    .regs = regs_,
+    .window_line = window_line_counter_,
+    .hardware_mode = hardware_mode(),
+    .sprites = line_sprites_[regs_.ly],
+    .bg_palettes = cgb_bg_palettes_,
+    .sprite_palettes = cgb_sprite_palettes_,
+  };
+}
+
+void Ppu::PresentLcd() {
+  present_count_ += 1;
+  if (!deferred_present_) {
+    PresentFrame(lcd_frame_front_, palette_, frame_buffer_format_);
+  }
+}
+
+void Ppu::PresentFrame(const IndexedFrame& frame, const Palette& dmg_palette, FrameBufferFormat format) {
+  ZoneScoped;
+
+  if (format != lcd_format_) {
+    UnloadLcdTargets();
+    lcd_format_ = format;
+    LoadLcdTargets();
+  }
+
+  if (lcd_format_ == FrameBufferFormat::kRgb565) {
+    ExpandFrame(frame, dmg_palette, static_cast<u16*>(target_lcd_image_.data), ToRgb565);
+  } else {
+    ExpandFrame(frame, dmg_palette, static_cast<Color*>(target_lcd_image_.data), [](Color color) { return color; });
+  }
+  UpdateTexture(target_lcd_front_, target_lcd_image_.data);
+}
+
+void Ppu::SetDeferredPresent(bool deferred) {
+  deferred_present_ = deferred;
 }
 
-void Ppu::DrawLcdRow() {
+void Ppu::SetDoctorMode(bool enable) {
+  doctor_mode_ = enable;
+}
+
+u64 Ppu::GetPresentCount() const {
+  return present_count_;
+}
+
+void Ppu::AdvanceWindowLine() {
+  const bool enable_bg = hardware_mode() == HardwareMode::kDmgMode ? regs_.lcdc.bg_window_enable : true;
+  const bool enable_window = regs_.lcdc.window_enable && regs_.wx <= 166 && regs_.wy <= 143 && regs_.ly >= regs_.wy;
+  if (enable_bg && enable_window) {
+    window_line_counter_++;
+  }
+}
+
+void Ppu::DrawLcdRow(const PpuLineState& line, const VramBanks& banks, const OamMemory& oam, IndexedFrame& target) {
   ZoneScoped;
 
   struct BgPixels {
@@ -183,43 +410,56 @@ void Ppu::DrawLcdRow() {
     u8 bits;
   };
 
-  static std::array<BgPixels, kLCDWidth> bg_win_pixels;
-  bg_win_pixels.fill({});
+  std::array<BgPixels, kLCDWidth> bg_win_pixels {};
+
+  const bool is_dmg = line.hardware_mode == HardwareMode::kDmgMode;
+  auto* pixels = target.pixels.data() + line.regs.ly * kLCDWidth;
+  target.hardware_mode = line.hardware_mode;
+
+  if (!is_dmg) {
+    LcdPalette palette;
+    std::memcpy(palette.data(), line.bg_palettes.data(), sizeof(line.bg_palettes));
+    std::memcpy(palette.data() + kCgbNumPalettes * 4, line.sprite_palettes.data(), sizeof(line.sprite_palettes));
+    if (target.palettes.empty() || std::memcmp(target.palettes.back().data(), palette.data(), sizeof(LcdPalette)) != 0) {
+      target.palettes.push_back(palette);
+    }
+    target.line_palettes[line.regs.ly] = static_cast<u8>(target.palettes.size() - 1);
+  }
 
-  bool enable_bg = hardware_mode() == HardwareMode::kDmgMode ? regs_.lcdc.bg_window_enable : true;
-  bool bg_low_priority = hardware_mode() == HardwareMode::kDmgMode ? false : !regs_.lcdc.bg_window_enable;
+  const bool enable_bg = is_dmg ? line.regs.lcdc.bg_window_enable : true;
+  const bool bg_low_priority = is_dmg ? false : !line.regs.lcdc.bg_window_enable;
 
   if (enable_bg) {
-    const bool enable_window_flag = regs_.lcdc.window_enable &&
-      regs_.wx >= 0 && regs_.wx <= 166 && regs_.wy >= 0 && regs_.wy <= 143;
-    const u8 y = regs_.ly;
+    const bool enable_window_flag = line.regs.lcdc.window_enable &&
+      line.regs.wx >= 0 && line.regs.wx <= 166 && line.regs.wy >= 0 && line.regs.wy <= 143;
+    const u8 y = line.regs.ly;
 
-    u8 py = regs_.scy + y;
+    u8 py = line.regs.scy + y;
     u8 ty = (py >> 3 ) & 31;
     u8 row = py % 8;
 
     bool enable_window = false;
     for (auto x = 0; x < kLCDWidth; x += 1) {
-      if (!enable_window && enable_window_flag && x >= regs_.wx - 7 && y >= regs_.wy) {
+      if (!enable_window && enable_window_flag && x >= line.regs.wx - 7 && y >= line.regs.wy) {
         enable_window = true;
-        py = window_line_counter_;// y - regs.wy;
+        py = line.window_line;// y - regs.wy;
         ty = (py >> 3 ) & 31;
         row = py % 8;
       }
 
-      auto tilemap_idx = enable_window ? regs_.lcdc.window_tilemap_area : regs_.lcdc.bg_tilemap_area;
-      auto& tilemap = BankAt(0).tile_map[tilemap_idx];
-      auto& attrmap = BankAt(1).tile_map[tilemap_idx];
+      auto tilemap_idx = enable_window ? line.regs.lcdc.window_tilemap_area : line.regs.lcdc.bg_tilemap_area;
+      auto& tilemap = banks[0].tile_map[tilemap_idx];
+      auto& attrmap = banks[1].tile_map[tilemap_idx];
 
-      u8 px = enable_window ? x - (regs_.wx - 7) : regs_.scx + x;
+      u8 px = enable_window ? x - (line.regs.wx - 7) : line.regs.scx + x;
       u8 tx = (px >> 3) & 31;
       u8 sub_x = px % 8;
 
       auto map_idx = (ty * 32) + tx;
       auto tile_id = tilemap[map_idx];
       auto tile_attr = VramTileAttrib(attrmap[map_idx]);
-      auto tile_idx = (AddrWithMode(regs_.lcdc.tiledata_area, tile_id) - kVRAMAddrStart) / 16;
-      auto tile = BankAt(tile_attr.bank).tile_data[tile_idx];
+      auto tile_idx = (AddrWithMode(line.regs.lcdc.tiledata_area, tile_id) - kVRAMAddrStart) / 16;
+      auto tile = banks[tile_attr.bank].tile_data[tile_idx];
 
       auto xi = tile_attr.x_flip ? sub_x : 7 - sub_x;
       auto actual_row = tile_attr.y_flip ? 7 - row : row;
@@ -228,52 +468,40 @@ void Ppu::DrawLcdRow() {
       u8 lo = tile[actual_row] >> xi;
       u8 bits = ((hi & 0b1) << 1) | (lo & 0b1);
 
-      if (hardware_mode() == HardwareMode::kDmgMode) {
-        auto cid = GetPaletteIndex(bits, regs_.bgp);
-        auto color = palette_[cid];
-        ImageDrawPixel(&target_lcd_back_, x, y, color);
+      if (is_dmg) {
+        pixels[x] = GetPaletteIndex(bits, line.regs.bgp);
       } else {
         bg_win_pixels[x].priority = tile_attr.priority;
-        auto cgb_palette = cgb_bg_palettes_[tile_attr.palette];
-        ImageDrawPixel(&target_lcd_back_, x, y, cgb_palette[bits & 0b11]);
+        pixels[x] = (tile_attr.palette << 2) | (bits & 0b11);
       }
 
       bg_win_pixels[x].bits = bits;
     }
-
-    if (enable_window) {
-      window_line_counter_++;
-    }
   } else {
-    if (hardware_mode() == HardwareMode::kDmgMode) {
-      auto cid = GetPaletteIndex(0, regs_.bgp);
-      auto color = palette_[cid];
-      ImageDrawLine(&target_lcd_back_, 0, regs_.ly, kLCDWidth, regs_.ly,  color);
+    if (is_dmg) {
+      std::fill_n(pixels, kLCDWidth, GetPaletteIndex(0, line.regs.bgp));
     } else {
-      ImageDrawLine(&target_lcd_back_, 0, regs_.ly, kLCDWidth, regs_.ly,  cgb_bg_palettes_[0][0]);
+      std::fill_n(pixels, kLCDWidth, 0);
     }
   }
 
-  if (regs_.lcdc.sprite_enable) {
-    static std::vector<Sprite*> valid_sprites;
-    valid_sprites.clear();
-    valid_sprites.reserve(10);
+  if (line.regs.lcdc.sprite_enable) {
+    std::array<const Sprite*, kMaxSpritesPerLine> line_sprites;
+    size_t num_sprites = 0;
 
-    const auto height = regs_.lcdc.sprite_size ? 16 : 8;
-    const auto y = regs_.ly;
+    const auto height = line.regs.lcdc.sprite_size ? 16 : 8;
+    const auto y = line.regs.ly;
 
-    for (auto& sprite : oam_.sprites) {
+    for (auto mask = line.sprites; mask && num_sprites < kMaxSpritesPerLine; mask &= mask - 1) {
+      const auto& sprite = oam.sprites[std::countr_zero(mask)];
       auto top = sprite.y - 16;
-      auto bottom = top + height;
-      if (y >= top && y < bottom) {
-        valid_sprites.push_back(&sprite);
-        if (valid_sprites.size() >= 10) {
-          break;
-        }
+      if (y < top + height) {
+        line_sprites[num_sprites++] = &sprite;
       }
     }
+    const auto valid_sprites = std::span(line_sprites.data(), num_sprites);
 
-    static std::array<u8, kLCDWidth> sprite_prio;
+    std::array<u8, kLCDWidth> sprite_prio;
     sprite_prio.fill(0xff);
 
     u8 oam_idx = 0;
@@ -282,7 +510,7 @@ void Ppu::DrawLcdRow() {
       auto top = sprite->y - 16;
       auto row = attrs.y_flip ? height - (y - top) - 1  : y - top;
       u8 tile_id = sprite->tile;
-      if (regs_.lcdc.sprite_size) {
+      if (line.regs.lcdc.sprite_size) {
         if (row < 8) {
           tile_id &= 0xfe;
         } else {
@@ -290,7 +518,7 @@ void Ppu::DrawLcdRow() {
         }
       }
       auto tile_idx = (AddrWithMode(1, tile_id) - kVRAMAddrStart) / 16;
-      auto tile = BankAt(attrs.cgb_bank).tile_data[tile_idx];
+      auto tile = banks[attrs.cgb_bank].tile_data[tile_idx];
       auto left = sprite->x - 8;
 
       for (auto x = sprite->x - 8; x < sprite->x; x += 1) {
@@ -313,14 +541,12 @@ void Ppu::DrawLcdRow() {
         u8 bits = ((hi & 0b1) << 1) | (lo & 0b1);
 
         if (bits) {
-          if (hardware_mode() == HardwareMode::kDmgMode) {
-            auto palette = attrs.dmg_palette ? regs_.obp1: regs_.obp0;
-            auto cid = GetPaletteIndex(bits, palette);
-            ImageDrawPixel(&target_lcd_back_, x, y, palette_[cid]);
+          if (is_dmg) {
+            auto palette = attrs.dmg_palette ? line.regs.obp1: line.regs.obp0;
+            pixels[x] = GetPaletteIndex(bits, palette);
             sprite_prio[x] = sprite->x;
           } else {
-            auto cgb_palette = cgb_sprite_palettes_[attrs.cgb_palette];
-            ImageDrawPixel(&target_lcd_back_, x, y, cgb_palette[bits & 0b11]);
+            pixels[x] = ((kCgbNumPalettes + attrs.cgb_palette) << 2) | (bits & 0b11);
             sprite_prio[x] = oam_idx;
           }
         }
@@ -334,6 +560,30 @@ const Texture2D& Ppu::GetTextureLcd() const {
   return target_lcd_front_;
 }
 
+const IndexedFrame& Ppu::GetLcdFrame() const {
+  return lcd_frame_front_;
+}
+
+void Ppu::ExpandLcdFrame(std::span<Color> dst) const {
+  ExpandIndexedFrame(lcd_frame_front_, palette_, dst);
+}
+
+void Ppu::ExpandIndexedFrame(const IndexedFrame& frame, const Palette& dmg_palette, std::span<Color> dst) {
+  if (dst.size() < frame.pixels.size()) {
+    return;
+  }
+  ExpandFrame(frame, dmg_palette, dst.data(), [](Color color) { return color; });
+}
+
+const Palette& Ppu::GetDmgPalette() const {
+  return palette_;
+}
+
+u32 Ppu::GetDotsSinceVBlank() const {
+  const u32 lines = (regs_.ly + kNumScanlines - kLCDHeight) % kNumScanlines;
+  return lines * kDotsPerRow + cycle_counter_;
+}
+
 const RenderTexture2D& Ppu::GetTextureTilemap1() const {
   return target_tilemap1_;
 }
@@ -354,215 +604,181 @@ const RenderTexture2D& Ppu::GetTexturePalettes() const {
   return target_palettes_;
 }
 
-void Ppu::UpdateRenderTargets() {
+RenderTargetDirty& RenderTargetDirty::operator|=(const RenderTargetDirty& other) {
+  for (size_t i = 0; i < tiles.size(); i += 1) {
+    tiles[i] |= other.tiles[i];
+  }
+  for (size_t i = 0; i < tilemap_tiles.size(); i += 1) {
+    tilemap_tiles[i] |= other.tilemap_tiles[i];
+    tilemap_entries[i] |= other.tilemap_entries[i];
+  }
+  sprites = sprites || other.sprites;
+  palettes = palettes || other.palettes;
+  clear = clear || other.clear;
+  return *this;
+}
+
+void Ppu::CaptureDebugView(PpuDebugView& view) {
   ZoneScoped;
 
-  constexpr int tile_width = 16;
-  constexpr int tile_height = 24;
+  view.banks = banks_;
+  view.oam = oam_;
+  view.regs = regs_;
+  view.hardware_mode = hardware_mode();
+  view.dmg_palette = palette_;
+  view.bg_palettes = cgb_bg_palettes_;
+  view.sprite_palettes = cgb_sprite_palettes_;
+  view.dirty = std::exchange(debug_dirty_, {});
+}
 
-  BeginTextureMode(target_tiles_);
-  {
-    ZoneScopedN("BeginTextureMode:target_tiles");
+void Ppu::AddRenderTargetChanges(const RenderTargetDirty& dirty) {
+  target_dirty_ |= dirty;
+}
 
-    int x = 0;
-    int y = 0;
+void Ppu::UpdateRenderTargets(const PpuDebugView& view, RenderTargetFlags targets) {
+  ZoneScoped;
 
-    for (auto& tile : BankAt(0).tile_data) {
-      for (int row = 0; row < tile.size(); row += 1) {
-        u16 hi = (tile[row] >> 8) << 1;
-        u8 lo = tile[row];
-        for (int b = 7; b >= 0; b -= 1) {
-          u8 bits = (hi & 0b10) | (lo & 0b1);
-          auto color = palette_[bits];
-          DrawPixel((x * 8) + b, (y * 8) + row, color);
+  if (target_dirty_.clear) {
+    target_dirty_.clear = false;
+    for (auto* target : { &target_tiles_, &target_tilemap1_, &target_tilemap2_, &target_sprites_, &target_palettes_ }) {
+      BeginTextureMode(*target);
+      ClearBackground(BLANK);
+      EndTextureMode();
+    }
+  }
 
-          hi >>= 1;
-          lo >>= 1;
-        }
-      }
+  if (targets.tiles || targets.tilemap1 || targets.tilemap2 || targets.sprites) {
+    UpdateTilesTarget(view);
+  }
+  if (targets.tilemap1) {
+    UpdateTilemapTarget(view, 0);
+  }
+  if (targets.tilemap2) {
+    UpdateTilemapTarget(view, 1);
+  }
+  if (targets.sprites) {
+    UpdateSpritesTarget(view);
+  }
+  if (targets.palettes) {
+    UpdatePalettesTarget(view);
+  }
+}
 
-      x += 1;
-      if (x >= tile_width) {
-        x = 0;
-        y += 1;
-      }
-    }
+void Ppu::UpdateTilesTarget(const PpuDebugView& view) {
+  ZoneScoped;
 
-    if (hardware_mode() == HardwareMode::kCgbMode) {
+  const size_t num_banks = view.hardware_mode == HardwareMode::kCgbMode ? kVramNumBanks : 1;
 
-      for (auto& tile : BankAt(1).tile_data) {
-        for (int row = 0; row < tile.size(); row += 1) {
-          u16 hi = (tile[row] >> 8) << 1;
-          u8 lo = tile[row];
-          for (int b = 7; b >= 0; b -= 1) {
-            u8 bits = (hi & 0b10) | (lo & 0b1);
-            auto color = palette_[bits];
-            DrawPixel((x * 8) + b, (y * 8) + row, color);
+  bool dirty = false;
+  for (size_t bank = 0; bank < num_banks; bank += 1) {
+    dirty = dirty || target_dirty_.tiles[bank].any();
+  }
+  if (!dirty) {
+    return;
+  }
 
-            hi >>= 1;
-            lo >>= 1;
-          }
-        }
+  BeginTextureMode(target_tiles_);
+  {
+    ZoneScopedN("BeginTextureMode:target_tiles");
+
+    for (size_t bank = 0; bank < num_banks; bank += 1) {
+      auto& dirty_tiles = target_dirty_.tiles[bank];
+      const auto& tile_data = view.banks[bank].tile_data;
 
-        x += 1;
-        if (x >= tile_width) {
-          x = 0;
-          y += 1;
+      for (size_t i = 0; i < kNumTiles; i += 1) {
+        if (!dirty_tiles.test(i)) {
+          continue;
         }
+
+        const auto pos = (bank * kNumTiles) + i;
+        DrawTile(tile_data[i], (pos % kTilesPerRow) * 8, (pos / kTilesPerRow) * 8, view.dmg_palette);
       }
+      dirty_tiles.reset();
     }
   }
   EndTextureMode();
+}
 
-  BeginTextureMode(target_tilemap1_);
-  {
-    ZoneScopedN("BeginTextureMode:target_tilemap1");
-
-    auto tiledata_area = regs_.lcdc.tiledata_area;
-    auto& tilemap = BankAt(0).tile_map[0];
-
-    int x = 0;
-    int y = 0;
-    for (auto tile : tilemap) {
-      auto tile_idx = (AddrWithMode(tiledata_area, tile) - kVRAMAddrStart) / 16;
-      auto dst_y = tile_idx / 16;
-      auto dst_x = tile_idx % 16;
-
-      Rectangle rect {
-        static_cast<float>(dst_x * 8),
-        static_cast<float>(target_tiles_.texture.height - (dst_y * 8) - 8),
-        8.f,
-        -8.f,
-      };
-
-      Vector2 pos {
-        static_cast<float>(x * 8),
-        static_cast<float>(y * 8),
-      };
-
-      DrawTextureRec(target_tiles_.texture, rect, pos, WHITE);
-
-      x += 1;
-      if (x >= 32) {
-        x = 0;
-        y += 1;
-      }
-    }
+void Ppu::UpdateTilemapTarget(const PpuDebugView& view, u8 idx) {
+  ZoneScoped;
 
-    if (regs_.lcdc.bg_tilemap_area == 0) {
-      auto x1 = regs_.scx;
-      auto y1 = regs_.scy;
-      auto x2 = (x1 + kLCDWidth - 1) % 256;
-      auto y2 = (y1 + kLCDHeight - 1) % 256;
+  auto& dirty_entries = target_dirty_.tilemap_entries[idx];
+  auto& dirty_tiles = target_dirty_.tilemap_tiles[idx];
 
-      DrawLine(x1, y1, x2 < x1 ? 255 : x2, y1, RED);
-      DrawLine(x1, y2, x2 < x1 ? 255 : x2, y2, RED);
-      DrawLine(x1, y1, x1, y2 < y1 ? 255 : y2, RED);
-      DrawLine(x2, y1, x2, y2 < y1 ? 255 : y2, RED);
-    }
-    if (regs_.lcdc.window_tilemap_area == 0) {
-      auto x1 = regs_.wx < 7 ? kLCDWidth + regs_.wx - 7 : regs_.wx - 7;
-      auto y1 = regs_.wy;
-      auto x2 = (x1 + kLCDWidth - 1) % 256;
-      auto y2 = (y1 + kLCDHeight - 1) % 256;
+  const auto tiledata_area = view.regs.lcdc.tiledata_area;
+  if (tilemap_tiledata_area_[idx] != tiledata_area) {
+    tilemap_tiledata_area_[idx] = tiledata_area;
+    dirty_entries.set();
+  }
 
-      DrawLine(x1, y1, x2 < x1 ? 255 : x2, y1, BLUE);
-      DrawLine(x1, y2, x2 < x1 ? 255 : x2, y2, BLUE);
-      DrawLine(x1, y1, x1, y2 < y1 ? 255 : y2, BLUE);
-      DrawLine(x2, y1, x2, y2 < y1 ? 255 : y2, BLUE);
+  const std::array<TilemapOverlay, 2> overlays {
+    GetTilemapOverlay(view.regs, idx, false),
+    GetTilemapOverlay(view.regs, idx, true),
+  };
+
+  if (overlays != tilemap_overlays_[idx]) {
+    for (const auto& overlay : tilemap_overlays_[idx]) {
+      MarkOverlayDirty(idx, overlay);
     }
+  } else if (dirty_entries.none() && dirty_tiles.none()) {
+    return;
   }
-  EndTextureMode();
 
-  BeginTextureMode(target_tilemap2_);
-  {
-    ZoneScopedN("BeginTextureMode:target_tilemap2");
-
-    auto tiledata_area = regs_.lcdc.tiledata_area;
-    auto& tilemap = BankAt(0).tile_map[1];
-
-    int x = 0;
-    int y = 0;
-    for (const auto& tile : tilemap) {
-      auto tile_idx = (AddrWithMode(tiledata_area, tile) - kVRAMAddrStart) / 16;
-      auto dst_y = tile_idx / 16;
-      auto dst_x = tile_idx % 16;
-
-      Rectangle rect {
-        static_cast<float>(dst_x * 8),
-        static_cast<float>(target_tiles_.texture.height - (dst_y * 8) - 8),
-        8.f,
-        -8.f,
-      };
-
-      Vector2 pos {
-        static_cast<float>(x * 8),
-        static_cast<float>(y * 8),
-      };
-
-      DrawTextureRec(target_tiles_.texture, rect, pos, WHITE);
-
-      x += 1;
-      if (x >= 32) {
-        x = 0;
-        y += 1;
+  const auto& tilemap = view.banks[0].tile_map[idx];
+  if (dirty_tiles.any()) {
+    for (size_t i = 0; i < kTilemapSize; i += 1) {
+      auto tile_idx = (AddrWithMode(tiledata_area, tilemap[i]) - kVRAMAddrStart) / 16;
+      if (dirty_tiles.test(tile_idx)) {
+        dirty_entries.set(i);
       }
     }
+  }
 
-    if (regs_.lcdc.bg_tilemap_area == 1) {
-      auto x1 = regs_.scx;
-      auto y1 = regs_.scy;
-      auto x2 = (x1 + kLCDWidth - 1) % 256;
-      auto y2 = (y1 + kLCDHeight - 1) % 256;
+  BeginTextureMode(idx ? target_tilemap2_ : target_tilemap1_);
+  {
+    ZoneScopedN("BeginTextureMode:target_tilemap");
+
+    for (size_t i = 0; i < kTilemapSize; i += 1) {
+      if (!dirty_entries.test(i)) {
+        continue;
+      }
 
-      DrawLine(x1, y1, x2 < x1 ? 255 : x2, y1, RED);
-      DrawLine(x1, y2, x2 < x1 ? 255 : x2, y2, RED);
-      DrawLine(x1, y1, x1, y2 < y1 ? 255 : y2, RED);
-      DrawLine(x2, y1, x2, y2 < y1 ? 255 : y2, RED);
+      auto tile_idx = (AddrWithMode(tiledata_area, tilemap[i]) - kVRAMAddrStart) / 16;
+      DrawTileFrom(target_tiles_.texture, tile_idx, (i % 32) * 8, (i / 32) * 8);
     }
-    if (regs_.lcdc.window_tilemap_area == 1) {
-      auto x1 = regs_.wx < 7 ? kLCDWidth + (regs_.wx - 7) : regs_.wx - 7;
-      auto y1 = regs_.wy;
-      auto x2 = (x1 + kLCDWidth - 1) % 256;
-      auto y2 = (y1 + kLCDHeight - 1) % 256;
 
-      DrawLine(x1, y1, x2 < x1 ? 255 : x2, y1, BLUE);
-      DrawLine(x1, y2, x2 < x1 ? 255 : x2, y2, BLUE);
-      DrawLine(x1, y1, x1, y2 < y1 ? 255 : y2, BLUE);
-      DrawLine(x2, y1, x2, y2 < y1 ? 255 : y2, BLUE);
+    for (const auto& overlay : overlays) {
+      DrawOverlay(overlay);
     }
   }
   EndTextureMode();
 
+  dirty_entries.reset();
+  dirty_tiles.reset();
+  tilemap_overlays_[idx] = overlays;
+}
+
+void Ppu::UpdateSpritesTarget(const PpuDebugView& view) {
+  ZoneScoped;
+
+  if (!target_dirty_.sprites) {
+    return;
+  }
+
   BeginTextureMode(target_sprites_);
   {
     ZoneScopedN("BeginTextureMode:target_sprites");
 
     ClearBackground(BLANK);
 
-    auto sprite_tile_height = regs_.lcdc.sprite_size ? 2 : 1;
+    auto sprite_tile_height = view.regs.lcdc.sprite_size ? 2 : 1;
     auto row = 0;
     auto col = 0;
 
-    for (auto& sprite : oam_.sprites) {
+    for (auto& sprite : view.oam.sprites) {
       for (auto ti = 0; ti < sprite_tile_height; ti += 1) {
         auto tile_idx = ((AddrWithMode(1, sprite.tile) - kVRAMAddrStart) / 16) + ti;
-        auto dst_y = tile_idx / 16;
-        auto dst_x = tile_idx % 16;
-
-        Rectangle rect {
-          static_cast<float>(dst_x * 8),
-          static_cast<float>(target_tiles_.texture.height - (dst_y * 8) - 8),
-          8.f,
-          -8.f,
-        };
-
-        Vector2 pos {
-          static_cast<float>(col * 9),
-          static_cast<float>((row * sprite_tile_height * 9) + (ti * 9))
-        };
-
-        DrawTextureRec(target_tiles_.texture, rect, pos, WHITE);
+        DrawTileFrom(target_tiles_.texture, tile_idx, col * 9, (row * sprite_tile_height * 9) + (ti * 9));
 
         col += 1;
         if (col >= 8) {
@@ -574,6 +790,16 @@ void Ppu::UpdateRenderTargets() {
   }
   EndTextureMode();
 
+  target_dirty_.sprites = false;
+}
+
+void Ppu::UpdatePalettesTarget(const PpuDebugView& view) {
+  ZoneScoped;
+
+  if (!target_dirty_.palettes) {
+    return;
+  }
+
   BeginTextureMode(target_palettes_);
   {
     ZoneScopedN("BeginTextureMode:target_palettes");
@@ -587,29 +813,119 @@ void Ppu::UpdateRenderTargets() {
     for (auto i = 0; i < kCgbNumPalettes; i++) {
       int x = i * w;
       int y = 0;
-      DrawRectangle(4 + x, 14 + y, w, h, cgb_bg_palettes_[i][0]);
+      DrawRectangle(4 + x, 14 + y, w, h, view.bg_palettes[i][0]);
       y += h;
-      DrawRectangle(4 + x, 14 + y, w, h, cgb_bg_palettes_[i][1]);
+      DrawRectangle(4 + x, 14 + y, w, h, view.bg_palettes[i][1]);
       y += h;
-      DrawRectangle(4 + x, 14 + y, w, h, cgb_bg_palettes_[i][2]);
+      DrawRectangle(4 + x, 14 + y, w, h, view.bg_palettes[i][2]);
       y += h;
-      DrawRectangle(4 + x, 14 + y, w, h, cgb_bg_palettes_[i][3]);
+      DrawRectangle(4 + x, 14 + y, w, h, view.bg_palettes[i][3]);
     }
 
     DrawText("Sprite", 4, 50, 10, RED);
       for (auto i = 0; i < kCgbNumPalettes; i++) {
       int x = i * w;
       int y = 64;
-      DrawRectangle(4 + x, 14 + y, w, h, cgb_sprite_palettes_[i][0]);
+      DrawRectangle(4 + x, 14 + y, w, h, view.sprite_palettes[i][0]);
       y += h;
-      DrawRectangle(4 + x, 14 + y, w, h, cgb_sprite_palettes_[i][1]);
+      DrawRectangle(4 + x, 14 + y, w, h, view.sprite_palettes[i][1]);
       y += h;
-      DrawRectangle(4 + x, 14 + y, w, h, cgb_sprite_palettes_[i][2]);
+      DrawRectangle(4 + x, 14 + y, w, h, view.sprite_palettes[i][2]);
       y += h;
-      DrawRectangle(4 + x, 14 + y, w, h, cgb_sprite_palettes_[i][3]);
+      DrawRectangle(4 + x, 14 + y, w, h, view.sprite_palettes[i][3]);
     }
   }
   EndTextureMode();
+
+  target_dirty_.palettes = false;
+}
+
+TilemapOverlay Ppu::GetTilemapOverlay(const PpuRegs& regs, u8 idx, bool window) {
+  if (!window) {
+    u8 x1 = regs.scx;
+    u8 y1 = regs.scy;
+    return {
+      .visible = regs.lcdc.bg_tilemap_area == idx,
+      .window = false,
+      .x1 = x1,
+      .y1 = y1,
+      .x2 = static_cast<u8>((x1 + kLCDWidth - 1) % 256),
+      .y2 = static_cast<u8>((y1 + kLCDHeight - 1) % 256),
+    };
+  }
+
+  u8 x1 = regs.wx < 7 ? kLCDWidth + regs.wx - 7 : regs.wx - 7;
+  u8 y1 = regs.wy;
+  return {
+    .visible = regs.lcdc.window_tilemap_area == idx,
+    .window = true,
+    .x1 = x1,
+    .y1 = y1,
+    .x2 = static_cast<u8>((x1 + kLCDWidth - 1) % 256),
+    .y2 = static_cast<u8>((y1 + kLCDHeight - 1) % 256),
+  };
+}
+
+void Ppu::MarkOverlayDirty(u8 idx, const TilemapOverlay& overlay) {
+  if (!overlay.visible) {
+    return;
+  }
+
+  auto& dirty_entries = target_dirty_.tilemap_entries[idx];
+  for (u8 y : { overlay.y1, static_cast<u8>(overlay.y1 + 1), overlay.y2, static_cast<u8>(overlay.y2 + 1) }) {
+    for (size_t tx = 0; tx < 32; tx += 1) {
+      dirty_entries.set(((y >> 3) * 32) + tx);
+    }
+  }
+  for (u8 x : { overlay.x1, static_cast<u8>(overlay.x1 + 1), overlay.x2, static_cast<u8>(overlay.x2 + 1) }) {
+    for (size_t ty = 0; ty < 32; ty += 1) {
+      dirty_entries.set((ty * 32) + (x >> 3));
+    }
+  }
+}
+
+void Ppu::MarkVramDirty(u8 bank, u16 offset) {
+  if (offset < kTileDataSize) {
+    const auto tile_idx = offset / 16;
+    debug_dirty_.tiles[bank].set(tile_idx);
+    if (bank == 0) {
+      debug_dirty_.tilemap_tiles[0].set(tile_idx);
+      debug_dirty_.tilemap_tiles[1].set(tile_idx);
+      debug_dirty_.sprites = true;
+    }
+    return;
+  }
+
+  if (bank == 0) {
+    offset -= kTileDataSize;
+    debug_dirty_.tilemap_entries[offset / kTilemapSize].set(offset % kTilemapSize);
+  }
+}
+
+void Ppu::MarkRenderTargetsDirty() {
+  for (auto& dirty_tiles : debug_dirty_.tiles) {
+    dirty_tiles.set();
+  }
+  for (auto& dirty_tiles : debug_dirty_.tilemap_tiles) {
+    dirty_tiles.set();
+  }
+  for (auto& dirty_entries : debug_dirty_.tilemap_entries) {
+    dirty_entries.set();
+  }
+  debug_dirty_.sprites = true;
+  debug_dirty_.palettes = true;
+}
+
+inline void Ppu::WriteVram(u16 offset, u8 byte) {
+  auto& dst = Bank().bytes[offset];
+  if (dst == byte) {
+    return;
+  }
+  dst = byte;
+  MarkVramDirty(vbk_ & 0x1, offset);
+  if (render_thread_) {
+    render_thread_->PushVramWrite(vbk_ & 0x1, offset, byte);
+  }
 }
 
 bool Ppu::IsValidFor(u16 addr) const {
@@ -644,6 +960,23 @@ bool Ppu::IsValidFor(u16 addr) const {
   return false;
 }
 
+// Spans cover VRAM only, in the bank VBK selects.
+bool Ppu::IsValidForRange(u16 first, u16 last) const {
+  return first >= kVRAMAddrStart && last <= kVRAMAddrEnd;
+}
+
+void Ppu::ReadSpan(u16 addr, std::span<u8> dst) const {
+  std::copy_n(Bank().bytes.begin() + (addr - kVRAMAddrStart), dst.size(), dst.begin());
+}
+
+// Byte by byte through WriteVram, which skips unchanged bytes and marks the
+// debug targets and the render thread's copy for the rest.
+void Ppu::WriteSpan(u16 addr, std::span<const u8> src) {
+  for (auto byte : src) {
+    WriteVram(addr++ - kVRAMAddrStart, byte);
+  }
+}
+
 void Ppu::Write8(u16 addr, u8 byte) {
   if (addr == std::to_underlying(IO::VBK)) {
     if (hardware_mode() == HardwareMode::kDmgMode) {
@@ -654,12 +987,20 @@ void Ppu::Write8(u16 addr, u8 byte) {
   }
 
   if (addr >= kVRAMAddrStart && addr <= kVRAMAddrEnd) {
-    Bank().bytes[addr - kVRAMAddrStart] = byte;
+    WriteVram(addr - kVRAMAddrStart, byte);
     return;
   }
 
   if (addr >= kOAMAddrStart && addr <= kOAMAddrEnd) {
-    oam_.bytes[addr - kOAMAddrStart] = byte;
+    const auto offset = addr - kOAMAddrStart;
+    if (offset % sizeof(Sprite) == 0) {
+      IndexSprite(offset / sizeof(Sprite), oam_.bytes[offset], byte);
+    }
+    oam_.bytes[offset] = byte;
+    debug_dirty_.sprites = true;
+    if (render_thread_) {
+      render_thread_->PushOamWrite(offset, byte);
+    }
     return;
   }
 
@@ -730,7 +1071,8 @@ void Ppu::Write8(u16 addr, u8 byte) {
 
     auto palette_idx = (cgb_regs_.bcps.address >> 3) & 0x7;
     auto color_idx = (cgb_regs_.bcps.address >> 1) & 0x3;
-    cgb_bg_palettes_[palette_idx][color_idx] = col.GetColor();
+    cgb_bg_palettes_[palette_idx][color_idx] = color_lut_[col.value & 0x7fff];
+    debug_dirty_.palettes = true;
 
     if (cgb_regs_.bcps.auto_increment) {
       cgb_regs_.bcps.address++;
@@ -759,7 +1101,8 @@ void Ppu::Write8(u16 addr, u8 byte) {
 
     auto palette_idx = (cgb_regs_.ocps.address >> 3) & 0x7;
     auto color_idx = (cgb_regs_.ocps.address >> 1) & 0x3;
-    cgb_sprite_palettes_[palette_idx][color_idx] = col.GetColor();
+    cgb_sprite_palettes_[palette_idx][color_idx] = color_lut_[col.value & 0x7fff];
+    debug_dirty_.palettes = true;
 
     if (cgb_regs_.ocps.auto_increment) {
       cgb_regs_.ocps.address++;
@@ -783,10 +1126,13 @@ void Ppu::Write8(u16 addr, u8 byte) {
   }
 
   if (addr == std::to_underlying(IO::LCDC)) {
+    const auto sprite_size = regs_.lcdc.sprite_size;
     regs_.lcdc = PpuRegs::LCDC(byte);
+    debug_dirty_.sprites = debug_dirty_.sprites || sprite_size != regs_.lcdc.sprite_size;
     if (!regs_.lcdc.lcd_enable) {
       regs_.ly = 0;
       cycle_counter_ = 0;
+      next_transition_ = 0;
       window_line_counter_ = 0;
       regs_.stat.ppu_mode = 0;
       ClearTargetBuffers();
@@ -959,7 +1305,7 @@ u8 Ppu::Read8(u16 addr) const {
   }
 
   if (addr == std::to_underlying(IO::LY)) {
-    if (log_doctor_) {
+    if (doctor_mode_) {
       return 0x90;
     }
     return regs_.ly;
@@ -1006,8 +1352,12 @@ void Ppu::Reset() {
     bank.Reset();
   }
   oam_.Reset();
+  line_sprites_.fill(0);
   regs_.Reset();
   cycle_counter_ = 0;
+  next_transition_ = 0;
+  draw_length_ = kDotsPerDraw;
+  hblank_dma_counter_ = 0;
   window_line_counter_ = 0;
   frame_count_ = 0;
   banks_ = {};
@@ -1018,33 +1368,24 @@ void Ppu::Reset() {
   dma_state_ = {};
   cgb_regs_ = {};
   tick_counter_ = 0;
+  skipped_frames_ = 0;
 
-  BeginTextureMode(target_tiles_);
-  ClearBackground(BLANK);
-  EndTextureMode();
-
-  BeginTextureMode(target_tilemap1_);
-  ClearBackground(BLANK);
-  EndTextureMode();
-
-  BeginTextureMode(target_tilemap2_);
-  ClearBackground(BLANK);
-  EndTextureMode();
-
-  BeginTextureMode(target_sprites_);
-  ClearBackground(BLANK);
-  EndTextureMode();
-
-  BeginTextureMode(target_palettes_);
-  ClearBackground(BLANK);
-  EndTextureMode();
-
+  MarkRenderTargetsDirty();
+  debug_dirty_.clear = true;
+  if (render_thread_) {
+    render_thread_->Sync(banks_, oam_);
+  }
   ClearTargetBuffers();
 }
 
 void Ppu::ClearTargetBuffers() {
-  ImageClearBackground(&target_lcd_back_, BLANK);
-  UpdateTexture(target_lcd_front_, target_lcd_back_.data);
+  if (render_thread_) {
+    render_thread_->WaitIdle();
+  }
+  lcd_frame_back_.pixels.fill(kBlankPixel);
+  lcd_frame_back_.palettes.clear();
+  lcd_frame_front_ = lcd_frame_back_;
+  PresentLcd();
 }
 
 PPUMode Ppu::GetMode() const {
@@ -1057,12 +1398,12 @@ void Ppu::SetMode(PPUMode mode) {
 
 void Ppu::StartDma() {
   auto source = regs_.dma << 8;
+  debug_dirty_.sprites = true;
 
   if (source >= kVRAMAddrStart && source <= kVRAMAddrEnd) {
-    auto base = source - kVRAMAddrStart;
-    for (auto i = 0; i < oam_.bytes.size(); i += 1) {
-      oam_.bytes[i] = Bank().bytes[base + i];
-    }
+    auto base = Bank().bytes.begin() + (source - kVRAMAddrStart);
+    std::copy_n(base, oam_.bytes.size(), oam_.bytes.begin());
+    FinishDma();
     return;
   }
 
@@ -1070,8 +1411,41 @@ void Ppu::StartDma() {
     source = kExtRamBusStart + (source & kExtRamBusMask);
   }
 
-  for (auto i = 0; i < oam_.bytes.size(); i += 1) {
-    oam_.bytes[i] = mmu_->Read8(source + i);
+  mmu_->ReadSpan(source, oam_.bytes);
+  FinishDma();
+}
+
+void Ppu::FinishDma() {
+  RebuildSpriteIndex();
+  if (render_thread_) {
+    for (auto i = 0; i < oam_.bytes.size(); i += 1) {
+      render_thread_->PushOamWrite(i, oam_.bytes[i]);
+    }
+  }
+}
+
+void Ppu::IndexSprite(size_t idx, u8 old_y, u8 new_y) {
+  if (old_y == new_y) {
+    return;
+  }
+
+  const u64 bit = u64{1} << idx;
+  for (int line = old_y - kMaxSpriteHeight; line < old_y; line += 1) {
+    if (line >= 0 && line < kNumScanlines) {
+      line_sprites_[line] &= ~bit;
+    }
+  }
+  for (int line = new_y - kMaxSpriteHeight; line < new_y; line += 1) {
+    if (line >= 0 && line < kNumScanlines) {
+      line_sprites_[line] |= bit;
+    }
+  }
+}
+
+void Ppu::RebuildSpriteIndex() {
+  line_sprites_.fill(0);
+  for (size_t i = 0; i < kNumSprites; i += 1) {
+    IndexSprite(i, 0, oam_.sprites[i].y);
   }
 }
 
@@ -1083,8 +1457,71 @@ size_t Ppu::GetFrameCount() const {
   return frame_count_;
 }
 
+void Ppu::SetThreadedRendering(bool enable) {
+#if defined(__EMSCRIPTEN__)
+  enable = false;
+#endif
+  if (enable == IsThreadedRendering()) {
+    return;
+  }
+
+  if (enable) {
+    render_thread_ = std::make_unique<PpuRenderThread>();
+    render_thread_->Start(&lcd_frame_back_, banks_, oam_);
+  } else {
+    render_thread_.reset();
+  }
+}
+
+bool Ppu::IsThreadedRendering() const {
+  return render_thread_ != nullptr;
+}
+
+void Ppu::SetFrameSkip(u8 frame_skip) {
+  frame_skip_ = frame_skip;
+}
+
+u8 Ppu::GetFrameSkip() const {
+  return frame_skip_;
+}
+
+void Ppu::SetFrameBufferFormat(FrameBufferFormat format) {
+  if (format == frame_buffer_format_) {
+    return;
+  }
+  frame_buffer_format_ = format;
+  PresentLcd();
+}
+
+FrameBufferFormat Ppu::GetFrameBufferFormat() const {
+  return frame_buffer_format_;
+}
+
+void Ppu::SetColorCorrection(ColorCorrection profile) {
+  const bool rebuild = color_lut_.empty() || profile != color_correction_;
+  color_correction_ = profile;
+  if (!rebuild) {
+    return;
+  }
+
+  color_lut_.resize(kCgbNumColors);
+  BuildColorCorrectionLut(profile, std::span<Color, kCgbNumColors>(color_lut_.data(), kCgbNumColors));
+
+  for (size_t i = 0; i < cgb_regs_.bcpd.size(); i += 1) {
+    cgb_bg_palettes_[i / 4][i % 4] = color_lut_[cgb_regs_.bcpd[i].value & 0x7fff];
+    cgb_sprite_palettes_[i / 4][i % 4] = color_lut_[cgb_regs_.ocpd[i].value & 0x7fff];
+  }
+  debug_dirty_.palettes = true;
+}
+
+ColorCorrection Ppu::GetColorCorrection() const {
+  return color_correction_;
+}
+
 void Ppu::UpdatePalette(std::array<Color, 4> palette) {
   palette_ = std::move(palette);
+  MarkRenderTargetsDirty();
+  PresentLcd();
 }
 
 VramMemory& Ppu::Bank() {
@@ -1110,6 +1547,17 @@ void Ppu::StartGPDma() {
   spdlog::debug("GP DMA triggered: src={:04x}, dst={:04x}, len={:02x}", dma_state_.source, dma_state_.destination, dma_state_.length);
 }
 
+void Ppu::TransferDmaBlock(u16 size) {
+  std::array<u8, kHdmaBlockSize> block;
+  auto bytes = std::span{block}.first(size);
+  mmu_->ReadSpan(dma_state_.source, bytes);
+  dma_state_.source += size;
+
+  for (auto byte : bytes) {
+    WriteVram(dma_state_.destination++ & kVramIndexMask, byte);
+  }
+}
+
 void Ppu::StartHBlankDma() {
   dma_state_ = {
     .hdma = true,
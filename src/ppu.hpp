@@ -1,6 +1,10 @@
 #pragma once
 
 #include <array>
+#include <bitset>
+#include <memory>
+#include <span>
+#include <vector>
 #include <raylib.h>
 
 #include "types.hpp"
@@ -8,13 +12,41 @@
 #include "interrupt_device.hpp"
 #include "synced_device.hpp"
 #include "cpu_state.hpp"
+#include "color_correction.hpp"
 
 
 constexpr size_t kNumTiles = 384;
 constexpr size_t kVramNumBanks = 2;
 constexpr size_t kCgbNumPalettes = 8;
+constexpr size_t kTilemapSize = 1024;
+constexpr size_t kNumSprites = 40;
+constexpr size_t kNumScanlines = 154;
+constexpr u32 kDotsPerFrame = 70224;
+constexpr u32 kDotsPerSecond = 4194304;
+constexpr u16 kLCDWidth = 160;
+constexpr u16 kLCDHeight = 144;
+constexpr u8 kBlankPixel = 0xFF;
 
 using Palette = std::array<Color, 4>;
+using LcdPalette = std::array<Color, 2 * kCgbNumPalettes * 4>;
+
+enum class FrameBufferFormat : u8 {
+  kIndexed8,
+  kRgb565,
+  kRgba8888,
+};
+
+// DMG pixels hold the shade (0-3) after BGP/OBPx, CGB pixels hold
+// (palette << 2) | color with object palettes at 8-15, looked up in the
+// line's entry of palettes. kBlankPixel marks a cleared pixel.
+struct IndexedFrame {
+  std::array<u8, kLCDWidth * kLCDHeight> pixels;
+  std::array<u8, kLCDHeight> line_palettes;
+  std::vector<LcdPalette> palettes;
+  HardwareMode hardware_mode;
+};
+
+class PpuRenderThread;
 
 enum class PPUMode : u8 {
   HBlank = 0,
@@ -182,7 +214,7 @@ struct SpriteAttrs {
 struct OamMemory {
   union {
     std::array<u8, 160> bytes;
-    std::array<Sprite, 40> sprites;
+    std::array<Sprite, kNumSprites> sprites;
   };
 
   inline void Reset() {
@@ -195,7 +227,7 @@ struct VramMemory {
     std::array<u8, 8192> bytes;
     struct {
       std::array<std::array<u16, 8>, kNumTiles> tile_data;
-      std::array<std::array<u8, 1024>, 2> tile_map;
+      std::array<std::array<u8, kTilemapSize>, 2> tile_map;
     };
   };
 
@@ -233,6 +265,61 @@ struct DmaState {
   u16 destination;
 };
 
+struct RenderTargetFlags {
+  bool tiles;
+  bool tilemap1;
+  bool tilemap2;
+  bool sprites;
+  bool palettes;
+};
+
+struct TilemapOverlay {
+  bool visible;
+  bool window;
+  u8 x1;
+  u8 y1;
+  u8 x2;
+  u8 y2;
+
+  bool operator==(const TilemapOverlay&) const = default;
+};
+
+using VramBanks = std::array<VramMemory, kVramNumBanks>;
+
+struct PpuLineState {
+  PpuRegs regs;
+  u8 window_line;
+  HardwareMode hardware_mode;
+  u64 sprites;
+  std::array<Palette, kCgbNumPalettes> bg_palettes;
+  std::array<Palette, kCgbNumPalettes> sprite_palettes;
+};
+
+// What changed in the debug render targets since they were last drawn.
+struct RenderTargetDirty {
+  std::array<std::bitset<kNumTiles>, kVramNumBanks> tiles {};
+  std::array<std::bitset<kNumTiles>, 2> tilemap_tiles {};
+  std::array<std::bitset<kTilemapSize>, 2> tilemap_entries {};
+  bool sprites = false;
+  bool palettes = false;
+  bool clear = false;
+
+  RenderTargetDirty& operator|=(const RenderTargetDirty& other);
+};
+
+// The PPU state the debug render targets are drawn from, copied between
+// frames so they can be redrawn while the emulator keeps running.
+struct PpuDebugView {
+  VramBanks banks {};
+  OamMemory oam {};
+  PpuRegs regs {};
+  HardwareMode hardware_mode = HardwareMode::kDmgMode;
+  Palette dmg_palette {};
+  std::array<Palette, kCgbNumPalettes> bg_palettes {};
+  std::array<Palette, kCgbNumPalettes> sprite_palettes {};
+  RenderTargetDirty dirty {};
+};
+
 struct PpuConfig {
   Mmu* mmu;
   CpuState* state;
@@ -242,19 +329,32 @@ struct PpuConfig {
 
 class Ppu : public MmuDevice, public SyncedDevice {
 public:
+  Ppu();
+  ~Ppu();
+
   void Init(PpuConfig config);
   void Cleanup();
   void Step();
 
   void OnTick(bool double_speed) override;
+  [[nodiscard]] u32 IdleTicks(bool double_speed) const override;
+  void OnTicks(u32 m_cycles, bool double_speed) override;
 
   [[nodiscard]] bool IsValidFor(u16 addr) const override;
   void Write8(u16 addr, u8 byte) override;
   [[nodiscard]] u8 Read8(u16 addr) const override;
   void Reset() override;
 
+  [[nodiscard]] bool IsValidForRange(u16 first, u16 last) const override;
+  void ReadSpan(u16 addr, std::span<u8> dst) const override;
+  void WriteSpan(u16 addr, std::span<const u8> src) override;
+
   [[nodiscard]] PPUMode GetMode() const;
   [[nodiscard]] const Texture2D& GetTextureLcd() const;
+  [[nodiscard]] const IndexedFrame& GetLcdFrame() const;
+  void ExpandLcdFrame(std::span<Color> dst) const;
+  [[nodiscard]] const Palette& GetDmgPalette() const;
+  [[nodiscard]] u32 GetDotsSinceVBlank() const;
   [[nodiscard]] const RenderTexture2D& GetTextureTilemap1() const;
   [[nodiscard]] const RenderTexture2D& GetTextureTilemap2() const;
   [[nodiscard]] const RenderTexture2D& GetTextureSprites() const;
@@ -262,20 +362,75 @@ public:
   [[nodiscard]] const RenderTexture2D& GetTexturePalettes() const;
 
   void ClearTargetBuffers();
-  void UpdateRenderTargets();
+
+  // Copies the debug view and hands over the changes made since the last
+  // capture. Runs with the emulator, like everything above.
+  void CaptureDebugView(PpuDebugView& view);
+  // The render targets belong to the thread owning the GL context, which
+  // feeds every captured change in and then draws from the newest view
+  // without touching the emulated state.
+  void AddRenderTargetChanges(const RenderTargetDirty& dirty);
+  void UpdateRenderTargets(const PpuDebugView& view, RenderTargetFlags targets);
 
   void ResetFrameCount();
   size_t GetFrameCount() const;
 
+  void SetFrameSkip(u8 frame_skip);
+  u8 GetFrameSkip() const;
+
+  void SetThreadedRendering(bool enable);
+  bool IsThreadedRendering() const;
+
+  void SetFrameBufferFormat(FrameBufferFormat format);
+  FrameBufferFormat GetFrameBufferFormat() const;
+
+  void SetColorCorrection(ColorCorrection profile);
+  ColorCorrection GetColorCorrection() const;
+
+  static void DrawLcdRow(const PpuLineState& line, const VramBanks& banks, const OamMemory& oam, IndexedFrame& target);
+  static void ExpandIndexedFrame(const IndexedFrame& frame, const Palette& dmg_palette, std::span<Color> dst);
+
   void UpdatePalette(std::array<Color, 4> palette);
 
+  // With deferred presentation the PPU makes no GL calls while emulating;
+  // the present count changes whenever the front frame or palette does and
+  // the owner uploads frames itself through PresentFrame, which also
+  // reloads the LCD texture when the frame buffer format changed.
+  void SetDeferredPresent(bool deferred);
+  [[nodiscard]] u64 GetPresentCount() const;
+  void PresentFrame(const IndexedFrame& frame, const Palette& dmg_palette, FrameBufferFormat format);
+
+  // gameboy-doctor expects LY to always read 0x90.
+  void SetDoctorMode(bool enable);
+
 private:
   void SetMode(PPUMode mode);
-  void DrawLcdRow();
+  void StepMode();
+  [[nodiscard]] u16 GetDrawLength() const;
+  PpuLineState CaptureLine() const;
+  void AdvanceWindowLine();
   void SwapLcdTargets();
+  void PresentLcd();
+  void LoadLcdTargets();
+  void UnloadLcdTargets();
   void StartDma();
+  void FinishDma();
   void StartGPDma();
   void StartHBlankDma();
+  void TransferDmaBlock(u16 size);
+
+  void IndexSprite(size_t idx, u8 old_y, u8 new_y);
+  void RebuildSpriteIndex();
+
+  void WriteVram(u16 offset, u8 byte);
+  void MarkVramDirty(u8 bank, u16 offset);
+  void MarkOverlayDirty(u8 idx, const TilemapOverlay& overlay);
+  void MarkRenderTargetsDirty();
+  void UpdateTilesTarget(const PpuDebugView& view);
+  void UpdateTilemapTarget(const PpuDebugView& view, u8 idx);
+  void UpdateSpritesTarget(const PpuDebugView& view);
+  void UpdatePalettesTarget(const PpuDebugView& view);
+  static TilemapOverlay GetTilemapOverlay(const PpuRegs& regs, u8 idx, bool window);
 
   VramMemory& Bank();
   const VramMemory& Bank() const;
@@ -286,7 +441,11 @@ private:
   CpuState* state_ = nullptr;
   InterruptDevice* interrupts_ = nullptr;
   Texture2D target_lcd_front_ {};
-  Image target_lcd_back_ {};
+  Image target_lcd_image_ {};
+  IndexedFrame lcd_frame_back_ {};
+  IndexedFrame lcd_frame_front_ {};
+  FrameBufferFormat frame_buffer_format_ = FrameBufferFormat::kIndexed8;
+  FrameBufferFormat lcd_format_ = FrameBufferFormat::kIndexed8;
 
   RenderTexture2D target_tilemap1_ {};
   RenderTexture2D target_tilemap2_ {};
@@ -294,10 +453,20 @@ private:
   RenderTexture2D target_tiles_ {};
   RenderTexture2D target_palettes_ {};
 
-  std::array<VramMemory, kVramNumBanks> banks_ {};
+  // Collected while emulating, until the next CaptureDebugView.
+  RenderTargetDirty debug_dirty_ { .sprites = true, .palettes = true };
+  // Owned by the render target thread.
+  RenderTargetDirty target_dirty_ {};
+  std::array<std::array<TilemapOverlay, 2>, 2> tilemap_overlays_ {};
+  std::array<u8, 2> tilemap_tiledata_area_ { 0xff, 0xff };
+
+  VramBanks banks_ {};
   std::array<Palette, kCgbNumPalettes> cgb_bg_palettes_ {};
   std::array<Palette, kCgbNumPalettes> cgb_sprite_palettes_ {};
+  std::vector<Color> color_lut_ {};
+  ColorCorrection color_correction_ = ColorCorrection::kRaw;
   OamMemory oam_ {};
+  std::array<u64, kNumScanlines> line_sprites_ {};
   PpuRegs regs_ {};
   u8 vbk_ {};
   Palette palette_ {};
@@ -307,8 +476,17 @@ private:
   u8 opri_ {};
 
   size_t frame_count_ = 0;
+  u8 frame_skip_ = 0;
+  u8 skipped_frames_ = 0;
   u16 cycle_counter_ = 0;
+  u16 next_transition_ = 0;
+  u16 draw_length_ = 0;
+  u8 hblank_dma_counter_ = 0;
   u8 window_line_counter_ = 0;
-  bool log_doctor_ = false;
+  bool doctor_mode_ = false;
   u8 tick_counter_ = 0;
+  u64 present_count_ = 0;
+  bool deferred_present_ = false;
+
+  std::unique_ptr<PpuRenderThread> render_thread_ {};
 };
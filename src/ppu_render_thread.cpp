@@ -0,0 +1,131 @@
+#include <tracy/Tracy.hpp>
+
+#include "ppu_render_thread.hpp"
+
+
+namespace {
+  constexpr u16 kVramBankSize = sizeof(VramMemory);
+  constexpr u16 kOamWriteBase = kVramNumBanks * kVramBankSize;
+  constexpr size_t kLinesPerBatch = 16;
+}
+
+PpuRenderThread::~PpuRenderThread() {
+  Stop();
+}
+
+void PpuRenderThread::Start(IndexedFrame* target, const VramBanks& banks, const OamMemory& oam) {
+  Stop();
+
+  target_ = target;
+  banks_ = banks;
+  oam_ = oam;
+  running_ = true;
+  thread_ = std::thread(&PpuRenderThread::Run, this);
+}
+
+void PpuRenderThread::Stop() {
+  {
+    std::lock_guard lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  work_cv_.notify_one();
+  idle_cv_.notify_all();
+  thread_.join();
+
+  pending_writes_.clear();
+  queued_writes_.clear();
+  queued_lines_.clear();
+}
+
+void PpuRenderThread::Sync(const VramBanks& banks, const OamMemory& oam) {
+  WaitIdle();
+
+  banks_ = banks;
+  oam_ = oam;
+  pending_writes_.clear();
+}
+
+void PpuRenderThread::WaitIdle() {
+  ZoneScoped;
+
+  work_cv_.notify_one();
+
+  std::unique_lock lock(mutex_);
+  idle_cv_.wait(lock, [this] {
+    return !running_ || (queued_lines_.empty() && !busy_);
+  });
+}
+
+void PpuRenderThread::PushVramWrite(u8 bank, u16 offset, u8 byte) {
+  pending_writes_.push_back({ static_cast<u16>((bank * kVramBankSize) + offset), byte });
+}
+
+void PpuRenderThread::PushOamWrite(u8 offset, u8 byte) {
+  pending_writes_.push_back({ static_cast<u16>(kOamWriteBase + offset), byte });
+}
+
+void PpuRenderThread::SubmitLine(const PpuLineState& line) {
+  size_t num_lines = 0;
+  {
+    std::lock_guard lock(mutex_);
+    queued_writes_.insert(queued_writes_.end(), pending_writes_.begin(), pending_writes_.end());
+    queued_lines_.push_back({ line, queued_writes_.size() });
+    num_lines = queued_lines_.size();
+  }
+  pending_writes_.clear();
+
+  if (num_lines >= kLinesPerBatch) {
+    work_cv_.notify_one();
+  }
+}
+
+void PpuRenderThread::Apply(const MemoryWrite& write) {
+  if (write.addr >= kOamWriteBase) {
+    oam_.bytes[write.addr - kOamWriteBase] = write.byte;
+  } else {
+    banks_[write.addr / kVramBankSize].bytes[write.addr % kVramBankSize] = write.byte;
+  }
+}
+
+void PpuRenderThread::Run() {
+  std::vector<LineJob> lines {};
+  std::vector<MemoryWrite> writes {};
+
+  std::unique_lock lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] {
+      return !running_ || !queued_lines_.empty();
+    });
+    if (!running_) {
+      break;
+    }
+
+    std::swap(lines, queued_lines_);
+    std::swap(writes, queued_writes_);
+    busy_ = true;
+    lock.unlock();
+
+    {
+      ZoneScopedN("PpuRenderThread::Lines");
+
+      size_t applied = 0;
+      for (const auto& job : lines) {
+        for (; applied < job.writes_end; applied += 1) {
+          Apply(writes[applied]);
+        }
+        Ppu::DrawLcdRow(job.line, banks_, oam_, *target_);
+      }
+    }
+    lines.clear();
+    writes.clear();
+
+    lock.lock();
+    busy_ = false;
+    if (queued_lines_.empty()) {
+      idle_cv_.notify_all();
+    }
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <raylib.h>
+
+#include "types.hpp"
+#include "ppu.hpp"
+
+
+class PpuRenderThread {
+public:
+  ~PpuRenderThread();
+
+  void Start(IndexedFrame* target, const VramBanks& banks, const OamMemory& oam);
+  void Stop();
+  void Sync(const VramBanks& banks, const OamMemory& oam);
+  void WaitIdle();
+
+  void PushVramWrite(u8 bank, u16 offset, u8 byte);
+  void PushOamWrite(u8 offset, u8 byte);
+  void SubmitLine(const PpuLineState& line);
+
+private:
+  struct MemoryWrite {
+    u16 addr;
+    u8 byte;
+  };
+
+  struct LineJob {
+    PpuLineState line;
+    size_t writes_end;
+  };
+
+  void Run();
+  void Apply(const MemoryWrite& write);
+
+  IndexedFrame* target_ = nullptr;
+  VramBanks banks_ {};
+  OamMemory oam_ {};
+
+  std::vector<MemoryWrite> pending_writes_ {};
+  std::vector<MemoryWrite> queued_writes_ {};
+  std::vector<LineJob> queued_lines_ {};
+
+  std::mutex mutex_ {};
+  std::condition_variable work_cv_ {};
+  std::condition_variable idle_cv_ {};
+  std::thread thread_ {};
+  bool running_ = false;
+  bool busy_ = false;
+};
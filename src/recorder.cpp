@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <spdlog/spdlog.h>
+#include <tracy/Tracy.hpp>
+
+#include "recorder.hpp"
+
+
+namespace {
+  constexpr size_t kFileBufferSize = 1 << 20;
+  constexpr size_t kLumaSize = kLCDWidth * kLCDHeight;
+  constexpr size_t kChromaSize = (kLCDWidth / 2) * (kLCDHeight / 2);
+  constexpr u32 kWavHeaderSize = 44;
+  constexpr u16 kWavBitsPerSample = 16;
+}
+
+template <typename T>
+static void WriteLe(std::ofstream& file, T value) {
+  for (size_t i = 0; i < sizeof(T); i += 1) {
+    file.put(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+// Full range BT.601 (JFIF) RGB to 4:2:0, chroma averaged over each 2x2 block.
+static void ConvertToYuv420(std::span<const Color> rgba, std::span<u8> yuv) {
+  auto* luma = yuv.data();
+  auto* cb = luma + kLumaSize;
+  auto* cr = cb + kChromaSize;
+
+  for (size_t i = 0; i < kLumaSize; i += 1) {
+    const auto& c = rgba[i];
+    luma[i] = static_cast<u8>((77 * c.r + 150 * c.g + 29 * c.b + 128) >> 8);
+  }
+
+  for (size_t y = 0; y < kLCDHeight; y += 2) {
+    const auto* row0 = rgba.data() + y * kLCDWidth;
+    const auto* row1 = row0 + kLCDWidth;
+    for (size_t x = 0; x < kLCDWidth; x += 2) {
+      const int r = row0[x].r + row0[x + 1].r + row1[x].r + row1[x + 1].r;
+      const int g = row0[x].g + row0[x + 1].g + row1[x].g + row1[x + 1].g;
+      const int b = row0[x].b + row0[x + 1].b + row1[x].b + row1[x + 1].b;
+      const size_t idx = (y / 2) * (kLCDWidth / 2) + x / 2;
+      cb[idx] = static_cast<u8>(std::clamp(((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128, 0, 255));
+      cr[idx] = static_cast<u8>(std::clamp(((128 * r - 107 * g - 21 * b + 512) >> 10) + 128, 0, 255));
+    }
+  }
+}
+
+Recorder::~Recorder() {
+  Stop();
+}
+
+RecorderResult Recorder::Start(std::string_view path, RecorderConfig cfg, u64 start_timestamp, u32 audio_offset) {
+  Stop();
+
+  if (cfg.queue_size == 0) {
+    return std::unexpected{"Recording queue needs at least one frame"};
+  }
+
+  config_ = cfg;
+  start_timestamp_ = start_timestamp;
+
+  const auto video_path = std::format("{}.y4m", path);
+  const auto audio_path = std::format("{}.wav", path);
+
+  video_buffer_.resize(kFileBufferSize);
+  audio_buffer_.resize(kFileBufferSize);
+  video_ = std::ofstream{};
+  audio_ = std::ofstream{};
+  video_.rdbuf()->pubsetbuf(video_buffer_.data(), video_buffer_.size());
+  audio_.rdbuf()->pubsetbuf(audio_buffer_.data(), audio_buffer_.size());
+
+  video_.open(video_path, std::ios::binary | std::ios::trunc);
+  if (!video_) {
+    return std::unexpected{std::format("Failed to open '{}' for writing", video_path)};
+  }
+  audio_.open(audio_path, std::ios::binary | std::ios::trunc);
+  if (!audio_) {
+    video_.close();
+    return std::unexpected{std::format("Failed to open '{}' for writing", audio_path)};
+  }
+
+  // The frame rate is exactly one LCD frame of DMG dots.
+  video_ << std::format("YUV4MPEG2 W{} H{} F{}:{} Ip A1:1 C420jpeg\n", kLCDWidth, kLCDHeight, kDotsPerSecond, kDotsPerFrame);
+  WriteWavHeader(0);
+
+  frames_written_ = 0;
+  audio_bytes_ = 0;
+  have_yuv_ = false;
+  rgba_.resize(kLumaSize);
+  yuv_.resize(kLumaSize + 2 * kChromaSize);
+
+  // Audio capture starts part way into the current frame; pad it so both
+  // streams start at the same emulated time.
+  const std::vector<float> silence(audio_offset - audio_offset % config_.num_channels, 0.0f);
+  WriteSamples(silence);
+
+  slots_.clear();
+  free_slots_.clear();
+  queued_frames_.clear();
+  queued_samples_.clear();
+  for (size_t i = 0; i < config_.queue_size; i += 1) {
+    slots_.push_back(std::make_unique<FrameSlot>());
+    free_slots_.push_back(slots_.back().get());
+  }
+  dropped_frames_ = 0;
+
+  running_ = true;
+  thread_ = std::thread(&Recorder::Run, this);
+
+  spdlog::info("Recording to '{}' and '{}'", video_path, audio_path);
+  return {};
+}
+
+void Recorder::Stop() {
+  {
+    std::lock_guard lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  work_cv_.notify_one();
+  free_cv_.notify_all();
+  thread_.join();
+
+  WriteWavHeader(static_cast<u32>(audio_bytes_));
+  video_.close();
+  audio_.close();
+
+  spdlog::info("Recording stopped: {} frames written, {} dropped", frames_written_, dropped_frames_);
+}
+
+bool Recorder::IsRecording() const {
+  std::lock_guard lock(mutex_);
+  return running_;
+}
+
+size_t Recorder::GetDroppedFrames() const {
+  std::lock_guard lock(mutex_);
+  return dropped_frames_;
+}
+
+void Recorder::PushFrame(const IndexedFrame& frame, const Palette& dmg_palette, u64 timestamp) {
+  ZoneScoped;
+
+  FrameSlot* slot = nullptr;
+  {
+    std::unique_lock lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    if (free_slots_.empty()) {
+      if (config_.policy == RecordQueuePolicy::kDropFrames) {
+        dropped_frames_ += 1;
+        return;
+      }
+      free_cv_.wait(lock, [this] {
+        return !running_ || !free_slots_.empty();
+      });
+      if (!running_) {
+        return;
+      }
+    }
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+
+  slot->frame = frame;
+  slot->dmg_palette = dmg_palette;
+  slot->timestamp = timestamp;
+
+  {
+    std::lock_guard lock(mutex_);
+    queued_frames_.push_back(slot);
+  }
+  work_cv_.notify_one();
+}
+
+void Recorder::PushSamples(std::span<const float> samples) {
+  if (samples.empty()) {
+    return;
+  }
+  {
+    std::lock_guard lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    queued_samples_.insert(queued_samples_.end(), samples.begin(), samples.end());
+  }
+  work_cv_.notify_one();
+}
+
+void Recorder::Run() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] {
+      return !running_ || !queued_frames_.empty() || !queued_samples_.empty();
+    });
+    if (queued_frames_.empty() && queued_samples_.empty()) {
+      break;
+    }
+
+    writing_samples_.swap(queued_samples_);
+    FrameSlot* slot = nullptr;
+    if (!queued_frames_.empty()) {
+      slot = queued_frames_.front();
+      queued_frames_.pop_front();
+    }
+    lock.unlock();
+
+    WriteSamples(writing_samples_);
+    writing_samples_.clear();
+    if (slot) {
+      WriteFrame(*slot);
+    }
+
+    lock.lock();
+    if (slot) {
+      free_slots_.push_back(slot);
+      free_cv_.notify_one();
+    }
+  }
+}
+
+void Recorder::WriteFrame(const FrameSlot& slot) {
+  ZoneScoped;
+
+  const u64 elapsed = slot.timestamp > start_timestamp_ ? slot.timestamp - start_timestamp_ : 0;
+  const u64 index = (elapsed + kDotsPerFrame / 2) / kDotsPerFrame;
+  if (have_yuv_ && index < frames_written_) {
+    return;
+  }
+
+  auto write_yuv = [this] {
+    video_ << "FRAME\n";
+    video_.write(reinterpret_cast<const char*>(yuv_.data()), static_cast<std::streamsize>(yuv_.size()));
+    frames_written_ += 1;
+  };
+
+  // Frames the emulator skipped or dropped repeat the last one so the video
+  // keeps its place against the audio.
+  if (have_yuv_) {
+    while (frames_written_ < index) {
+      write_yuv();
+    }
+  }
+
+  Ppu::ExpandIndexedFrame(slot.frame, slot.dmg_palette, rgba_);
+  ConvertToYuv420(rgba_, yuv_);
+
+  do {
+    write_yuv();
+  } while (frames_written_ <= index);
+  have_yuv_ = true;
+}
+
+void Recorder::WriteSamples(std::span<const float> samples) {
+  for (auto sample : samples) {
+    const auto value = static_cast<i16>(std::lround(std::clamp(sample, -1.0f, 1.0f) * 32767.0f));
+    WriteLe(audio_, static_cast<u16>(value));
+  }
+  audio_bytes_ += samples.size() * sizeof(i16);
+}
+
+void Recorder::WriteWavHeader(u32 data_size) {
+  const u32 block_align = config_.num_channels * kWavBitsPerSample / 8;
+
+  audio_.seekp(0);
+  audio_.write("RIFF", 4);
+  WriteLe<u32>(audio_, kWavHeaderSize - 8 + data_size);
+  audio_.write("WAVE", 4);
+  audio_.write("fmt ", 4);
+  WriteLe<u32>(audio_, 16);
+  WriteLe<u16>(audio_, 1);
+  WriteLe<u16>(audio_, static_cast<u16>(config_.num_channels));
+  WriteLe<u32>(audio_, config_.sample_rate);
+  WriteLe<u32>(audio_, config_.sample_rate * block_align);
+  WriteLe<u16>(audio_, static_cast<u16>(block_align));
+  WriteLe<u16>(audio_, kWavBitsPerSample);
+  audio_.write("data", 4);
+  WriteLe<u32>(audio_, data_size);
+  audio_.seekp(0, std::ios::end);
+}
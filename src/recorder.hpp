@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <expected>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+#include "ppu.hpp"
+
+
+enum class RecordQueuePolicy : u8 {
+  kDropFrames,
+  kBlock,
+};
+
+struct RecorderConfig {
+  u32 sample_rate;
+  u32 num_channels;
+  size_t queue_size = 8;
+  RecordQueuePolicy policy = RecordQueuePolicy::kDropFrames;
+};
+
+using RecorderResult = std::expected<void, std::string>;
+
+// Streams LCD frames to <path>.y4m and PCM to <path>.wav. The emulation thread
+// only copies the indexed frame into a pooled slot and queues it; palette
+// expansion, YUV conversion and file I/O happen on the writer thread.
+//
+// Frames are placed by their emulated timestamp (in DMG dots, 4194304/s), so
+// frames skipped during fast-forward are filled with repeats and the video
+// stays in step with the audio, which is produced at the emulated rate.
+class Recorder {
+public:
+  ~Recorder();
+
+  RecorderResult Start(std::string_view path, RecorderConfig cfg, u64 start_timestamp, u32 audio_offset);
+  void Stop();
+  [[nodiscard]] bool IsRecording() const;
+  [[nodiscard]] size_t GetDroppedFrames() const;
+
+  void PushFrame(const IndexedFrame& frame, const Palette& dmg_palette, u64 timestamp);
+  void PushSamples(std::span<const float> samples);
+
+private:
+  struct FrameSlot {
+    IndexedFrame frame;
+    Palette dmg_palette;
+    u64 timestamp;
+  };
+
+  void Run();
+  void WriteFrame(const FrameSlot& slot);
+  void WriteSamples(std::span<const float> samples);
+  void WriteWavHeader(u32 data_size);
+
+  RecorderConfig config_ {};
+  u64 start_timestamp_ = 0;
+
+  std::ofstream video_ {};
+  std::ofstream audio_ {};
+  std::vector<char> video_buffer_ {};
+  std::vector<char> audio_buffer_ {};
+  u64 frames_written_ = 0;
+  u64 audio_bytes_ = 0;
+
+  std::vector<Color> rgba_ {};
+  std::vector<u8> yuv_ {};
+  bool have_yuv_ = false;
+
+  std::vector<std::unique_ptr<FrameSlot>> slots_ {};
+  std::vector<FrameSlot*> free_slots_ {};
+  std::deque<FrameSlot*> queued_frames_ {};
+  std::vector<float> queued_samples_ {};
+  std::vector<float> writing_samples_ {};
+  size_t dropped_frames_ = 0;
+
+  mutable std::mutex mutex_ {};
+  std::condition_variable work_cv_ {};
+  std::condition_variable free_cv_ {};
+  std::thread thread_ {};
+  bool running_ = false;
+};
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <format>
 #include <cstdint>
 #include <ranges>
@@ -36,66 +37,206 @@ enum class Reg16 {
   HL = 6,
 };
 
+// The ALU operations whose flags are computed on demand.
+enum class FlagOp : u8 {
+  kNone,
+  // Z, N, H and C of a + b + carry.
+  kAdd8,
+  // Z, N, H and C of a - b - carry.
+  kSub8,
+  // Z, N and H of a + 1, C is kept.
+  kInc8,
+  // Z, N and H of a - 1, C is kept.
+  kDec8,
+  // N, H and C of a + b, Z is kept.
+  kAdd16,
+  // Z of the result, H set.
+  kAnd,
+  // Z of the result, for OR and XOR.
+  kOr,
+};
+
+// Operands and result of the last flag-setting ALU operation. Most flags are
+// overwritten before anything reads them, so F is only computed when read.
+struct LazyFlags {
+  FlagOp op = FlagOp::kNone;
+  u8 carry = 0;
+  u16 a = 0;
+  u16 b = 0;
+  // Wide enough for the carry out, subtractions that borrow wrap around.
+  u32 result = 0;
+};
+
+constexpr u8 kFlagZ = 1 << std::to_underlying(Flag::Z);
+constexpr u8 kFlagN = 1 << std::to_underlying(Flag::N);
+constexpr u8 kFlagH = 1 << std::to_underlying(Flag::H);
+constexpr u8 kFlagC = 1 << std::to_underlying(Flag::C);
+constexpr u8 kFlagMask = kFlagZ | kFlagN | kFlagH | kFlagC;
+
+// Every register pair is stored as the two bytes of a native 16-bit word and
+// read or written whole through std::bit_cast, which compiles to a single load
+// or store. On a little-endian host the high half comes second, so Reg8 index
+// i lives at byte (i & 1) ^ 1 of pair i / 2.
+static_assert(std::endian::native == std::endian::little, "Registers assume a little-endian host");
+
 struct Registers {
-  std::array<u8, std::to_underlying(Reg8::Count)> vals {};
+  using Pair = std::array<u8, 2>;
+
+  std::array<Pair, 4> pairs {};
   u16 pc {};
   u16 sp {};
+  LazyFlags lazy {};
 
-  u8& At(Reg8 reg) {
-    ZoneScoped;
-    return vals[std::to_underlying(reg)];
+  constexpr u8& At(Reg8 reg) {
+    if (reg == Reg8::F) {
+      ResolveFlags();
+    }
+    return Byte(reg);
   }
 
-  [[nodiscard]] u8 Get(Reg8 reg) const {
-    ZoneScoped;
-    return vals[std::to_underlying(reg)];
+  [[nodiscard]] constexpr u8 Get(Reg8 reg) const {
+    return reg == Reg8::F ? Flags() : Byte(reg);
   }
 
-  void Set(Reg8 reg, u8 val) {
-    ZoneScoped;
-    vals[std::to_underlying(reg)] = val & (reg == Reg8::F ? 0xf0 : 0xff);
+  constexpr void Set(Reg8 reg, u8 val) {
+    if (reg == Reg8::F) {
+      lazy.op = FlagOp::kNone;
+      val &= kFlagMask;
+    }
+    Byte(reg) = val;
   }
 
-  [[nodiscard]] u16 Get(Reg16 reg) const {
-    ZoneScoped;
-    int idx = std::to_underlying(reg);
-    return (vals[idx] << 8) | vals[idx + 1];
+  [[nodiscard]] constexpr u16 Get(Reg16 reg) const {
+    if (reg == Reg16::AF) {
+      return (Get(Reg8::A) << 8) | Flags();
+    }
+    return std::bit_cast<u16>(pairs[PairIndex(reg)]);
   }
 
-  void Set(Reg16 reg, u16 val) {
-    ZoneScoped;
-    int idx = std::to_underlying(reg);
-    vals[idx] = val >> 8;
-    vals[idx + 1] = val & (reg == Reg16::AF ? 0xf0 : 0xff);
+  constexpr void Set(Reg16 reg, u16 val) {
+    if (reg == Reg16::AF) {
+      lazy.op = FlagOp::kNone;
+      val &= 0xff00 | kFlagMask;
+    }
+    pairs[PairIndex(reg)] = std::bit_cast<Pair>(val);
   }
 
-  [[nodiscard]] u8 Get(Flag flag) const {
-    ZoneScoped;
-    return (vals[std::to_underlying(Reg8::F)] >> std::to_underlying(flag)) & 1;
+  [[nodiscard]] constexpr u8 Get(Flag flag) const {
+    // Conditional branches only look at Z or C, those skip the rest of F.
+    if (lazy.op != FlagOp::kNone && lazy.op != FlagOp::kAdd16 && flag == Flag::Z) {
+      return (lazy.result & 0xff) == 0;
+    }
+    if (lazy.op == FlagOp::kAdd8 || lazy.op == FlagOp::kSub8) {
+      if (flag == Flag::C) {
+        return lazy.result > 0xff;
+      }
+    }
+    return (Flags() >> std::to_underlying(flag)) & 1;
   }
 
-  void Set(Flag flag, u8 bit) {
-    ZoneScoped;
-    auto& val = vals[std::to_underlying(Reg8::F)];
+  constexpr void Set(Flag flag, u8 bit) {
+    ResolveFlags();
+    auto& val = Byte(Reg8::F);
     val = (val & ~(1 << std::to_underlying(flag))) | ((bit & 1) << std::to_underlying(flag));
   }
 
-  void SetFlags(u8 flag_bits) {
-    ZoneScoped;
-    auto& val = vals[std::to_underlying(Reg8::F)];
-    val = (flag_bits & 0xf) << 4;
+  constexpr void SetFlags(u8 flag_bits) {
+    lazy.op = FlagOp::kNone;
+    Byte(Reg8::F) = (flag_bits & 0xf) << 4;
   }
 
-  void Reset() {
-    ZoneScoped;
-    vals.fill(0);
+  // Records an ALU operation in place of its flags.
+  constexpr void SetFlags(FlagOp op, u32 result, u16 a = 0, u16 b = 0, u8 carry = 0) {
+    // Operations that keep a flag take it from the one before, the rest of F
+    // is theirs.
+    if (op == FlagOp::kInc8 || op == FlagOp::kDec8) {
+      Byte(Reg8::F) = Get(Flag::C) ? kFlagC : 0;
+    } else if (op == FlagOp::kAdd16) {
+      Byte(Reg8::F) = Get(Flag::Z) ? kFlagZ : 0;
+    }
+    lazy = {op, carry, a, b, result};
+  }
+
+  constexpr void ResolveFlags() {
+    if (lazy.op != FlagOp::kNone) {
+      Byte(Reg8::F) = Flags();
+      lazy.op = FlagOp::kNone;
+    }
+  }
+
+  [[nodiscard]] constexpr u8 Flags() const {
+    const u8 f = Byte(Reg8::F);
+    const u16 a = lazy.a;
+    const u16 b = lazy.b;
+    const u8 zero = (lazy.result & 0xff) == 0 ? kFlagZ : 0;
+
+    switch (lazy.op) {
+    case FlagOp::kNone:
+      return f;
+    case FlagOp::kAdd8:
+      return zero
+        | ((a & 0xf) + (b & 0xf) + lazy.carry > 0xf ? kFlagH : 0)
+        | (lazy.result > 0xff ? kFlagC : 0);
+    case FlagOp::kSub8:
+      return zero | kFlagN
+        | ((a & 0xf) < (b & 0xf) + lazy.carry ? kFlagH : 0)
+        | (lazy.result > 0xff ? kFlagC : 0);
+    case FlagOp::kInc8:
+      return zero | ((a & 0xf) == 0xf ? kFlagH : 0) | (f & kFlagC);
+    case FlagOp::kDec8:
+      return zero | kFlagN | ((a & 0xf) == 0 ? kFlagH : 0) | (f & kFlagC);
+    case FlagOp::kAdd16:
+      return (f & kFlagZ)
+        | ((a & 0xfff) + (b & 0xfff) > 0xfff ? kFlagH : 0)
+        | (lazy.result > 0xffff ? kFlagC : 0);
+    case FlagOp::kAnd:
+      return zero | kFlagH;
+    case FlagOp::kOr:
+      return zero;
+    default:
+      std::unreachable();
+    }
+  }
+
+  constexpr void Reset() {
+    pairs.fill({});
+    lazy = {};
     sp = 0;
     pc = 0;
   }
+
+private:
+  constexpr u8& Byte(Reg8 reg) {
+    return pairs[std::to_underlying(reg) >> 1][(std::to_underlying(reg) & 1) ^ 1];
+  }
+
+  [[nodiscard]] constexpr const u8& Byte(Reg8 reg) const {
+    return pairs[std::to_underlying(reg) >> 1][(std::to_underlying(reg) & 1) ^ 1];
+  }
+
+  static constexpr size_t PairIndex(Reg16 reg) {
+    return std::to_underlying(reg) >> 1;
+  }
 };
 
+static_assert([] {
+  Registers regs;
+  regs.Set(Reg16::BC, 0x1234);
+  regs.Set(Reg8::A, 0xab);
+  regs.Set(Reg8::F, 0xff);
+  regs.At(Reg8::L) = 0x56;
+  regs.SetFlags(FlagOp::kAdd8, 0x100, 0x80, 0x80);
+  return regs.Get(Reg8::B) == 0x12 && regs.Get(Reg8::C) == 0x34 && regs.Get(Reg16::HL) == 0x0056
+    && regs.Get(Reg16::AF) == 0xab90 && regs.Get(Flag::C) && !regs.Get(Flag::N);
+}(), "Registers must be usable in constant expressions");
+
 inline bool operator==(const Registers& r1, const Registers& r2) {
-  return std::ranges::equal(r1.vals, r2.vals) && r1.sp == r2.sp && r1.pc == r2.pc;
+  for (int i = 0; i < std::to_underlying(Reg8::Count); i += 1) {
+    if (r1.Get(Reg8{i}) != r2.Get(Reg8{i})) {
+      return false;
+    }
+  }
+  return r1.sp == r2.sp && r1.pc == r2.pc;
 }
 
 template <>
@@ -0,0 +1,112 @@
+#include <raylib.h>
+#include <spdlog/spdlog.h>
+#include <tracy/Tracy.hpp>
+
+#include "screenshot.hpp"
+
+
+ScreenshotEncoder::~ScreenshotEncoder() {
+  Stop();
+}
+
+void ScreenshotEncoder::Submit(std::string path, const IndexedFrame& frame, const Palette& dmg_palette, ScreenshotOptions options) {
+  ZoneScoped;
+
+  std::unique_ptr<Job> job;
+  {
+    std::lock_guard lock(mutex_);
+    if (!free_jobs_.empty()) {
+      job = std::move(free_jobs_.back());
+      free_jobs_.pop_back();
+    }
+  }
+  if (!job) {
+    job = std::make_unique<Job>();
+  }
+
+  job->path = std::move(path);
+  job->frame = frame;
+  job->dmg_palette = dmg_palette;
+  job->options = options;
+
+  {
+    std::lock_guard lock(mutex_);
+    queued_jobs_.push_back(std::move(job));
+    pending_ += 1;
+    if (!running_) {
+      running_ = true;
+      thread_ = std::thread(&ScreenshotEncoder::Run, this);
+    }
+  }
+  work_cv_.notify_one();
+}
+
+void ScreenshotEncoder::Stop() {
+  {
+    std::lock_guard lock(mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  work_cv_.notify_one();
+  thread_.join();
+}
+
+size_t ScreenshotEncoder::GetPending() const {
+  std::lock_guard lock(mutex_);
+  return pending_;
+}
+
+void ScreenshotEncoder::Run() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    work_cv_.wait(lock, [this] {
+      return !running_ || !queued_jobs_.empty();
+    });
+    if (queued_jobs_.empty()) {
+      break;
+    }
+
+    auto job = std::move(queued_jobs_.front());
+    queued_jobs_.pop_front();
+    lock.unlock();
+
+    Encode(*job);
+
+    lock.lock();
+    free_jobs_.push_back(std::move(job));
+    pending_ -= 1;
+  }
+}
+
+void ScreenshotEncoder::Encode(const Job& job) {
+  ZoneScoped;
+
+  pixels_.resize(kLCDWidth * kLCDHeight);
+  Ppu::ExpandIndexedFrame(job.frame, job.dmg_palette, pixels_);
+
+  Image image {
+    .data = pixels_.data(),
+    .width = kLCDWidth,
+    .height = kLCDHeight,
+    .mipmaps = 1,
+    .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+  };
+
+  if (job.options.scale > 1) {
+    if (auto result = upscaler::Upscale(job.options.filter, job.options.scale, pixels_, kLCDWidth, kLCDHeight, upscaled_); !result) {
+      spdlog::warn("Screenshot '{}' saved without upscaling: {}", job.path, result.error());
+    } else {
+      image.data = upscaled_.pixels.data();
+      image.width = upscaled_.width;
+      image.height = upscaled_.height;
+    }
+  }
+
+  if (!ExportImage(image, job.path.c_str())) {
+    spdlog::error("Failed to write screenshot '{}'", job.path);
+    return;
+  }
+  spdlog::debug("Saved screenshot '{}'", job.path);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+#include "ppu.hpp"
+#include "upscaler.hpp"
+
+
+struct ScreenshotOptions {
+  upscaler::Filter filter = upscaler::Filter::kNearest;
+  int scale = 1;
+};
+
+// Encodes LCD frames to PNG on a background thread. Submitting only copies the
+// indexed frame; expansion, upscaling and compression run on the worker.
+class ScreenshotEncoder {
+public:
+  ~ScreenshotEncoder();
+
+  void Submit(std::string path, const IndexedFrame& frame, const Palette& dmg_palette, ScreenshotOptions options);
+  // Blocks until every submitted screenshot has been written.
+  void Stop();
+  [[nodiscard]] size_t GetPending() const;
+
+private:
+  struct Job {
+    std::string path;
+    IndexedFrame frame;
+    Palette dmg_palette;
+    ScreenshotOptions options;
+  };
+
+  void Run();
+  void Encode(const Job& job);
+
+  std::vector<std::unique_ptr<Job>> free_jobs_ {};
+  std::deque<std::unique_ptr<Job>> queued_jobs_ {};
+  size_t pending_ = 0;
+
+  std::vector<Color> pixels_ {};
+  upscaler::Frame upscaled_ {};
+
+  mutable std::mutex mutex_ {};
+  std::condition_variable work_cv_ {};
+  std::thread thread_ {};
+  bool running_ = false;
+};
@@ -4,6 +4,12 @@
 #include "serial_device.hpp"
 #include "io.hpp"
 
+namespace {
+
+// Cycles of clock_ per shifted bit with the internal clock.
+constexpr u16 kSerialBitCycles = 512;
+
+}
 
 void SerialDevice::Init(SerialDeviceConfig cfg) {
   interrupts_ = cfg.interrupts;
@@ -51,6 +57,19 @@ void SerialDevice::OnTick(bool double_speed) {
   Step();
 }
 
+// A transfer shifts a bit every 512 cycles of clock_, the tick that
+// reaches the next multiple is the first one doing anything.
+u32 SerialDevice::IdleTicks(bool double_speed) const {
+  if (!sc_.transfer_enable || !transfer_bytes_) {
+    return kIdleForever;
+  }
+  return (kSerialBitCycles - 4 - clock_ % kSerialBitCycles) / 4;
+}
+
+void SerialDevice::OnTicks(u32 m_cycles, bool double_speed) {
+  clock_ += 4 * m_cycles;
+}
+
 std::string_view SerialDevice::LineBuffer() const {
   return str_buffer_;
 }
@@ -72,12 +91,12 @@ void SerialDevice::Step() {
     return;
   }
 
-  if (clock_ % 512 != 0) {
+  if (clock_ % kSerialBitCycles != 0) {
     return;
   }
 
-  while (clock_ >= 512) {
-    clock_ -= 512;
+  while (clock_ >= kSerialBitCycles) {
+    clock_ -= kSerialBitCycles;
     TransferByte();
   }
 }
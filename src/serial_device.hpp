@@ -25,6 +25,8 @@ public:
 
   void Step();
   void OnTick(bool double_speed) override;
+  [[nodiscard]] u32 IdleTicks(bool double_speed) const override;
+  void OnTicks(u32 m_cycles, bool double_speed) override;
   void TriggerCallbacks();
 
   std::string_view LineBuffer() const;
@@ -0,0 +1,212 @@
+// Reference reader for the shared memory export (see shm_layout.hpp). Waits for
+// frames, validates them against their sequence counter, drains the audio ring
+// and prints throughput once a second. Optionally writes the last frame as PPM.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <argparse/argparse.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "shm_layout.hpp"
+
+
+namespace {
+  constexpr auto kWaitTimeout = std::chrono::milliseconds(100);
+  constexpr auto kReportInterval = std::chrono::seconds(1);
+}
+
+struct Stats {
+  u64 frames = 0;
+  u64 torn = 0;
+  u64 dropped = 0;
+  u64 samples = 0;
+  u64 audio_overruns = 0;
+  u64 last_hash = 0;
+  float peak = 0.0f;
+};
+
+static void WaitForFrame(shm::ShmHeader* header, u32 signal) {
+#if defined(__linux__)
+  timespec timeout{
+    .tv_sec = 0,
+    .tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(kWaitTimeout).count(),
+  };
+  header->waiters.fetch_add(1, std::memory_order_acq_rel);
+  syscall(SYS_futex, &header->frame_signal, FUTEX_WAIT, signal, &timeout, nullptr, 0);
+  header->waiters.fetch_sub(1, std::memory_order_acq_rel);
+#else
+  (void)header;
+  (void)signal;
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+}
+
+static u64 HashPixels(const u32* pixels, size_t count) {
+  u64 hash = 0xcbf29ce484222325;
+  for (size_t i = 0; i < count; i += 1) {
+    hash = (hash ^ pixels[i]) * 0x100000001b3;
+  }
+  return hash;
+}
+
+static void WritePpm(const std::string& path, const std::vector<u32>& pixels, u32 width, u32 height) {
+  std::ofstream file(path, std::ios::binary);
+  file << std::format("P6\n{} {}\n255\n", width, height);
+  for (auto pixel : pixels) {
+    const char rgb[3] = {
+      static_cast<char>(pixel & 0xff),
+      static_cast<char>((pixel >> 8) & 0xff),
+      static_cast<char>((pixel >> 16) & 0xff),
+    };
+    file.write(rgb, sizeof(rgb));
+  }
+}
+
+auto main(int argc, char* argv[]) -> int {
+  argparse::ArgumentParser program("shm-consumer");
+  program.add_argument("--name")
+    .help("Shared memory object to attach to")
+    .default_value(std::string{shm::kDefaultName});
+  program.add_argument("--frames")
+    .help("Exit after this many frames (0 runs until the exporter closes)")
+    .default_value(0)
+    .scan<'i', int>();
+  program.add_argument("--ppm")
+    .help("Write the last received frame to this file")
+    .default_value(std::string{});
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << "\n" << program;
+    return 1;
+  }
+
+  const auto name = program.get<std::string>("--name");
+  const auto max_frames = static_cast<u64>(program.get<int>("--frames"));
+  const auto ppm_path = program.get<std::string>("--ppm");
+
+  // Mapped writable only for the futex waiter count; nothing else is written.
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    std::cerr << std::format("Failed to open '{}': {}\n", name, std::strerror(errno));
+    return 1;
+  }
+  struct stat st {};
+  fstat(fd, &st);
+  void* data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    std::cerr << std::format("Failed to map '{}': {}\n", name, std::strerror(errno));
+    return 1;
+  }
+
+  auto* header = static_cast<shm::ShmHeader*>(data);
+  if (std::atomic_ref<u32>(header->magic).load(std::memory_order_acquire) != shm::kMagic || header->version != shm::kVersion) {
+    std::cerr << "Shared memory region is not an ace-gb export\n";
+    return 1;
+  }
+  if (static_cast<size_t>(st.st_size) < shm::RegionSize(header->num_frames, header->audio_capacity)) {
+    std::cerr << "Shared memory region is truncated\n";
+    return 1;
+  }
+
+  std::cout << std::format("Attached to '{}': {}x{}, {} frame slots, {} Hz x{}\n",
+                           name, header->width, header->height, header->num_frames, header->sample_rate, header->num_channels);
+
+  auto* frames = shm::Frames(header);
+  const auto* audio = shm::Audio(header);
+  const size_t pixel_count = header->width * header->height;
+  const u64 audio_mask = header->audio_capacity - 1;
+
+  std::vector<u32> last_frame(pixel_count);
+  u64 read_frames = header->frames_written.load(std::memory_order_acquire);
+  u64 audio_pos = header->audio_write_pos.load(std::memory_order_acquire);
+  Stats stats {};
+  Stats reported {};
+  auto next_report = std::chrono::steady_clock::now() + kReportInterval;
+
+  while (max_frames == 0 || stats.frames < max_frames) {
+    if (std::atomic_ref<u32>(header->magic).load(std::memory_order_acquire) != shm::kMagic) {
+      std::cout << "Exporter closed\n";
+      break;
+    }
+
+    const u32 signal = header->frame_signal.load(std::memory_order_acquire);
+    const u64 written = header->frames_written.load(std::memory_order_acquire);
+    if (written == read_frames) {
+      WaitForFrame(header, signal);
+    } else {
+      // Only the newest frame is read, anything published in between is skipped.
+      if (written - read_frames > 1) {
+        stats.dropped += written - read_frames - 1;
+      }
+      read_frames = written;
+
+      // Read the newest frame in place and copy it out only after the
+      // sequence check proves it was not overwritten meanwhile.
+      auto& slot = frames[(written - 1) % header->num_frames];
+      const u64 before = slot.sequence.load(std::memory_order_acquire);
+      const u64 hash = HashPixels(slot.pixels, pixel_count);
+      if (!ppm_path.empty()) {
+        std::memcpy(last_frame.data(), slot.pixels, pixel_count * sizeof(u32));
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const u64 after = slot.sequence.load(std::memory_order_relaxed);
+      if (before != after || before != 2 * written) {
+        stats.torn += 1;
+      } else {
+        stats.frames += 1;
+        stats.last_hash = hash;
+      }
+    }
+
+    const u64 audio_write = header->audio_write_pos.load(std::memory_order_acquire);
+    if (audio_write - audio_pos > header->audio_capacity) {
+      stats.audio_overruns += 1;
+      audio_pos = audio_write - header->audio_capacity;
+    }
+    for (; audio_pos < audio_write; audio_pos += 1) {
+      stats.peak = std::max(stats.peak, std::abs(audio[audio_pos & audio_mask]));
+      stats.samples += 1;
+    }
+
+    if (const auto now = std::chrono::steady_clock::now(); now >= next_report) {
+      std::cout << std::format("frames={} torn={} dropped={} samples={} audio_overruns={} peak={:.3f} hash={:016x}\n",
+                               stats.frames - reported.frames, stats.torn - reported.torn, stats.dropped - reported.dropped,
+                               stats.samples - reported.samples, stats.audio_overruns - reported.audio_overruns, stats.peak,
+                               stats.last_hash);
+      stats.peak = 0.0f;
+      reported = stats;
+      next_report = now + kReportInterval;
+    }
+  }
+
+  std::cout << std::format("total frames={} torn={} dropped={} samples={} hash={:016x}\n",
+                           stats.frames, stats.torn, stats.dropped, stats.samples, stats.last_hash);
+
+  if (!ppm_path.empty()) {
+    WritePpm(ppm_path, last_frame, header->width, header->height);
+  }
+
+  munmap(data, st.st_size);
+  return 0;
+}
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <format>
+#include <new>
+#include <spdlog/spdlog.h>
+#include <tracy/Tracy.hpp>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define SHM_EXPORT_SUPPORTED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(SHM_EXPORT_SUPPORTED) && defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "shm_export.hpp"
+
+
+static_assert(sizeof(Color) == sizeof(u32));
+
+static void WakeReaders(shm::ShmHeader* header) {
+#if defined(SHM_EXPORT_SUPPORTED) && defined(__linux__)
+  // The region is shared between processes so this must not be a private futex.
+  if (header->waiters.load(std::memory_order_acquire) > 0) {
+    syscall(SYS_futex, &header->frame_signal, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+  }
+#else
+  (void)header;
+#endif
+}
+
+ShmExport::~ShmExport() {
+  Close();
+}
+
+ShmExportResult ShmExport::Open(std::string_view name, ShmExportConfig cfg) {
+#ifdef SHM_EXPORT_SUPPORTED
+  Close();
+
+  if (name.empty() || name.front() != '/') {
+    return std::unexpected{std::format("Shared memory name '{}' must start with '/'", name)};
+  }
+  if (cfg.num_frames == 0) {
+    return std::unexpected{"Shared memory export needs at least one frame slot"};
+  }
+
+  const std::string shm_name{name};
+  const size_t size = shm::RegionSize(cfg.num_frames, shm::kAudioCapacity);
+
+  int fd = shm_open(shm_name.c_str(), O_CREAT | O_RDWR, 0600);
+  if (fd < 0) {
+    return std::unexpected{std::format("shm_open failed: {}", std::strerror(errno))};
+  }
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    auto error = std::format("ftruncate failed: {}", std::strerror(errno));
+    close(fd);
+    shm_unlink(shm_name.c_str());
+    return std::unexpected{error};
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    shm_unlink(shm_name.c_str());
+    return std::unexpected{std::format("mmap failed: {}", std::strerror(errno))};
+  }
+
+  std::memset(data, 0, size);
+  header_ = new (data) shm::ShmHeader{};
+  header_->width = shm::kFrameWidth;
+  header_->height = shm::kFrameHeight;
+  header_->num_frames = cfg.num_frames;
+  header_->sample_rate = cfg.sample_rate;
+  header_->num_channels = cfg.num_channels;
+  header_->audio_capacity = shm::kAudioCapacity;
+  header_->version = shm::kVersion;
+
+  auto* frames = shm::Frames(header_);
+  for (u32 i = 0; i < cfg.num_frames; i += 1) {
+    new (&frames[i]) shm::ShmFrameSlot{};
+  }
+
+  // Written last so readers never see a half initialised header.
+  std::atomic_ref<u32>(header_->magic).store(shm::kMagic, std::memory_order_release);
+
+  size_ = size;
+  name_ = shm_name;
+  spdlog::info("Exporting frames and audio to shared memory '{}' ({} bytes)", name_, size_);
+  return {};
+#else
+  (void)name;
+  (void)cfg;
+  return std::unexpected{"Shared memory export is not supported on this platform"};
+#endif
+}
+
+void ShmExport::Close() {
+#ifdef SHM_EXPORT_SUPPORTED
+  if (!header_) {
+    return;
+  }
+  std::atomic_ref<u32>(header_->magic).store(0, std::memory_order_release);
+  header_->frame_signal.fetch_add(1, std::memory_order_release);
+  WakeReaders(header_);
+
+  munmap(header_, size_);
+  shm_unlink(name_.c_str());
+#endif
+  header_ = nullptr;
+  size_ = 0;
+  name_.clear();
+  pending_slot_ = nullptr;
+}
+
+bool ShmExport::IsOpen() const {
+  return header_ != nullptr;
+}
+
+const std::string& ShmExport::GetName() const {
+  return name_;
+}
+
+std::span<Color> ShmExport::BeginFrame(u64 frame_number) {
+  if (!header_) {
+    return {};
+  }
+
+  const u64 index = header_->frames_written.load(std::memory_order_relaxed);
+  pending_slot_ = &shm::Frames(header_)[index % header_->num_frames];
+  pending_sequence_ = 2 * (index + 1);
+
+  pending_slot_->sequence.store(pending_sequence_ - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  pending_slot_->frame_number = frame_number;
+
+  return { reinterpret_cast<Color*>(pending_slot_->pixels), std::size(pending_slot_->pixels) };
+}
+
+void ShmExport::PublishFrame() {
+  if (!header_ || !pending_slot_) {
+    return;
+  }
+
+  pending_slot_->sequence.store(pending_sequence_, std::memory_order_release);
+  header_->frames_written.store(pending_sequence_ / 2, std::memory_order_release);
+  header_->frame_signal.fetch_add(1, std::memory_order_release);
+  pending_slot_ = nullptr;
+
+  WakeReaders(header_);
+}
+
+void ShmExport::PushSamples(std::span<const float> samples) {
+  ZoneScoped;
+
+  if (!header_ || samples.empty()) {
+    return;
+  }
+
+  if (samples.size() > header_->audio_capacity) {
+    header_->audio_write_pos.fetch_add(samples.size() - header_->audio_capacity, std::memory_order_relaxed);
+    samples = samples.last(header_->audio_capacity);
+  }
+
+  auto* audio = shm::Audio(header_);
+  const u64 pos = header_->audio_write_pos.load(std::memory_order_relaxed);
+  const size_t mask = header_->audio_capacity - 1;
+
+  // Copy in at most two runs around the end of the ring.
+  const size_t start = pos & mask;
+  const size_t first = std::min(samples.size(), header_->audio_capacity - start);
+  std::copy_n(samples.data(), first, audio + start);
+  std::copy_n(samples.data() + first, samples.size() - first, audio);
+
+  header_->audio_write_pos.store(pos + samples.size(), std::memory_order_release);
+}
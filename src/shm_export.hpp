@@ -0,0 +1,49 @@
+#pragma once
+
+#include <expected>
+#include <span>
+#include <string>
+#include <string_view>
+#include <raylib.h>
+
+#include "types.hpp"
+#include "shm_layout.hpp"
+
+
+struct ShmExportConfig {
+  u32 num_frames = shm::kDefaultNumFrames;
+  u32 sample_rate;
+  u32 num_channels;
+};
+
+using ShmExportResult = std::expected<void, std::string>;
+
+// Publishes completed LCD frames and PCM samples into a POSIX shared memory
+// region (see shm_layout.hpp) so other processes can read them without copies.
+class ShmExport {
+public:
+  ShmExport() = default;
+  ~ShmExport();
+
+  ShmExport(const ShmExport&) = delete;
+  ShmExport& operator=(const ShmExport&) = delete;
+
+  ShmExportResult Open(std::string_view name, ShmExportConfig cfg);
+  void Close();
+  [[nodiscard]] bool IsOpen() const;
+  [[nodiscard]] const std::string& GetName() const;
+
+  // Returns the next slot's pixels to be filled in place; PublishFrame makes
+  // it visible to readers.
+  std::span<Color> BeginFrame(u64 frame_number);
+  void PublishFrame();
+
+  void PushSamples(std::span<const float> samples);
+
+private:
+  shm::ShmHeader* header_ = nullptr;
+  size_t size_ = 0;
+  std::string name_ {};
+  shm::ShmFrameSlot* pending_slot_ = nullptr;
+  u64 pending_sequence_ = 0;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "types.hpp"
+
+
+// Layout of the shared memory region written by ShmExport. It is kept free of
+// emulator and raylib headers so external consumers can include it directly.
+//
+//   ShmHeader | ShmFrameSlot[num_frames] | float audio[audio_capacity]
+//
+// Frames are RGBA8 and published through a per slot sequence counter: odd while
+// the slot is being written, 2 * (frame index + 1) once complete. Readers check
+// the counter before and after touching the pixels to detect torn frames.
+// Audio is interleaved stereo in a ring addressed by a monotonic sample
+// position; a reader that falls more than audio_capacity behind has lost data.
+namespace shm {
+
+constexpr u32 kMagic = 0x42474341; // "ACGB"
+constexpr u32 kVersion = 1;
+constexpr u32 kFrameWidth = 160;
+constexpr u32 kFrameHeight = 144;
+constexpr u32 kDefaultNumFrames = 4;
+constexpr u32 kAudioCapacity = 1 << 15;
+constexpr char const* kDefaultName = "/ace-gb";
+
+static_assert((kAudioCapacity & (kAudioCapacity - 1)) == 0);
+
+struct ShmHeader {
+  u32 magic;
+  u32 version;
+  u32 width;
+  u32 height;
+  u32 num_frames;
+  u32 sample_rate;
+  u32 num_channels;
+  u32 audio_capacity;
+
+  // Bumped after every published frame; consumers futex-wait on it (Linux).
+  alignas(64) std::atomic<u32> frame_signal;
+  std::atomic<u32> waiters;
+  std::atomic<u64> frames_written;
+
+  alignas(64) std::atomic<u64> audio_write_pos;
+};
+
+struct ShmFrameSlot {
+  alignas(64) std::atomic<u64> sequence;
+  u64 frame_number;
+  u32 pixels[kFrameWidth * kFrameHeight];
+};
+
+static_assert(std::atomic<u32>::is_always_lock_free && std::atomic<u64>::is_always_lock_free);
+
+constexpr size_t FramesOffset() {
+  return sizeof(ShmHeader);
+}
+
+constexpr size_t AudioOffset(u32 num_frames) {
+  return FramesOffset() + sizeof(ShmFrameSlot) * num_frames;
+}
+
+constexpr size_t RegionSize(u32 num_frames, u32 audio_capacity) {
+  return AudioOffset(num_frames) + sizeof(float) * audio_capacity;
+}
+
+inline ShmFrameSlot* Frames(ShmHeader* header) {
+  return reinterpret_cast<ShmFrameSlot*>(reinterpret_cast<std::byte*>(header) + FramesOffset());
+}
+
+inline float* Audio(ShmHeader* header) {
+  return reinterpret_cast<float*>(reinterpret_cast<std::byte*>(header) + AudioOffset(header->num_frames));
+}
+
+}
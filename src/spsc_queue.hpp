@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <utility>
+
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(std::has_single_bit(N), "SpscQueue capacity must be a power of two");
+
+public:
+  bool Push(T value) {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == N) {
+      return false;
+    }
+    items_[tail & (N - 1)] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Pop(T& value) {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(items_[head & (N - 1)]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  [[nodiscard]] bool Empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  static constexpr size_t kCacheLine = 64;
+
+  alignas(kCacheLine) std::atomic<size_t> head_ {0};
+  alignas(kCacheLine) std::atomic<size_t> tail_ {0};
+  std::array<T, N> items_ {};
+};
@@ -1,9 +1,30 @@
 #pragma once
 
+#include <limits>
+
+#include "types.hpp"
+
 
 class SyncedDevice {
 public:
+  // IdleTicks of a device with nothing scheduled.
+  static constexpr u32 kIdleForever = std::numeric_limits<u32>::max();
+
   virtual ~SyncedDevice() = default;
 
   virtual void OnTick(bool double_speed) = 0;
+
+  // M-cycles the device can be advanced through without raising an interrupt
+  // or changing anything an idle CPU could see, see Cpu::FastForward. The
+  // default keeps the device on one OnTick per M-cycle.
+  [[nodiscard]] virtual u32 IdleTicks(bool double_speed) const {
+    return 0;
+  }
+
+  // Advances m_cycles M-cycles at once, never more than IdleTicks returned.
+  virtual void OnTicks(u32 m_cycles, bool double_speed) {
+    for (u32 i = 0; i < m_cycles; i += 1) {
+      OnTick(double_speed);
+    }
+  }
 };
@@ -8,6 +8,8 @@
 #include <spdlog/spdlog.h>
 
 #include "cpu.hpp"
+#include "decoder.hpp"
+#include "loop_idioms.hpp"
 #include "mmu.hpp"
 #include "registers.hpp"
 #include "interrupt_device.hpp"
@@ -17,6 +19,22 @@ using json = nlohmann::json;
 
 constexpr size_t kTestMemSize = 65536;
 
+constexpr u16 kLoopTestStart = 0x0150;
+constexpr u16 kLoopTestInterruptVector = 0x0040;
+constexpr u16 kLoopTestPolledAddr = 0xFF80;
+// Halfway into WRAM or VRAM, so stores going either way stay in it for a
+// while.
+constexpr u16 kLoopTestWramDst = 0xD000;
+constexpr u16 kLoopTestVramDst = 0x9000;
+constexpr size_t kLoopTestCycles = 200000;
+constexpr int kLoopTestBudget = 1000;
+
+constexpr u16 kEchoTestStart = 0x0150;
+constexpr u16 kEchoRamStart = 0xE000;
+constexpr u16 kEchoRamEnd = 0xFDFF;
+constexpr u16 kEchoRamOffset = 0x2000;
+constexpr int kEchoTestMaxInstructions = 100;
+
 using TestMemory = std::array<u8, kTestMemSize>;
 
 class TestMemoryDevice : public MmuDevice {
@@ -43,11 +61,42 @@ private:
   TestMemory& mem_;
 };
 
+// Flat memory except for echo RAM, which mirrors C000-DDFF like WramDevice.
+class EchoTestMemoryDevice : public MmuDevice {
+public:
+  explicit EchoTestMemoryDevice(TestMemory& mem_):mem_{mem_} {}
+
+  bool IsValidFor(u16 addr) const override {
+    return true;
+  }
+
+  void Write8(u16 addr, u8 byte) override {
+    mem_[Map(addr)] = byte;
+  }
+
+  [[nodiscard]] u8 Read8(u16 addr) const override {
+    return mem_[Map(addr)];
+  }
+
+  void Reset() override {
+    mem_.fill(0);
+  }
+
+private:
+  static u16 Map(u16 addr) {
+    return addr >= kEchoRamStart && addr <= kEchoRamEnd ? addr - kEchoRamOffset : addr;
+  }
+
+  TestMemory& mem_;
+};
+
 struct TestConfig {
   fs::path path {};
   std::vector<size_t> only_cases {};
   bool list_fails = false;
   bool fail_details = false;
+  // Runs each case as a compiled block where the JIT can run it.
+  bool jit = false;
 };
 
 template <typename TSuccess, typename TFailed>
@@ -162,6 +211,7 @@ std::expected<TestResult<int, int>, std::string> RunTest(const TestConfig& confi
   Cpu cpu;
   cpu.Init({
     .test = true,
+    .core = config.jit ? CpuCore::kJit : CpuCore::kCached,
     .mmu = &mmu,
     .interrupts = &interrupts,
   });
@@ -185,7 +235,10 @@ std::expected<TestResult<int, int>, std::string> RunTest(const TestConfig& confi
     LoadRegisters(final, final_regs);
     LoadMemory(initial.at("ram"), mem);
 
-    cpu.Execute();
+    // A budget of one cycle stops the block after its first instruction.
+    if (!config.jit || !cpu.FastForward(1)) {
+      cpu.Execute();
+    }
 
     auto reg_match = regs == final_regs;
     auto ram_match = CheckMemory(final.at("ram"), mem);
@@ -293,6 +346,243 @@ int RunCpuTests(const TestConfig& config) {
   return RunSingleTest(config);
 }
 
+// Changes the polled address every few M-cycles and requests VBlank now and
+// then, so polling loops exit and interrupts land in the middle of loops.
+class LoopTestDevice : public SyncedDevice {
+public:
+  LoopTestDevice(TestMemory& mem, InterruptDevice& interrupts):mem_{mem}, interrupts_{interrupts} {}
+
+  void OnTick(bool double_speed) override {
+    ticks_ += 1;
+    if (ticks_ % 97 == 0) {
+      mem_[kLoopTestPolledAddr] += 1;
+    }
+    if (ticks_ % 4561 == 0) {
+      interrupts_.RequestInterrupt(Interrupt::VBlank);
+    }
+  }
+
+  u32 IdleTicks(bool double_speed) const override {
+    return static_cast<u32>(std::min(96 - ticks_ % 97, 4560 - ticks_ % 4561));
+  }
+
+  void OnTicks(u32 m_cycles, bool double_speed) override {
+    ticks_ += m_cycles;
+  }
+
+private:
+  TestMemory& mem_;
+  InterruptDevice& interrupts_;
+  u64 ticks_ = 0;
+};
+
+// Flat memory that takes spans, remembering where each bulk store went.
+class LoopTestMemoryDevice : public TestMemoryDevice {
+public:
+  using TestMemoryDevice::TestMemoryDevice;
+
+  [[nodiscard]] bool IsValidForRange(u16 first, u16 last) const override {
+    return true;
+  }
+
+  void WriteSpan(u16 addr, std::span<const u8> src) override {
+    span_writes.push_back(addr);
+    TestMemoryDevice::WriteSpan(addr, src);
+  }
+
+  std::vector<u16> span_writes {};
+};
+
+// Assembles the pattern followed by a HALT and a jump back to the start, with
+// the immediates pointing at kLoopTestPolledAddr.
+std::vector<u8> AssembleLoop(const LoopPattern& pattern) {
+  std::vector<u8> code;
+  for (const auto& step : pattern.steps) {
+    const bool prefixed = step.opcode > 0xFF;
+    auto instr = prefixed ? Decoder::DecodePrefixed(step.opcode & 0xFF) : Decoder::Decode(step.opcode);
+    if (prefixed) {
+      code.push_back(0xCB);
+    }
+    code.push_back(step.opcode & 0xFF);
+    if (instr.opcode == Opcode::JR) {
+      code.push_back(static_cast<u8>(-static_cast<int>(code.size() + 1)));
+    } else if (instr.bytes == 2 && !prefixed) {
+      code.push_back(kLoopTestPolledAddr & 0xFF);
+    } else if (instr.bytes == 3) {
+      code.push_back(kLoopTestPolledAddr & 0xFF);
+      code.push_back(kLoopTestPolledAddr >> 8);
+    }
+  }
+  // HALT, then start over.
+  code.push_back(0x76);
+  code.push_back(0x18);
+  code.push_back(static_cast<u8>(-static_cast<int>(code.size() + 1)));
+  return code;
+}
+
+struct LoopTestRun {
+  Registers regs {};
+  TestMemory mem {};
+  size_t cycles = 0;
+  size_t fast_forwarded = 0;
+  // Bulk stores, and how many of them went to VRAM.
+  size_t transfers = 0;
+  size_t vram_transfers = 0;
+};
+
+// Runs the loop in budgets like Emulator::Update does, either one Execute at
+// a time or fast-forwarding wherever the CPU allows it. A copy or fill loop
+// stores to WRAM, or VRAM with vram_dst.
+std::unique_ptr<LoopTestRun> RunLoop(const std::vector<u8>& code, const LoopTransfer& transfer, bool ime, bool fast_forward, bool vram_dst) {
+  auto run = std::make_unique<LoopTestRun>();
+  for (size_t i = 0; i < run->mem.size(); i += 1) {
+    run->mem[i] = static_cast<u8>(i * 7 + (i >> 8));
+  }
+  std::ranges::copy(code, run->mem.begin() + kLoopTestStart);
+  // The handler returns with interrupts still enabled and the loop restarts.
+  run->mem[kLoopTestInterruptVector] = 0xD9;
+
+  Mmu mmu;
+  InterruptDevice interrupts;
+  LoopTestMemoryDevice device{run->mem};
+  mmu.AddDevice(&interrupts);
+  mmu.AddDevice(&device);
+  LoopTestDevice test_device{run->mem, interrupts};
+
+  Cpu cpu;
+  cpu.Init({
+    .test = true,
+    .mmu = &mmu,
+    .interrupts = &interrupts,
+  });
+  cpu.Reset();
+  cpu.AddSyncedDevice(&test_device);
+  interrupts.EnableInterrupt(Interrupt::VBlank);
+
+  auto& regs = cpu.GetRegisters();
+  regs.Set(Reg16::BC, 0x0180);
+  regs.Set(Reg16::DE, 0xC800);
+  regs.Set(Reg16::HL, 0xC000);
+  if (transfer.dst != LoopOperand::kNone) {
+    regs.Set(transfer.dst == LoopOperand::kHl ? Reg16::HL : Reg16::DE, vram_dst ? kLoopTestVramDst : kLoopTestWramDst);
+  }
+  regs.sp = 0xFFFE;
+  regs.pc = kLoopTestStart;
+  cpu.GetState().ime = ime;
+
+  while (run->cycles < kLoopTestCycles) {
+    int budget = 0;
+    do {
+      int cycles = fast_forward ? cpu.FastForward(kLoopTestBudget - budget) : 0;
+      run->fast_forwarded += cycles;
+      if (!cycles) {
+        cycles = cpu.Execute();
+      }
+      budget += cycles;
+    } while (budget < kLoopTestBudget);
+    run->cycles += budget;
+  }
+
+  run->regs = regs;
+  run->transfers = device.span_writes.size();
+  run->vram_transfers = std::ranges::count_if(device.span_writes, [](u16 addr) {
+    return addr >= 0x8000 && addr <= 0x9FFF;
+  });
+  return run;
+}
+
+int RunLoopIdiomTests() {
+  size_t failed = 0;
+  size_t total = 0;
+  for (const auto& pattern : loop_idioms::GetPatterns()) {
+    const auto code = AssembleLoop(pattern);
+    const bool transfer = pattern.transfer.dst != LoopOperand::kNone;
+    for (bool ime : {false, true}) {
+      // Copies and fills run again into VRAM, and must be transferred in
+      // bulk either way.
+      for (bool vram_dst : {false, true}) {
+        if (vram_dst && !transfer) {
+          continue;
+        }
+        total += 1;
+        auto expected = RunLoop(code, pattern.transfer, ime, false, vram_dst);
+        auto actual = RunLoop(code, pattern.transfer, ime, true, vram_dst);
+
+        const bool success = actual->regs == expected->regs
+          && actual->mem == expected->mem
+          && actual->cycles == expected->cycles;
+        if (!success) {
+          failed += 1;
+          spdlog::error("Loop test failed: {} (ime={}, vram={})", pattern.name, ime, vram_dst);
+          for (const auto &[reg, a, b] : MismatchedRegisters(actual->regs, expected->regs)) {
+            spdlog::error("  reg[{}]: {} != {}", reg, a, b);
+          }
+          if (actual->cycles != expected->cycles) {
+            spdlog::error("  cycles: {} != {}", actual->cycles, expected->cycles);
+          }
+        } else if (!actual->fast_forwarded || (transfer && !(vram_dst ? actual->vram_transfers : actual->transfers))) {
+          failed += 1;
+          spdlog::error("Loop test failed: {} (ime={}, vram={}) was never fast-forwarded", pattern.name, ime, vram_dst);
+        } else {
+          spdlog::debug("Loop test succeeded: {} (ime={}, vram={}), {} of {} cycles fast-forwarded",
+            pattern.name, ime, vram_dst, actual->fast_forwarded, actual->cycles);
+        }
+      }
+    }
+  }
+
+  spdlog::info("{} / {} loop tests were successful.", total - failed, total);
+  return failed ? 1 : 0;
+}
+
+// Runs a subroutine in WRAM from the block cache, patches its immediate
+// through echo RAM and runs it again, which must see the new byte.
+int RunEchoRamTests() {
+  TestMemory mem {};
+  const std::vector<u8> code = {
+    0xCD, 0x00, 0xC0, // CALL $C000
+    0x47,             // LD B,A
+    0x3E, 0x02,       // LD A,$02
+    0xEA, 0x01, 0xE0, // LD ($E001),A
+    0xCD, 0x00, 0xC0, // CALL $C000
+    0x76,             // HALT
+  };
+  const std::vector<u8> subroutine = {
+    0x3E, 0x01,       // LD A,$01
+    0xC9,             // RET
+  };
+  std::ranges::copy(code, mem.begin() + kEchoTestStart);
+  std::ranges::copy(subroutine, mem.begin() + 0xC000);
+
+  Mmu mmu;
+  InterruptDevice interrupts;
+  EchoTestMemoryDevice device{mem};
+  mmu.AddDevice(&interrupts);
+  mmu.AddDevice(&device);
+
+  Cpu cpu;
+  cpu.Init({
+    .test = true,
+    .mmu = &mmu,
+    .interrupts = &interrupts,
+  });
+  cpu.Reset();
+
+  auto& regs = cpu.GetRegisters();
+  regs.sp = 0xFFFE;
+  regs.pc = kEchoTestStart;
+  for (int i = 0; i < kEchoTestMaxInstructions && !cpu.GetState().halt; i += 1) {
+    cpu.Execute();
+  }
+
+  if (regs.Get(Reg8::B) != 0x01 || regs.Get(Reg8::A) != 0x02) {
+    spdlog::error("Echo RAM test failed: b={:02x} a={:02x}, expected b=01 a=02", regs.Get(Reg8::B), regs.Get(Reg8::A));
+    return 1;
+  }
+  spdlog::info("Echo RAM test was successful.");
+  return 0;
+}
+
 static bool SetLoggingLevel(std::string_view level_name) {
   auto level = magic_enum::enum_cast<spdlog::level::level_enum>(level_name);
   if (level.has_value()) {
@@ -326,8 +616,24 @@ auto main(int argc, char* argv[]) -> int {
     .help("Only run these cases matching specified index")
     .scan<'d', size_t>();
 
+  program.add_argument("--jit")
+    .help("Run the cases on the JIT core")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--loop-idioms")
+    .help("Check that fast-forwarded loops match running them one instruction at a time")
+    .default_value(false)
+    .implicit_value(true);
+
+  program.add_argument("--echo-ram")
+    .help("Check that writes through echo RAM invalidate cached code in WRAM")
+    .default_value(false)
+    .implicit_value(true);
+
   program.add_argument("path")
-    .help("Path to json test file or directory containing json test files.");
+    .help("Path to json test file or directory containing json test files.")
+    .default_value(std::string{});
 
   try {
     program.parse_args(argc, argv);
@@ -347,11 +653,20 @@ auto main(int argc, char* argv[]) -> int {
     return 1;
   }
 
+  if (program.get<bool>("--loop-idioms")) {
+    return RunLoopIdiomTests();
+  }
+
+  if (program.get<bool>("--echo-ram")) {
+    return RunEchoRamTests();
+  }
+
   TestConfig config;
   config.path = program.get("path");
   config.list_fails = program.get<bool>("--list-fails");
   config.fail_details = program.get<bool>("--fail-details");
   config.only_cases = program.get<std::vector<size_t>>("--only-cases");
+  config.jit = program.get<bool>("--jit");
 
   return RunCpuTests(config);
 }
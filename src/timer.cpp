@@ -30,32 +30,34 @@ bool Timer::IsValidFor(u16 addr) const {
 
 void Timer::Write8(u16 addr, u8 byte) {
   ZoneScoped;
-  u16 prev_div = regs_.div;
+  SyncTima();
+  u16 prev_div = InternalDiv();
   u8 prev_tac = regs_.tac;
   switch (addr) {
     case std::to_underlying(IO::DIV):
-      regs_.div = 0;
+      div_reset_ = cycles_;
       ComputeTimer(prev_div, prev_tac);
-      return;
+      break;
     case std::to_underlying(IO::TIMA):
       if (overflowing_ != 0) {
-        regs_.tima = byte;
+        tima_ = byte;
         overflowing_ = -1;
         ComputeTimer(prev_div, prev_tac);
       }
-      return;
+      break;
     case std::to_underlying(IO::TMA):
       regs_.tma = byte;
       if (overflowing_ == 0) {
-        regs_.tima = byte;
+        tima_ = byte;
       }
-      return;
+      break;
     case std::to_underlying(IO::TAC):
       regs_.tac = byte | 0b11111000;
       ComputeTimer(prev_div, prev_tac);
-      return;
+      break;
     default: std::unreachable();
   }
+  Schedule();
 }
 
 u8 Timer::Read8(u16 addr) const {
@@ -64,7 +66,7 @@ u8 Timer::Read8(u16 addr) const {
     case std::to_underlying(IO::DIV):
       return div();
     case std::to_underlying(IO::TIMA):
-      return regs_.tima;
+      return Tima(cycles_);
     case std::to_underlying(IO::TMA):
       return regs_.tma;
     case std::to_underlying(IO::TAC):
@@ -74,54 +76,112 @@ u8 Timer::Read8(u16 addr) const {
 }
 
 void Timer::Reset() {
-  regs_.div = 0;
-  regs_.tima = 0;
   regs_.tma = 0;
   regs_.tac = 0;
   overflowing_ = false;
-  cycles = 0;
+  cycles_ = 0;
+  div_reset_ = 0;
+  tima_ = 0;
+  tima_cycles_ = 0;
+  Schedule();
 }
 
-void Timer::Execute(u8 cycles) {
-  ZoneScoped;
+u16 Timer::InternalDiv() const {
+  return static_cast<u16>(cycles_ - div_reset_);
+}
 
-  if (overflowing_ >= 0) {
-    overflowing_ -= 1;
-    if (overflowing_ == 0) {
-      regs_.tima = regs_.tma;
-      interrupts_->RequestInterrupt(Interrupt::Timer);
-      overflowing_ = false;
-    }
+// Counts the falling edges of the selected DIV bit in (from, to]. The bit
+// falls whenever DIV wraps past a multiple of twice its weight.
+u64 Timer::Edges(u64 from, u64 to) const {
+  if (!regs_.enable_tima) {
+    return 0;
   }
+  u8 shift = kDivTimerBit[regs_.clock_select] + 1;
+  return ((to - div_reset_) >> shift) - ((from - div_reset_) >> shift);
+}
 
-  u16 prev_div = regs_.div;
-  regs_.div += 4;
-  ComputeTimer(prev_div, regs_.tac);
+u8 Timer::Tima(u64 at) const {
+  return static_cast<u8>(tima_ + Edges(tima_cycles_, at));
+}
+
+void Timer::SyncTima() {
+  tima_ = Tima(cycles_);
+  tima_cycles_ = cycles_;
 }
 
 void Timer::ComputeTimer(u16 prev_div, u8 prev_tac) {
-  u8 bit = kDivTimerBit[regs_.clock_select];
   u8 prev_bit = (prev_div >> kDivTimerBit[prev_tac & 0b11]) & (prev_tac >> 2) & 0b1;
-  u8 enable_bit = (regs_.div >> kDivTimerBit[regs_.clock_select]) & regs_.enable_tima & 0b1;
+  u8 enable_bit = (InternalDiv() >> kDivTimerBit[regs_.clock_select]) & regs_.enable_tima & 0b1;
 
   if (overflowing_ == 1) {
     return;
   }
 
   if (prev_bit && !enable_bit) {
-    regs_.tima += 1;
-    if (regs_.tima == 0) {
+    tima_ += 1;
+    if (tima_ == 0) {
       overflowing_ = 1;
     }
   }
 }
 
-void Timer::OnTick(bool double_speed) {
+// Steps a single M-cycle the way the timer used to every tick. Only needed on
+// the tick TIMA overflows and the two after it.
+void Timer::Execute() {
   ZoneScoped;
-  Execute(4);
-  cycles += 4;
+
+  tima_ = Tima(cycles_ - 4);
+  tima_cycles_ = cycles_;
+
+  if (overflowing_ >= 0) {
+    overflowing_ -= 1;
+    if (overflowing_ == 0) {
+      tima_ = regs_.tma;
+      interrupts_->RequestInterrupt(Interrupt::Timer);
+      overflowing_ = false;
+    }
+  }
+
+  ComputeTimer(InternalDiv() - 4, regs_.tac);
+  Schedule();
+}
+
+// Works out the tick TIMA overflows on, every tick while an overflow is in
+// flight.
+void Timer::Schedule() {
+  if (overflowing_ >= 0) {
+    next_event_ = cycles_ + 4;
+  } else if (!regs_.enable_tima) {
+    next_event_ = kNever;
+  } else {
+    u8 shift = kDivTimerBit[regs_.clock_select] + 1;
+    u64 edges = ((tima_cycles_ - div_reset_) >> shift) + (0x100 - tima_);
+    next_event_ = div_reset_ + (edges << shift);
+  }
+}
+
+void Timer::OnTick(bool double_speed) {
+  cycles_ += 4;
+  if (cycles_ >= next_event_) {
+    Execute();
+  }
+}
+
+// Nothing happens until the tick that reaches next_event_.
+u32 Timer::IdleTicks(bool double_speed) const {
+  if (next_event_ == kNever) {
+    return kIdleForever;
+  }
+  if (next_event_ <= cycles_ + 4) {
+    return 0;
+  }
+  return static_cast<u32>(std::min<u64>((next_event_ - cycles_ - 1) / 4, kIdleForever));
+}
+
+void Timer::OnTicks(u32 m_cycles, bool double_speed) {
+  cycles_ += u64{4} * m_cycles;
 }
 
 u16 Timer::div() const {
-  return regs_.div >> 8;
+  return InternalDiv() >> 8;
 }
@@ -1,13 +1,13 @@
 #pragma once
 
+#include <limits>
+
 #include "mmu_device.hpp"
 #include "interrupt_device.hpp"
 #include "synced_device.hpp"
 
 
 struct TimerRegisters {
-  u16 div;
-  u8 tima;
   u8 tma;
   union {
     u8 tac;
@@ -23,6 +23,9 @@ struct TimerConfig {
   InterruptDevice* interrupts;
 };
 
+// DIV and TIMA are not counted every M-cycle. DIV is derived from the cycle it
+// was last reset at and TIMA from the number of DIV falling edges since it was
+// last written, the only per-tick work is waiting for the next overflow.
 class Timer : public MmuDevice, public SyncedDevice {
 public:
   void Init(TimerConfig cfg);
@@ -32,15 +35,31 @@ public:
   [[nodiscard]] u8 Read8(u16 addr) const override;
   void Reset() override;
 
-  void Execute(u8 cycles);
   void OnTick(bool double_speed) override;
-  void ComputeTimer(u16 prev_div, u8 prev_tac);
+  [[nodiscard]] u32 IdleTicks(bool double_speed) const override;
+  void OnTicks(u32 m_cycles, bool double_speed) override;
 
   u16 div() const;
 
 private:
+  static constexpr u64 kNever = std::numeric_limits<u64>::max();
+
+  [[nodiscard]] u16 InternalDiv() const;
+  [[nodiscard]] u64 Edges(u64 from, u64 to) const;
+  [[nodiscard]] u8 Tima(u64 at) const;
+  void SyncTima();
+  void ComputeTimer(u16 prev_div, u8 prev_tac);
+  void Execute();
+  void Schedule();
+
   InterruptDevice* interrupts_ = nullptr;
   TimerRegisters regs_ {};
   int overflowing_ = -1;
-  u64 cycles = 0;
+  // T-cycles since reset, DIV counts from div_reset_.
+  u64 cycles_ = 0;
+  u64 div_reset_ = 0;
+  // TIMA as of tima_cycles_, later edges are added on read.
+  u8 tima_ = 0;
+  u64 tima_cycles_ = 0;
+  u64 next_event_ = 0;
 };
@@ -0,0 +1,109 @@
+// Converts a binary trace written with --trace or --doctor-log (see
+// trace_layout.hpp) to the text log gameboy-doctor compares against, one line
+// per instruction.
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <argparse/argparse.hpp>
+
+#include "trace_layout.hpp"
+
+
+namespace {
+  constexpr size_t kOutputBufferSize = 1 << 20;
+}
+
+static void AppendDoctorLine(std::string& out, const trace::TraceRecord& record) {
+  const auto& r = record.regs;
+  const auto& m = record.code;
+  std::format_to(std::back_inserter(out),
+    "A:{:02X} F:{:02X} B:{:02X} C:{:02X} D:{:02X} E:{:02X} H:{:02X} L:{:02X} SP:{:04X} PC:{:04X} PCMEM:{:02X},{:02X},{:02X},{:02X}\n",
+    r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7], record.sp, record.pc, m[0], m[1], m[2], m[3]);
+}
+
+auto main(int argc, char* argv[]) -> int {
+  argparse::ArgumentParser program("trace-convert");
+  program.add_argument("trace")
+    .help("Binary trace to convert");
+  program.add_argument("--output")
+    .help("Text log to write")
+    .default_value(std::string{"doctor.log"});
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << "\n" << program;
+    return 1;
+  }
+
+  const auto trace_path = program.get<std::string>("trace");
+  const auto output_path = program.get<std::string>("--output");
+
+  std::ifstream in(trace_path, std::ios::binary);
+  if (!in) {
+    std::cerr << std::format("Failed to open '{}': {}\n", trace_path, std::strerror(errno));
+    return 1;
+  }
+
+  trace::TraceHeader header {};
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != trace::kMagic) {
+    std::cerr << std::format("'{}' is not an ace-gb trace\n", trace_path);
+    return 1;
+  }
+  if (header.version != trace::kVersion) {
+    std::cerr << std::format("Unsupported trace version {}, expected {}\n", header.version, trace::kVersion);
+    return 1;
+  }
+
+  std::ofstream out(output_path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << std::format("Failed to open '{}': {}\n", output_path, std::strerror(errno));
+    return 1;
+  }
+
+  trace::Decoder decoder;
+  trace::TraceRecord record {};
+  trace::TraceChunkHeader chunk_header {};
+  std::vector<u8> chunk;
+  std::string text;
+  text.reserve(kOutputBufferSize + 256);
+  u64 records = 0;
+
+  while (in.read(reinterpret_cast<char*>(&chunk_header), sizeof(chunk_header))) {
+    chunk.resize(chunk_header.size);
+    if (!in.read(reinterpret_cast<char*>(chunk.data()), chunk_header.size)) {
+      std::cerr << "Trace ends in the middle of a chunk, stopping there\n";
+      break;
+    }
+
+    decoder.Begin();
+    const u8* pos = chunk.data();
+    const u8* end = pos + chunk.size();
+    for (u32 i = 0; i < chunk_header.num_records; i += 1) {
+      if (!decoder.Decode(pos, end, record)) {
+        std::cerr << std::format("Corrupt chunk after {} instructions\n", records);
+        return 1;
+      }
+      AppendDoctorLine(text, record);
+      records += 1;
+      if (text.size() >= kOutputBufferSize) {
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        text.clear();
+      }
+    }
+  }
+
+  out.write(text.data(), static_cast<std::streamsize>(text.size()));
+  if (!out) {
+    std::cerr << std::format("Failed to write '{}'\n", output_path);
+    return 1;
+  }
+
+  std::cout << std::format("Converted {} instructions to '{}'\n", records, output_path);
+  return 0;
+}
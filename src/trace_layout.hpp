@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "types.hpp"
+
+
+// Binary execution trace written by TraceRecorder and read back by
+// trace-convert. It is kept free of emulator headers so the converter builds
+// on its own.
+//
+//   TraceHeader | (TraceChunkHeader | encoded records)...
+//
+// Every chunk is encoded on its own so a trace cut short by a crash is still
+// readable up to its last complete chunk. Within a chunk each record is stored
+// as the difference to what the previous records predict: the cycle as a
+// delta, PC as the address that followed the previous PC last time, the code
+// bytes as those last seen at PC and everything else as the previous record.
+// Only the bytes that differ from the prediction are written, which in loops
+// leaves a few bytes per instruction.
+namespace trace {
+
+constexpr u32 kMagic = 0x52544341; // "ACTR"
+constexpr u32 kVersion = 1;
+constexpr u32 kChunkRecords = 1 << 16;
+
+struct TraceHeader {
+  u32 magic;
+  u32 version;
+};
+
+struct TraceChunkHeader {
+  u32 num_records;
+  u32 size;
+};
+
+// CPU state right before an instruction executes.
+struct TraceRecord {
+  // T-cycles since the CPU was reset.
+  u64 cycle;
+  u16 pc;
+  // Bank of the device mapped at PC.
+  u16 bank;
+  u16 sp;
+  // A, F, B, C, D, E, H and L.
+  std::array<u8, 8> regs;
+  // The instruction and what follows it, as gameboy-doctor's PCMEM.
+  std::array<u8, 4> code;
+};
+
+// The predicted fields, in the order of the bits in a record's byte mask.
+// Registers come first as they change most and keep the mask to one byte.
+constexpr size_t kPredictedBytes = 18;
+constexpr size_t kCodeOffset = 12;
+
+using PredictedBytes = std::array<u8, kPredictedBytes>;
+
+class Predictor {
+public:
+  void Reset() {
+    prev_ = {};
+    next_pc_.assign(0x10000, 0);
+    code_.assign(0x10000, {});
+  }
+
+  // The code bytes depend on PC, which is only known once the bytes before
+  // them have been decoded, see PredictCode.
+  [[nodiscard]] PredictedBytes Predict() const {
+    TraceRecord predicted = prev_;
+    predicted.pc = next_pc_[prev_.pc];
+    return Pack(predicted);
+  }
+
+  void PredictCode(PredictedBytes& bytes, u16 pc) const {
+    const auto& code = code_[pc];
+    std::copy(code.begin(), code.end(), bytes.begin() + kCodeOffset);
+  }
+
+  void Update(const TraceRecord& record) {
+    next_pc_[prev_.pc] = record.pc;
+    code_[record.pc] = record.code;
+    prev_ = record;
+  }
+
+  [[nodiscard]] const TraceRecord& Previous() const {
+    return prev_;
+  }
+
+  [[nodiscard]] static PredictedBytes Pack(const TraceRecord& record) {
+    PredictedBytes bytes {};
+    std::copy(record.regs.begin(), record.regs.end(), bytes.begin());
+    bytes[8] = record.pc & 0xff;
+    bytes[9] = record.pc >> 8;
+    bytes[10] = record.sp & 0xff;
+    bytes[11] = record.sp >> 8;
+    std::copy(record.code.begin(), record.code.end(), bytes.begin() + kCodeOffset);
+    bytes[16] = record.bank & 0xff;
+    bytes[17] = record.bank >> 8;
+    return bytes;
+  }
+
+  static void Unpack(const PredictedBytes& bytes, TraceRecord& record) {
+    std::copy(bytes.begin(), bytes.begin() + 8, record.regs.begin());
+    record.pc = bytes[8] | (bytes[9] << 8);
+    record.sp = bytes[10] | (bytes[11] << 8);
+    std::copy(bytes.begin() + kCodeOffset, bytes.begin() + kCodeOffset + 4, record.code.begin());
+    record.bank = bytes[16] | (bytes[17] << 8);
+  }
+
+private:
+  TraceRecord prev_ {};
+  std::vector<u16> next_pc_ {};
+  std::vector<std::array<u8, 4>> code_ {};
+};
+
+inline void PutVarint(std::vector<u8>& out, u64 val) {
+  while (val >= 0x80) {
+    out.push_back(static_cast<u8>(val) | 0x80);
+    val >>= 7;
+  }
+  out.push_back(static_cast<u8>(val));
+}
+
+inline bool GetVarint(const u8*& in, const u8* end, u64& val) {
+  val = 0;
+  for (int shift = 0; in != end && shift < 64; shift += 7) {
+    u8 byte = *in++;
+    val |= static_cast<u64>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Record: varint cycle delta | varint byte mask | the bytes set in the mask.
+class Encoder {
+public:
+  void Begin() {
+    predictor_.Reset();
+  }
+
+  void Encode(const TraceRecord& record, std::vector<u8>& out) {
+    auto predicted = predictor_.Predict();
+    auto actual = Predictor::Pack(record);
+    predictor_.PredictCode(predicted, record.pc);
+    u32 mask = 0;
+    for (size_t i = 0; i < kPredictedBytes; i += 1) {
+      if (actual[i] != predicted[i]) {
+        mask |= 1 << i;
+      }
+    }
+
+    PutVarint(out, record.cycle - predictor_.Previous().cycle);
+    PutVarint(out, mask);
+    for (size_t i = 0; i < kPredictedBytes; i += 1) {
+      if (mask & (1 << i)) {
+        out.push_back(actual[i]);
+      }
+    }
+    predictor_.Update(record);
+  }
+
+private:
+  Predictor predictor_ {};
+};
+
+class Decoder {
+public:
+  void Begin() {
+    predictor_.Reset();
+  }
+
+  // Returns false when the input ends in the middle of a record.
+  bool Decode(const u8*& in, const u8* end, TraceRecord& record) {
+    u64 delta = 0;
+    u64 mask = 0;
+    if (!GetVarint(in, end, delta) || !GetVarint(in, end, mask)) {
+      return false;
+    }
+
+    auto bytes = predictor_.Predict();
+    for (size_t i = 0; i < kPredictedBytes; i += 1) {
+      if (i == kCodeOffset) {
+        predictor_.PredictCode(bytes, bytes[8] | (bytes[9] << 8));
+      }
+      if (mask & (1 << i)) {
+        if (in == end) {
+          return false;
+        }
+        bytes[i] = *in++;
+      }
+    }
+
+    record.cycle = predictor_.Previous().cycle + delta;
+    Predictor::Unpack(bytes, record);
+    predictor_.Update(record);
+    return true;
+  }
+
+private:
+  Predictor predictor_ {};
+};
+
+}
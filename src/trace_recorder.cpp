@@ -0,0 +1,105 @@
+#include <chrono>
+#include <format>
+#include <spdlog/spdlog.h>
+#include <tracy/Tracy.hpp>
+
+#include "trace_recorder.hpp"
+
+
+namespace {
+  constexpr auto kIdleWait = std::chrono::milliseconds(1);
+}
+
+TraceRecorder::~TraceRecorder() {
+  Stop();
+}
+
+TraceResult TraceRecorder::Start(std::string_view path) {
+  Stop();
+
+  file_.open(std::string{path}, std::ios::binary | std::ios::trunc);
+  if (!file_) {
+    return std::unexpected{std::format("Failed to open '{}'", path)};
+  }
+
+  const trace::TraceHeader header {
+    .magic = trace::kMagic,
+    .version = trace::kVersion,
+  };
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  encoder_.Begin();
+  chunk_.clear();
+  chunk_records_ = 0;
+  records_ = 0;
+  running_ = true;
+  thread_ = std::thread(&TraceRecorder::Run, this);
+  spdlog::info("Tracing to '{}'", path);
+  return {};
+}
+
+void TraceRecorder::Stop() {
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  thread_.join();
+  file_.close();
+  spdlog::info("Trace stopped after {} instructions", records_.load());
+}
+
+bool TraceRecorder::IsRecording() const {
+  return running_;
+}
+
+u64 TraceRecorder::GetRecordCount() const {
+  return records_;
+}
+
+void TraceRecorder::Run() {
+  trace::TraceRecord record {};
+  while (true) {
+    // Checked before draining, so whatever was pushed before Stop is written.
+    const bool running = running_;
+    bool idle = true;
+    while (queue_->Pop(record)) {
+      idle = false;
+      encoder_.Encode(record, chunk_);
+      chunk_records_ += 1;
+      if (chunk_records_ == trace::kChunkRecords) {
+        WriteChunk();
+      }
+    }
+    if (!running) {
+      break;
+    }
+    if (idle) {
+      std::this_thread::sleep_for(kIdleWait);
+    }
+  }
+  WriteChunk();
+  file_.flush();
+}
+
+void TraceRecorder::WriteChunk() {
+  ZoneScoped;
+
+  if (!chunk_records_) {
+    return;
+  }
+
+  const trace::TraceChunkHeader header {
+    .num_records = chunk_records_,
+    .size = static_cast<u32>(chunk_.size()),
+  };
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_.write(reinterpret_cast<const char*>(chunk_.data()), static_cast<std::streamsize>(chunk_.size()));
+  if (!file_) {
+    spdlog::error("Failed to write trace chunk");
+  }
+
+  records_ += chunk_records_;
+  chunk_.clear();
+  chunk_records_ = 0;
+  encoder_.Begin();
+}
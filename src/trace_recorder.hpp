@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <expected>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+#include "spsc_queue.hpp"
+#include "trace_layout.hpp"
+
+
+using TraceResult = std::expected<void, std::string>;
+
+// Streams the CPU state before every instruction to a binary trace (see
+// trace_layout.hpp). The emulation thread only pushes the fixed size record
+// into a lock-free ring, the writer thread encodes and writes it in chunks.
+// Records are never dropped, a full ring makes the emulation thread wait.
+class TraceRecorder {
+public:
+  ~TraceRecorder();
+
+  TraceResult Start(std::string_view path);
+  void Stop();
+  [[nodiscard]] bool IsRecording() const;
+  [[nodiscard]] u64 GetRecordCount() const;
+
+  void Record(const trace::TraceRecord& record) {
+    while (!queue_->Push(record)) {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  static constexpr size_t kQueueSize = 1 << 16;
+
+  void Run();
+  void WriteChunk();
+
+  std::unique_ptr<SpscQueue<trace::TraceRecord, kQueueSize>> queue_ = std::make_unique<SpscQueue<trace::TraceRecord, kQueueSize>>();
+  std::ofstream file_ {};
+  trace::Encoder encoder_ {};
+  std::vector<u8> chunk_ {};
+  u32 chunk_records_ = 0;
+  std::atomic<u64> records_ {0};
+
+  std::thread thread_ {};
+  std::atomic<bool> running_ {false};
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "types.hpp"
+
+
+// Hands the newest value from one producer thread to one consumer thread
+// without either side blocking. The producer fills Back() and publishes it;
+// the consumer swaps in the latest published buffer with Acquire() and reads
+// it through Front() until the next Acquire().
+template <typename T>
+class TripleBuffer {
+public:
+  [[nodiscard]] T& Back() {
+    return buffers_[back_];
+  }
+
+  void Publish() {
+    const u8 prev = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+    back_ = prev & kIndexMask;
+  }
+
+  // Whether the consumer has yet to acquire the last published value. Only
+  // the producer should ask, a false answer holds until it publishes again.
+  [[nodiscard]] bool HasUnread() const {
+    return middle_.load(std::memory_order_acquire) & kFresh;
+  }
+
+  bool Acquire() {
+    if (!(middle_.load(std::memory_order_relaxed) & kFresh)) {
+      return false;
+    }
+    const u8 prev = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = prev & kIndexMask;
+    return true;
+  }
+
+  [[nodiscard]] const T& Front() const {
+    return buffers_[front_];
+  }
+
+private:
+  static constexpr u8 kIndexMask = 0x3;
+  static constexpr u8 kFresh = 0x4;
+
+  std::array<T, 3> buffers_ {};
+  u8 back_ = 0;
+  std::atomic<u8> middle_ {1};
+  u8 front_ = 2;
+};
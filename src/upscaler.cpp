@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdlib>
+#include <format>
+#include <tracy/Tracy.hpp>
+
+#if defined(__SSE2__)
+#define UPSCALER_SIMD
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define UPSCALER_SIMD
+#include <arm_neon.h>
+#endif
+
+#include "upscaler.hpp"
+
+
+namespace {
+  constexpr int kMaxNearestScale = 8;
+  // The edge between the two pixels on either side of a corner weighs 4x.
+  constexpr int kXbrEdgeShift = 2;
+
+  using Pixel = u32;
+
+  // Pixels are compared and written as packed words so the inner loops stay
+  // free of struct copies and vectorize.
+  inline Color Unpack(Pixel pixel) {
+    return std::bit_cast<Color>(pixel);
+  }
+
+  // One row of the padded frame in YUV, with the distances from each pixel
+  // to its right, lower, lower right and lower left neighbours. xBR measures
+  // every pair of pixels once through these rather than once per corner.
+  struct XbrRow {
+    std::vector<int> y;
+    std::vector<int> u;
+    std::vector<int> v;
+    std::vector<int> right;
+    std::vector<int> down;
+    std::vector<int> down_right;
+    std::vector<int> down_left;
+  };
+
+  // Scratch buffers are kept per thread so capture and recording threads can
+  // upscale without allocating each frame.
+  thread_local std::vector<Pixel> g_padded;
+  thread_local std::vector<Pixel> g_intermediate;
+  // The rows above, at and below the output row.
+  thread_local std::array<XbrRow, 3> g_xbr_rows;
+
+#if defined(UPSCALER_SIMD)
+  // Four pixels or distances at a time. Distances stay below 2^31, so the
+  // signed and unsigned compares agree. Builds without SSE2 or NEON, like
+  // the web one, only run the scalar loops.
+  constexpr int kLanes = 4;
+
+#if defined(__SSE2__)
+  using Lanes = __m128i;
+
+  inline Lanes Load(const void* src) { return _mm_loadu_si128(static_cast<const __m128i*>(src)); }
+  inline void Store(void* dst, Lanes a) { _mm_storeu_si128(static_cast<__m128i*>(dst), a); }
+  inline Lanes Splat(u32 value) { return _mm_set1_epi32(static_cast<int>(value)); }
+  inline Lanes Equal(Lanes a, Lanes b) { return _mm_cmpeq_epi32(a, b); }
+  inline bool AllSet(Lanes mask) { return _mm_movemask_epi8(mask) == 0xFFFF; }
+  inline Lanes Less(Lanes a, Lanes b) { return _mm_cmplt_epi32(a, b); }
+  inline Lanes And(Lanes a, Lanes b) { return _mm_and_si128(a, b); }
+  inline Lanes Or(Lanes a, Lanes b) { return _mm_or_si128(a, b); }
+  inline Lanes AndNot(Lanes mask, Lanes a) { return _mm_andnot_si128(mask, a); }
+  inline Lanes Select(Lanes mask, Lanes a, Lanes b) { return Or(And(mask, a), AndNot(mask, b)); }
+  inline Lanes Add(Lanes a, Lanes b) { return _mm_add_epi32(a, b); }
+  inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_epi32(a, b); }
+  template <int N> inline Lanes ShiftLeft(Lanes a) { return _mm_slli_epi32(a, N); }
+  template <int N> inline Lanes ShiftRight(Lanes a) { return _mm_srli_epi32(a, N); }
+
+  inline Lanes AbsDiff(Lanes a, Lanes b) {
+    const auto diff = Sub(a, b);
+    const auto sign = _mm_srai_epi32(diff, 31);
+    return Sub(_mm_xor_si128(diff, sign), sign);
+  }
+
+  // Stores even[0], odd[0], even[1], odd[1]...
+  inline void StoreInterleaved(Pixel* dst, Lanes even, Lanes odd) {
+    Store(dst, _mm_unpacklo_epi32(even, odd));
+    Store(dst + kLanes, _mm_unpackhi_epi32(even, odd));
+  }
+
+  // r * kr + g * kg + b * kb per pixel, as pairs of 16-bit products.
+  inline Lanes Weigh(Lanes rg, Lanes b, int kr, int kg, int kb) {
+    const auto pair = Splat((static_cast<u32>(kg) << 16) | (static_cast<u32>(kr) & 0xFFFF));
+    return Add(_mm_madd_epi16(rg, pair), _mm_madd_epi16(b, Splat(static_cast<u32>(kb) & 0xFFFF)));
+  }
+
+  inline void ToYuv(Lanes pixels, int* y, int* u, int* v) {
+    const auto rg = Or(And(pixels, Splat(0xFF)), ShiftLeft<8>(And(pixels, Splat(0xFF00))));
+    const auto b = And(ShiftRight<16>(pixels), Splat(0xFF));
+    Store(y, Weigh(rg, b, 299, 587, 114));
+    Store(u, Weigh(rg, b, -169, -331, 500));
+    Store(v, Weigh(rg, b, 500, -419, -81));
+  }
+#else
+  using Lanes = uint32x4_t;
+
+  inline Lanes Load(const void* src) { return vld1q_u32(static_cast<const u32*>(src)); }
+  inline void Store(void* dst, Lanes a) { vst1q_u32(static_cast<u32*>(dst), a); }
+  inline Lanes Splat(u32 value) { return vdupq_n_u32(value); }
+  inline Lanes Equal(Lanes a, Lanes b) { return vceqq_u32(a, b); }
+  inline bool AllSet(Lanes mask) { return vminvq_u32(mask) == 0xFFFFFFFF; }
+  inline Lanes Less(Lanes a, Lanes b) { return vcltq_u32(a, b); }
+  inline Lanes And(Lanes a, Lanes b) { return vandq_u32(a, b); }
+  inline Lanes Or(Lanes a, Lanes b) { return vorrq_u32(a, b); }
+  inline Lanes AndNot(Lanes mask, Lanes a) { return vbicq_u32(a, mask); }
+  inline Lanes Select(Lanes mask, Lanes a, Lanes b) { return vbslq_u32(mask, a, b); }
+  inline Lanes Add(Lanes a, Lanes b) { return vaddq_u32(a, b); }
+  inline Lanes Sub(Lanes a, Lanes b) { return vsubq_u32(a, b); }
+  template <int N> inline Lanes ShiftLeft(Lanes a) { return vshlq_n_u32(a, N); }
+  template <int N> inline Lanes ShiftRight(Lanes a) { return vshrq_n_u32(a, N); }
+
+  inline Lanes AbsDiff(Lanes a, Lanes b) {
+    return vreinterpretq_u32_s32(vabdq_s32(vreinterpretq_s32_u32(a), vreinterpretq_s32_u32(b)));
+  }
+
+  // Stores even[0], odd[0], even[1], odd[1]...
+  inline void StoreInterleaved(Pixel* dst, Lanes even, Lanes odd) {
+    vst2q_u32(dst, uint32x4x2_t{{ even, odd }});
+  }
+
+  inline int32x4_t Weigh(int32x4_t r, int32x4_t g, int32x4_t b, int kr, int kg, int kb) {
+    return vmlaq_n_s32(vmlaq_n_s32(vmulq_n_s32(r, kr), g, kg), b, kb);
+  }
+
+  inline void ToYuv(Lanes pixels, int* y, int* u, int* v) {
+    const auto r = vreinterpretq_s32_u32(And(pixels, Splat(0xFF)));
+    const auto g = vreinterpretq_s32_u32(And(ShiftRight<8>(pixels), Splat(0xFF)));
+    const auto b = vreinterpretq_s32_u32(And(ShiftRight<16>(pixels), Splat(0xFF)));
+    vst1q_s32(y, Weigh(r, g, b, 299, 587, 114));
+    vst1q_s32(u, Weigh(r, g, b, -169, -331, 500));
+    vst1q_s32(v, Weigh(r, g, b, 500, -419, -81));
+  }
+#endif
+#endif
+
+  // Copies src into g_padded with a one pixel border replicating the edges,
+  // so the 3x3 filters can read neighbours without clamping.
+  const Pixel* Pad(const Pixel* src, int width, int height) {
+    const int padded_width = width + 2;
+    g_padded.resize(static_cast<size_t>(padded_width) * (height + 2));
+    for (int y = -1; y <= height; y += 1) {
+      const auto* src_row = src + std::clamp(y, 0, height - 1) * width;
+      auto* row = g_padded.data() + (y + 1) * padded_width;
+      row[0] = src_row[0];
+      std::copy_n(src_row, width, row + 1);
+      row[width + 1] = src_row[width - 1];
+    }
+    return g_padded.data() + padded_width + 1;
+  }
+
+  void Nearest(const Pixel* src, int width, int height, int scale, Pixel* dst) {
+    const int dst_width = width * scale;
+    for (int y = 0; y < height; y += 1) {
+      auto* row = dst + (y * scale) * dst_width;
+      const auto* src_row = src + y * width;
+      for (int x = 0; x < width; x += 1) {
+        std::fill_n(row + x * scale, scale, src_row[x]);
+      }
+      for (int i = 1; i < scale; i += 1) {
+        std::copy_n(row, dst_width, row + i * dst_width);
+      }
+    }
+  }
+
+  void Scale2x(const Pixel* src, int width, int height, Pixel* dst) {
+    const int stride = width + 2;
+    const int dst_width = width * 2;
+    const auto* padded = Pad(src, width, height);
+    for (int y = 0; y < height; y += 1) {
+      const auto* p = padded + y * stride;
+      auto* out0 = dst + (y * 2) * dst_width;
+      auto* out1 = out0 + dst_width;
+
+      int x = 0;
+#if defined(UPSCALER_SIMD)
+      for (; x + kLanes <= width; x += kLanes) {
+        const auto b = Load(p + x - stride), d = Load(p + x - 1), e = Load(p + x), f = Load(p + x + 1), h = Load(p + x + stride);
+
+        const auto flat = Or(Equal(b, h), Equal(d, f));
+        StoreInterleaved(out0 + x * 2, Select(AndNot(flat, Equal(d, b)), d, e), Select(AndNot(flat, Equal(b, f)), f, e));
+        StoreInterleaved(out1 + x * 2, Select(AndNot(flat, Equal(d, h)), d, e), Select(AndNot(flat, Equal(h, f)), f, e));
+      }
+#endif
+      for (; x < width; x += 1) {
+        const Pixel b = p[x - stride], d = p[x - 1], e = p[x], f = p[x + 1], h = p[x + stride];
+
+        const bool edge = b != h && d != f;
+        out0[x * 2] = edge && d == b ? d : e;
+        out0[x * 2 + 1] = edge && b == f ? f : e;
+        out1[x * 2] = edge && d == h ? d : e;
+        out1[x * 2 + 1] = edge && h == f ? f : e;
+      }
+    }
+  }
+
+  void Scale3x(const Pixel* src, int width, int height, Pixel* dst) {
+    const int stride = width + 2;
+    const int dst_width = width * 3;
+    const auto* padded = Pad(src, width, height);
+    for (int y = 0; y < height; y += 1) {
+      const auto* p = padded + y * stride;
+      auto* out0 = dst + (y * 3) * dst_width;
+      auto* out1 = out0 + dst_width;
+      auto* out2 = out1 + dst_width;
+
+      for (int x = 0; x < width; x += 1) {
+        const Pixel a = p[x - stride - 1], b = p[x - stride], c = p[x - stride + 1];
+        const Pixel d = p[x - 1], e = p[x], f = p[x + 1];
+        const Pixel g = p[x + stride - 1], h = p[x + stride], i = p[x + stride + 1];
+
+        auto* o0 = out0 + x * 3;
+        auto* o1 = out1 + x * 3;
+        auto* o2 = out2 + x * 3;
+        std::fill_n(o0, 3, e);
+        std::fill_n(o1, 3, e);
+        std::fill_n(o2, 3, e);
+
+        if (b == h || d == f) {
+          continue;
+        }
+
+        o0[0] = d == b ? d : e;
+        o0[1] = (d == b && e != c) || (b == f && e != a) ? b : e;
+        o0[2] = b == f ? f : e;
+        o1[0] = (d == b && e != g) || (d == h && e != a) ? d : e;
+        o1[2] = (b == f && e != i) || (h == f && e != c) ? f : e;
+        o2[0] = d == h ? d : e;
+        o2[1] = (d == h && e != i) || (h == f && e != g) ? h : e;
+        o2[2] = h == f ? f : e;
+      }
+    }
+  }
+
+  inline void ToYuv(Pixel pixel, int* y, int* u, int* v) {
+    const auto c = Unpack(pixel);
+    *y = c.r * 299 + c.g * 587 + c.b * 114;
+    *u = c.r * -169 + c.g * -331 + c.b * 500;
+    *v = c.r * 500 + c.g * -419 + c.b * -81;
+  }
+
+  // Luma-weighted distance in the YUV space used by the xBR family, between
+  // pixel i of row0 and pixel j of row1.
+  inline int Distance(const XbrRow& row0, int i, const XbrRow& row1, int j) {
+    return 48 * std::abs(row0.y[i] - row1.y[j]) + 7 * std::abs(row0.u[i] - row1.u[j]) + 6 * std::abs(row0.v[i] - row1.v[j]);
+  }
+
+  inline Pixel Blend(Pixel p0, Pixel p1) {
+    return (((p0 & 0x00FEFEFE) >> 1) + ((p1 & 0x00FEFEFE) >> 1)) | (p0 & 0xFF000000);
+  }
+
+  // Resolves one output corner of the centre pixel e from the two neighbours
+  // n0/n1 on that side. along weighs the edge running past the corner, across
+  // the one cutting it off; to_n0/to_n1 are the distances from e to n0/n1.
+  inline Pixel XbrCorner(Pixel e, Pixel n0, Pixel n1, int along, int across, int to_n0, int to_n1) {
+    if (along >= across) {
+      return e;
+    }
+    return Blend(e, to_n0 <= to_n1 ? n0 : n1);
+  }
+
+#if defined(UPSCALER_SIMD)
+  // Distances for the four pixels from i and j on.
+  inline Lanes Distances(const XbrRow& row0, int i, const XbrRow& row1, int j) {
+    const auto dy = AbsDiff(Load(&row0.y[i]), Load(&row1.y[j]));
+    const auto du = AbsDiff(Load(&row0.u[i]), Load(&row1.u[j]));
+    const auto dv = AbsDiff(Load(&row0.v[i]), Load(&row1.v[j]));
+    // 48 * dy + 7 * du + 6 * dv
+    return Add(Add(ShiftLeft<5>(dy), ShiftLeft<4>(dy)), Add(Sub(ShiftLeft<3>(du), du), Add(ShiftLeft<2>(dv), ShiftLeft<1>(dv))));
+  }
+
+  inline Lanes Blend(Lanes p0, Lanes p1) {
+    const auto rgb = Splat(0x00FEFEFE);
+    return Or(Add(ShiftRight<1>(And(p0, rgb)), ShiftRight<1>(And(p1, rgb))), AndNot(Splat(0x00FFFFFF), p0));
+  }
+
+  inline Lanes XbrCorner(Lanes e, Lanes n0, Lanes n1, Lanes along, Lanes across, Lanes to_n0, Lanes to_n1) {
+    const auto n = Select(Less(to_n1, to_n0), n1, n0);
+    return Select(Less(along, across), Blend(e, n), e);
+  }
+#endif
+
+  // Converts a padded row of size pixels and measures the distances along it.
+  void BeginXbrRow(const Pixel* pixels, int size, XbrRow& row) {
+    for (auto* plane : { &row.y, &row.u, &row.v, &row.right, &row.down, &row.down_right, &row.down_left }) {
+      plane->resize(size);
+    }
+
+    int i = 0;
+#if defined(UPSCALER_SIMD)
+    for (; i + kLanes <= size; i += kLanes) {
+      ToYuv(Load(pixels + i), &row.y[i], &row.u[i], &row.v[i]);
+    }
+#endif
+    for (; i < size; i += 1) {
+      ToYuv(pixels[i], &row.y[i], &row.u[i], &row.v[i]);
+    }
+
+    i = 0;
+#if defined(UPSCALER_SIMD)
+    for (; i + kLanes < size; i += kLanes) {
+      Store(&row.right[i], Distances(row, i, row, i + 1));
+    }
+#endif
+    for (; i + 1 < size; i += 1) {
+      row.right[i] = Distance(row, i, row, i + 1);
+    }
+  }
+
+  // Measures the distances from row down to the row below it.
+  void FinishXbrRow(XbrRow& row, const XbrRow& below, int size) {
+    row.down[0] = Distance(row, 0, below, 0);
+    row.down_right[0] = Distance(row, 0, below, 1);
+    int i = 1;
+#if defined(UPSCALER_SIMD)
+    for (; i + kLanes < size; i += kLanes) {
+      Store(&row.down[i], Distances(row, i, below, i));
+      Store(&row.down_right[i], Distances(row, i, below, i + 1));
+      Store(&row.down_left[i], Distances(row, i, below, i - 1));
+    }
+#endif
+    for (; i + 1 < size; i += 1) {
+      row.down[i] = Distance(row, i, below, i);
+      row.down_right[i] = Distance(row, i, below, i + 1);
+      row.down_left[i] = Distance(row, i, below, i - 1);
+    }
+    row.down[i] = Distance(row, i, below, i);
+    row.down_left[i] = Distance(row, i, below, i - 1);
+  }
+
+  // Writes the two output rows for the source row between top and bottom.
+  // Row indices are shifted by one so that x is the centre column.
+  void XbrLiteRow(const Pixel* p, int stride, int width, const XbrRow& top, const XbrRow& mid, const XbrRow& bottom, Pixel* out0, Pixel* out1) {
+    const int* top_right = top.right.data() + 1;
+    const int* top_down = top.down.data() + 1;
+    const int* top_down_right = top.down_right.data() + 1;
+    const int* top_down_left = top.down_left.data() + 1;
+    const int* mid_right = mid.right.data() + 1;
+    const int* mid_down = mid.down.data() + 1;
+    const int* mid_down_right = mid.down_right.data() + 1;
+    const int* mid_down_left = mid.down_left.data() + 1;
+    const int* bottom_right = bottom.right.data() + 1;
+
+    int x = 0;
+#if defined(UPSCALER_SIMD)
+    for (; x + kLanes <= width; x += kLanes) {
+      const auto pe = Load(p + x);
+      const auto pb = Load(p + x - stride), pd = Load(p + x - 1), pf = Load(p + x + 1), ph = Load(p + x + stride);
+      const auto flat = And(And(Equal(pb, pe), Equal(pd, pe)), And(Equal(pf, pe), Equal(ph, pe)));
+      if (AllSet(flat)) {
+        StoreInterleaved(out0 + x * 2, pe, pe);
+        StoreInterleaved(out1 + x * 2, pe, pe);
+        continue;
+      }
+
+      const auto e_right = Load(mid_right + x), d_right = Load(mid_right + x - 1);
+      const auto e_down = Load(mid_down + x), b_down = Load(top_down + x);
+      const auto corner0 = XbrCorner(pe, pb, pd,
+        Add(Add(e_right, e_down), ShiftLeft<kXbrEdgeShift>(Load(top_down_left + x))),
+        Add(Add(Load(top_right + x - 1), Load(top_down + x - 1)), ShiftLeft<kXbrEdgeShift>(Load(top_down_right + x - 1))),
+        b_down, d_right);
+      const auto corner1 = XbrCorner(pe, pb, pf,
+        Add(Add(d_right, e_down), ShiftLeft<kXbrEdgeShift>(Load(top_down_right + x))),
+        Add(Add(Load(top_right + x), Load(top_down + x + 1)), ShiftLeft<kXbrEdgeShift>(Load(top_down_left + x + 1))),
+        b_down, e_right);
+      const auto corner2 = XbrCorner(pe, pd, ph,
+        Add(Add(b_down, e_right), ShiftLeft<kXbrEdgeShift>(Load(mid_down_right + x - 1))),
+        Add(Add(Load(mid_down + x - 1), Load(bottom_right + x - 1)), ShiftLeft<kXbrEdgeShift>(Load(mid_down_left + x))),
+        d_right, e_down);
+      const auto corner3 = XbrCorner(pe, pf, ph,
+        Add(Add(b_down, d_right), ShiftLeft<kXbrEdgeShift>(Load(mid_down_left + x + 1))),
+        Add(Add(Load(mid_down + x + 1), Load(bottom_right + x)), ShiftLeft<kXbrEdgeShift>(Load(mid_down_right + x))),
+        e_right, e_down);
+
+      StoreInterleaved(out0 + x * 2, Select(flat, pe, corner0), Select(flat, pe, corner1));
+      StoreInterleaved(out1 + x * 2, Select(flat, pe, corner2), Select(flat, pe, corner3));
+    }
+#endif
+    for (; x < width; x += 1) {
+      const Pixel e = p[x];
+      const Pixel b = p[x - stride], d = p[x - 1], f = p[x + 1], h = p[x + stride];
+      if (b == e && d == e && f == e && h == e) {
+        out0[x * 2] = out0[x * 2 + 1] = out1[x * 2] = out1[x * 2 + 1] = e;
+        continue;
+      }
+
+      out0[x * 2] = XbrCorner(e, b, d,
+        mid_right[x] + mid_down[x] + (top_down_left[x] << kXbrEdgeShift),
+        top_right[x - 1] + top_down[x - 1] + (top_down_right[x - 1] << kXbrEdgeShift),
+        top_down[x], mid_right[x - 1]);
+      out0[x * 2 + 1] = XbrCorner(e, b, f,
+        mid_right[x - 1] + mid_down[x] + (top_down_right[x] << kXbrEdgeShift),
+        top_right[x] + top_down[x + 1] + (top_down_left[x + 1] << kXbrEdgeShift),
+        top_down[x], mid_right[x]);
+      out1[x * 2] = XbrCorner(e, d, h,
+        top_down[x] + mid_right[x] + (mid_down_right[x - 1] << kXbrEdgeShift),
+        mid_down[x - 1] + bottom_right[x - 1] + (mid_down_left[x] << kXbrEdgeShift),
+        mid_right[x - 1], mid_down[x]);
+      out1[x * 2 + 1] = XbrCorner(e, f, h,
+        top_down[x] + mid_right[x - 1] + (mid_down_left[x + 1] << kXbrEdgeShift),
+        mid_down[x + 1] + bottom_right[x] + (mid_down_right[x] << kXbrEdgeShift),
+        mid_right[x], mid_down[x]);
+    }
+  }
+
+  void XbrLite(const Pixel* src, int width, int height, Pixel* dst) {
+    const int stride = width + 2;
+    const int dst_width = width * 2;
+    const auto* padded = Pad(src, width, height);
+    const auto* first_row = padded - stride - 1;
+
+    // Each padded row is measured against the one below once that exists,
+    // and a source row is drawn once the row below it has been measured.
+    for (int r = 0; r < height + 2; r += 1) {
+      auto& row = g_xbr_rows[r % 3];
+      BeginXbrRow(first_row + r * stride, stride, row);
+      if (r < 1) {
+        continue;
+      }
+      FinishXbrRow(g_xbr_rows[(r - 1) % 3], row, stride);
+      if (r < 2) {
+        continue;
+      }
+      const int y = r - 2;
+      auto* out0 = dst + (y * 2) * dst_width;
+      XbrLiteRow(padded + y * stride, stride, width, g_xbr_rows[y % 3], g_xbr_rows[(y + 1) % 3], row, out0, out0 + dst_width);
+    }
+  }
+}
+
+bool upscaler::SupportsScale(Filter filter, int scale) {
+  switch (filter) {
+    case Filter::kNearest: return scale >= 1 && scale <= kMaxNearestScale;
+    case Filter::kScale2x: return scale == 2 || scale == 4;
+    case Filter::kScale3x: return scale == 3;
+    case Filter::kXbrLite: return scale == 2 || scale == 4;
+  }
+  return false;
+}
+
+upscaler::UpscaleResult upscaler::Upscale(Filter filter, int scale, std::span<const Color> src, int width, int height, Frame& dst) {
+  ZoneScoped;
+
+  if (!SupportsScale(filter, scale)) {
+    return std::unexpected{std::format("Unsupported scale {}x for this filter", scale)};
+  }
+  if (src.size() < static_cast<size_t>(width * height)) {
+    return std::unexpected{"Source frame is smaller than its dimensions"};
+  }
+
+  dst.width = width * scale;
+  dst.height = height * scale;
+  dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height);
+
+  const auto* in = reinterpret_cast<const Pixel*>(src.data());
+  auto* out = reinterpret_cast<Pixel*>(dst.pixels.data());
+
+  switch (filter) {
+    case Filter::kNearest:
+      Nearest(in, width, height, scale, out);
+      break;
+    case Filter::kScale3x:
+      Scale3x(in, width, height, out);
+      break;
+    case Filter::kScale2x:
+    case Filter::kXbrLite: {
+      auto pass = filter == Filter::kScale2x ? Scale2x : XbrLite;
+      if (scale == 2) {
+        pass(in, width, height, out);
+        break;
+      }
+      g_intermediate.resize(static_cast<size_t>(width) * height * 4);
+      pass(in, width, height, g_intermediate.data());
+      pass(g_intermediate.data(), width * 2, height * 2, out);
+      break;
+    }
+  }
+
+  return {};
+}
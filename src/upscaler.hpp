@@ -0,0 +1,33 @@
+#pragma once
+
+#include <expected>
+#include <span>
+#include <string>
+#include <vector>
+#include <raylib.h>
+
+#include "types.hpp"
+
+
+namespace upscaler {
+
+enum class Filter : u8 {
+  kNearest,
+  kScale2x,
+  kScale3x,
+  kXbrLite,
+};
+
+struct Frame {
+  std::vector<Color> pixels;
+  int width;
+  int height;
+};
+
+using UpscaleResult = std::expected<void, std::string>;
+
+[[nodiscard]] bool SupportsScale(Filter filter, int scale);
+
+UpscaleResult Upscale(Filter filter, int scale, std::span<const Color> src, int width, int height, Frame& dst);
+
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 
 #include "wram_device.hpp"
@@ -49,6 +50,34 @@ void WramDevice::Reset() {
   std::fill_n(banks_.at(0).begin(), banks_.size() * kWramNumBanks, 0);
 }
 
+bool WramDevice::IsValidForRange(u16 first, u16 last) const {
+  return first >= kWramStart && last <= kEchoRamEnd;
+}
+
+void WramDevice::ReadSpan(u16 addr, std::span<u8> dst) const {
+  while (!dst.empty()) {
+    const auto index = addr & kWramIndexMask;
+    auto chunk = dst.first(std::min(dst.size(), kWramBankSize - index));
+    std::copy_n(BankAt(addr).begin() + index, chunk.size(), chunk.begin());
+    addr += chunk.size();
+    dst = dst.subspan(chunk.size());
+  }
+}
+
+void WramDevice::WriteSpan(u16 addr, std::span<const u8> src) {
+  while (!src.empty()) {
+    const auto index = addr & kWramIndexMask;
+    auto chunk = src.first(std::min(src.size(), kWramBankSize - index));
+    std::copy(chunk.begin(), chunk.end(), BankAt(addr).begin() + index);
+    addr += chunk.size();
+    src = src.subspan(chunk.size());
+  }
+}
+
+u16 WramDevice::GetBank(u16 addr) const {
+  return static_cast<u16>(&BankAt(addr) - banks_.data());
+}
+
 WramBank& WramDevice::Bank0() {
   return banks_.at(0);
 }
@@ -19,6 +19,10 @@ public:
   void Write8(u16 addr, u8 byte) override;
   [[nodiscard]] u8 Read8(u16 addr) const override;
   void Reset() override;
+  [[nodiscard]] bool IsValidForRange(u16 first, u16 last) const override;
+  void ReadSpan(u16 addr, std::span<u8> dst) const override;
+  void WriteSpan(u16 addr, std::span<const u8> src) override;
+  [[nodiscard]] u16 GetBank(u16 addr) const override;
 
 private:
   WramBank& Bank0();
@@ -31,5 +35,5 @@ private:
 private:
   Mmu* mmu_ = nullptr;
   std::array<WramBank, kWramNumBanks> banks_;
-  u8 svbk_;
+  u8 svbk_ = 0;
 };